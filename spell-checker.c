@@ -2,40 +2,260 @@
 
 #include "spell-checker.h"
 #include "spell-checker_runner.h"
+#include "spell-checker_data.h"
+#include "spell-checker_data_index.h"
+#include "spell-checker_stream.h"
 
 typedef struct _SpellCheckerDictionary
 {
     SpellCheckerRunnerHandle runner;
+    int isReadOnly; /* atomic, as a swap may change it */
+
+    /* The dictionary this one is an overlay of, NULL if none */
+    SpellCheckerDictionaryHandle base;
+
+    /* The open overlays of the dictionary, plus one until it is closed */
+    int refCount;
+
+    /* The executor the dictionary runs on, NULL if it has its own thread */
+    SpellCheckerExecutorHandle executor;
 } _SpellCheckerDictionary;
 
-SpellCheckerDictionaryHandle createSpellCheckerDictionary()
+typedef struct _SpellCheckerExecutor
+{
+    SpellCheckerPoolHandle pool;
+
+    /* The dictionaries running on the executor, plus one until it is closed */
+    int refCount;
+} _SpellCheckerExecutor;
+
+static inline int isReadOnly(SpellCheckerDictionaryHandle dict)
+{
+    return __atomic_load_n(&dict->isReadOnly, __ATOMIC_RELAXED);
+}
+
+static void releaseExecutor(SpellCheckerExecutorHandle executor)
+{
+    if (executor &&
+        (0 == __atomic_sub_fetch(&executor->refCount, 1, __ATOMIC_ACQ_REL)))
+    {
+        scrExecutorFinalize(executor->pool);
+        free(executor);
+    }
+}
+
+static SpellCheckerDictionaryHandle createDictionary(
+    SpellCheckerDataHandle data, int isReadOnly, size_t queueDepth,
+    SpellCheckerQueuePolicy queuePolicy, size_t cacheSize,
+    SpellCheckerExecutorHandle executor)
 {
+    if (!data)
+        return NULL;
+
     SpellCheckerDictionaryHandle dict = malloc(sizeof(_SpellCheckerDictionary));
     if (dict)
     {
-        dict->runner = scrInit();
+        dict->runner = scrInit(data, queueDepth, queuePolicy, cacheSize,
+                               executor ? executor->pool : NULL);
         if (!dict->runner)
         {
             free(dict);
-            return NULL;
+            dict = NULL;
+        }
+        else
+        {
+            dict->isReadOnly = isReadOnly;
+            dict->base = NULL;
+            dict->refCount = 1;
+            dict->executor = executor;
+            if (executor)
+                __atomic_add_fetch(&executor->refCount, 1, __ATOMIC_RELAXED);
         }
     }
+
+    if (!dict)
+        scdFinalize(data);
+
     return dict;
 }
 
-int closeSpellCheckerDictionary(SpellCheckerDictionaryHandle dict)
+SpellCheckerDictionaryHandle createSpellCheckerDictionary()
+{
+    return createSpellCheckerDictionaryWithBackend(SPELL_CHECKER_BACKEND_TRIE);
+}
+
+SpellCheckerDictionaryHandle createSpellCheckerDictionaryWithBackend(
+    SpellCheckerBackend backend)
+{
+    SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, NULL,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    return createSpellCheckerDictionaryWithOptions(&options);
+}
+
+/*
+ * Create the data model of a dictionary with the given options.
+ */
+static SpellCheckerDataHandle createData(const SpellCheckerOptions *options)
+{
+    if (!options || (options->suggestIndexDistance > SCD_INDEX_MAX_DISTANCE))
+        return NULL;
+
+    switch (options->queuePolicy)
+    {
+    case SPELL_CHECKER_QUEUE_BLOCK:
+    case SPELL_CHECKER_QUEUE_FAIL:
+    case SPELL_CHECKER_QUEUE_DROP:
+        break;
+    default:
+        return NULL;
+    }
+
+    switch (options->encoding)
+    {
+    case SPELL_CHECKER_ENCODING_BYTES:
+    case SPELL_CHECKER_ENCODING_UTF8:
+        break;
+    default:
+        return NULL;
+    }
+
+    ScdBackendType type;
+    switch (options->backend)
+    {
+    case SPELL_CHECKER_BACKEND_TRIE:
+        type = SCD_BACKEND_TRIE;
+        break;
+    case SPELL_CHECKER_BACKEND_HASH:
+        type = SCD_BACKEND_HASH;
+        break;
+    case SPELL_CHECKER_BACKEND_DAWG:
+        type = SCD_BACKEND_DAWG;
+        break;
+    default:
+        return NULL;
+    }
+
+    SpellCheckerDataHandle data = scdInit(type);
+    if (data &&
+        (((SPELL_CHECKER_ENCODING_UTF8 == options->encoding) &&
+          (-1 == scdSetUtf8(data))) ||
+         (options->suggestIndexDistance &&
+          (-1 == scdSetIndex(data, options->suggestIndexDistance,
+                             options->suggestIndexBudget)))))
+    {
+        scdFinalize(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+SpellCheckerDictionaryHandle createSpellCheckerDictionaryWithOptions(
+    const SpellCheckerOptions *options)
+{
+    SpellCheckerDataHandle data = createData(options);
+    if (!data)
+        return NULL;
+
+    return createDictionary(data, 0, options->queueDepth,
+                            options->queuePolicy, options->lookupCacheSize,
+                            options->executor);
+}
+
+SpellCheckerExecutorHandle createSpellCheckerExecutor(unsigned int numThreads)
 {
+    SpellCheckerExecutorHandle executor = malloc(sizeof(_SpellCheckerExecutor));
+    if (executor)
+    {
+        executor->pool = scrExecutorInit(numThreads);
+        executor->refCount = 1;
+        if (!executor->pool)
+        {
+            free(executor);
+            executor = NULL;
+        }
+    }
+    return executor;
+}
+
+int closeSpellCheckerExecutor(SpellCheckerExecutorHandle executor)
+{
+    releaseExecutor(executor);
+    return 0;
+}
+
+SpellCheckerDictionaryHandle openSpellCheckerDictionaryMapped(const char *path)
+{
+    if (!path)
+        return NULL;
+
+    return createDictionary(scdOpenImage(path), 1, 0,
+                            SPELL_CHECKER_QUEUE_BLOCK, 0, NULL);
+}
+
+SpellCheckerDictionaryHandle createSpellCheckerOverlay(
+    SpellCheckerDictionaryHandle base, const SpellCheckerOptions *options)
+{
+    static const SpellCheckerOptions defaults = {
+        SPELL_CHECKER_BACKEND_TRIE, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, NULL,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+
+    if (!base || !isReadOnly(base))
+        return NULL;
+    if (!options)
+        options = &defaults;
+
+    SpellCheckerDataHandle data = createData(options);
+    if (!data)
+        return NULL;
+    if (-1 == scdLayerOver(data, scrGetData(base->runner)))
+    {
+        scdFinalize(data);
+        return NULL;
+    }
+
+    SpellCheckerDictionaryHandle dict =
+        createDictionary(data, 0, options->queueDepth, options->queuePolicy,
+                         options->lookupCacheSize, options->executor);
     if (dict)
     {
-        scrFinalize(dict->runner);
-        free(dict);
+        dict->base = base;
+        __atomic_add_fetch(&base->refCount, 1, __ATOMIC_RELAXED);
     }
+    return dict;
+}
+
+/*
+ * Drop a reference to the dictionary, and free it with the last one.
+ */
+static void releaseDictionary(SpellCheckerDictionaryHandle dict)
+{
+    if (0 != __atomic_sub_fetch(&dict->refCount, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    SpellCheckerDictionaryHandle base = dict->base;
+    SpellCheckerExecutorHandle executor = dict->executor;
+    scrFinalize(dict->runner);
+    free(dict);
+
+    releaseExecutor(executor);
+    if (base)
+        releaseDictionary(base);
+}
+
+int closeSpellCheckerDictionary(SpellCheckerDictionaryHandle dict)
+{
+    if (dict)
+        releaseDictionary(dict);
     return 0;
 }
 
 int spellCheckerAddWord(SpellCheckerDictionaryHandle dict, const char *word)
 {
-    if (!dict || !word)
+    if (!dict || !word || isReadOnly(dict))
     {
         return -1;
     }
@@ -43,8 +263,279 @@ int spellCheckerAddWord(SpellCheckerDictionaryHandle dict, const char *word)
     return scrAddWord(dict->runner, word);
 }
 
+int spellCheckerAddWordWithFrequency(SpellCheckerDictionaryHandle dict,
+                                     const char *word, unsigned int frequency)
+{
+    if (!dict || !word || isReadOnly(dict))
+    {
+        return -1;
+    }
+
+    return scrAddWordWithFrequency(dict->runner, word, frequency);
+}
+
+int spellCheckerAddWords(SpellCheckerDictionaryHandle dict, const char *buf,
+                         size_t len)
+{
+    if (!dict || (!buf && len) || isReadOnly(dict))
+    {
+        return -1;
+    }
+
+    return scrAddWords(dict->runner, buf, len);
+}
+
+int spellCheckerRemoveWord(SpellCheckerDictionaryHandle dict, const char *word)
+{
+    if (!dict || !word || isReadOnly(dict))
+    {
+        return -1;
+    }
+
+    return scrRemoveWord(dict->runner, word);
+}
+
+int spellCheckerSwapDictionary(SpellCheckerDictionaryHandle dict,
+                               SpellCheckerDictionaryHandle replacement)
+{
+    if (!dict || !replacement || (dict == replacement) || dict->base ||
+        replacement->base ||
+        (1 != __atomic_load_n(&dict->refCount, __ATOMIC_RELAXED)) ||
+        (1 != __atomic_load_n(&replacement->refCount, __ATOMIC_RELAXED)))
+    {
+        return -1;
+    }
+
+    const int ret = scrSwap(dict->runner, replacement->runner);
+    if (-1 == ret)
+        return -1;
+
+    if (!ret)
+        __atomic_store_n(&dict->isReadOnly, isReadOnly(replacement),
+                         __ATOMIC_RELAXED);
+
+    /* The replacement's runner is gone, and with it its use of the executor */
+    SpellCheckerExecutorHandle executor = replacement->executor;
+    free(replacement);
+    releaseExecutor(executor);
+    return ret;
+}
+
 void spellCheck(SpellCheckerDictionaryHandle dict, const char *text,
                 SpellCheckerCallback callback)
 {
     scrRunSpellCheck(dict->runner, text, callback);
 }
+
+SpellCheckerJobHandle spellCheckAsync(SpellCheckerDictionaryHandle dict,
+                                      const char *text, size_t len,
+                                      SpellCheckerSpanCallback callback,
+                                      SpellCheckerJobCallback onComplete,
+                                      void *userdata)
+{
+    if (!dict || (!text && len) || !callback)
+    {
+        return NULL;
+    }
+
+    return scrStartSpellCheck(dict->runner, text, len, callback, onComplete,
+                              userdata);
+}
+
+int spellCheckerJobWait(SpellCheckerJobHandle job, long timeoutMs)
+{
+    return scrJobWait(job, timeoutMs);
+}
+
+SpellCheckerJobStatus spellCheckerJobGetStatus(SpellCheckerJobHandle job)
+{
+    return scrJobGetStatus(job);
+}
+
+int spellCheckerJobCancel(SpellCheckerJobHandle job)
+{
+    return scrJobCancel(job);
+}
+
+void spellCheckerJobRelease(SpellCheckerJobHandle job)
+{
+    scrJobRelease(job);
+}
+
+int spellCheckSpan(SpellCheckerDictionaryHandle dict, const char *text,
+                   size_t len, SpellCheckerSpanCallback callback,
+                   void *userdata)
+{
+    if (!dict || (!text && len) || !callback)
+    {
+        return -1;
+    }
+
+    return scrCheckSpan(dict->runner, text, len, callback, userdata);
+}
+
+SpellCheckerStreamHandle spellCheckBegin(SpellCheckerDictionaryHandle dict,
+                                         SpellCheckerSpanCallback callback,
+                                         void *userdata)
+{
+    if (!dict || !callback)
+    {
+        return NULL;
+    }
+
+    return scsInit(dict->runner, callback, userdata);
+}
+
+int spellCheckFeed(SpellCheckerStreamHandle stream, const char *chunk,
+                   size_t len)
+{
+    if (!stream || (!chunk && len))
+    {
+        return -1;
+    }
+
+    return scsFeed(stream, chunk, len);
+}
+
+int spellCheckEnd(SpellCheckerStreamHandle stream)
+{
+    if (!stream)
+    {
+        return -1;
+    }
+
+    return scsFinalize(stream);
+}
+
+int spellCheckFile(SpellCheckerDictionaryHandle dict, const char *path,
+                   SpellCheckerSpanCallback callback, void *userdata)
+{
+    if (!dict || !path || !callback)
+    {
+        return -1;
+    }
+
+    return scrCheckFile(dict->runner, path, callback, userdata);
+}
+
+int spellCheckerHasWord(SpellCheckerDictionaryHandle dict, const char *word)
+{
+    if (!dict || !word)
+    {
+        return -1;
+    }
+
+    return scrHasWord(dict->runner, word);
+}
+
+int spellCheckerSuggest(SpellCheckerDictionaryHandle dict, const char *word,
+                        unsigned int maxDistance, size_t maxResults, char **out)
+{
+    if (!dict || !word || (!out && maxResults))
+    {
+        return -1;
+    }
+
+    return scrSuggest(dict->runner, word, maxDistance, maxResults, out);
+}
+
+int spellCheckerHasPrefix(SpellCheckerDictionaryHandle dict, const char *prefix)
+{
+    if (!dict || !prefix)
+    {
+        return -1;
+    }
+
+    return scrHasPrefix(dict->runner, prefix);
+}
+
+int spellCheckerComplete(SpellCheckerDictionaryHandle dict, const char *prefix,
+                         size_t maxResults, char **out)
+{
+    if (!dict || !prefix || (!out && maxResults))
+    {
+        return -1;
+    }
+
+    return scrComplete(dict->runner, prefix, maxResults, out);
+}
+
+int spellCheckerHasWords(SpellCheckerDictionaryHandle dict, const char **words,
+                         const size_t *lens, size_t numWords,
+                         uint8_t *results)
+{
+    if (!dict || ((!words || !lens || !results) && numWords))
+    {
+        return -1;
+    }
+
+    return scrHasWords(dict->runner, words, lens, numWords, results);
+}
+
+int spellCheckerGetCacheStats(SpellCheckerDictionaryHandle dict,
+                              SpellCheckerCacheStats *stats)
+{
+    if (!dict || !stats)
+    {
+        return -1;
+    }
+
+    uint64_t hits;
+    uint64_t misses;
+    if (-1 == scrGetCacheStats(dict->runner, &hits, &misses))
+    {
+        return -1;
+    }
+
+    stats->hits = hits;
+    stats->misses = misses;
+    return 0;
+}
+
+int spellCheckerGetStats(SpellCheckerDictionaryHandle dict,
+                         SpellCheckerStats *stats)
+{
+    if (!dict || !stats)
+    {
+        return -1;
+    }
+
+    ScrStats runnerStats;
+    if (-1 == scrGetStats(dict->runner, &runnerStats))
+    {
+        return -1;
+    }
+
+    stats->numWords = runnerStats.numWords;
+    stats->numNodes = runnerStats.numNodes;
+    stats->bytes = runnerStats.bytes;
+    stats->queueDepth = runnerStats.queueDepth;
+    stats->maxQueueDepth = runnerStats.maxQueueDepth;
+    stats->numMessages = runnerStats.numMessages;
+    stats->numTokens = runnerStats.numTokens;
+    stats->numMisspellings = runnerStats.numMisspellings;
+    stats->runnerTimeNs = runnerStats.busyNs;
+    return 0;
+}
+
+int spellCheckerSetParallelism(SpellCheckerDictionaryHandle dict,
+                               unsigned int numThreads)
+{
+    if (!dict)
+    {
+        return -1;
+    }
+
+    return scrSetParallelism(dict->runner, numThreads);
+}
+
+int spellCheckerCompileDictionary(SpellCheckerDictionaryHandle dict,
+                                  const char *path)
+{
+    if (!dict || !path)
+    {
+        return -1;
+    }
+
+    return scrCompile(dict->runner, path);
+}
@@ -1,116 +1,1145 @@
-#ifndef __SPELL_CHECKER_H
-#define __SPELL_CHECKER_H
-
-/**
- * Abstract type used to represent a handle to a dictionary that 
- * is being constructed or is being used to spell-check. 
- */
-struct _SpellCheckerDictionary;
-typedef struct _SpellCheckerDictionary *SpellCheckerDictionaryHandle;
-
-/**
- * Prototype for a callback function that is invoked by 
- * spellCheck() for each misspelled word found in the supplied 
- * text, in the order that such misspelled words appear in the 
- * text (including potential duplicates). This function is 
- * implemented by the caller of spellCheck(). 
- *  
- * @param unmatchedWord 
- *    A null-terminated character string containing a word that
- *    was not found in the dictionary. English alphabetic
- *    characters are trivially normalized to lower-case (A-Z are
- *    mapped to a-z, respectively). The word contains only
- *    characters in the range [0-9a-z] and extended characters
- *    in the range 0x80-0xFF.
- */
-typedef void (*SpellCheckerCallback)(
-    const char *unmatchedWord);
-
-/**
- * This function creates a new, empty spell-checker dictionary 
- * to which new words can be added.
- * 
- * @return SpellCheckerDictionaryHandle 
- *             An opaque handle used to represent the dictionary
- *             in subsequent calls. The handle remains valid
- *             until closeSpellCheckerDictionary() is called.
- *  
- *             Returns NULL on error.
- */
-SpellCheckerDictionaryHandle createSpellCheckerDictionary();
-
-/**
- * Closes a dictionary previously created with 
- * createSpellCheckerDictionary(). All resources associated with 
- * the dictionary are freed, and the handle becomes invalid. 
- * 
- * @param dict 
- *    An open dictionary handle previously created with
- *    createSpellCheckerDictionary().
- *  
- * @return int 
- *    0 if the handle was successfully closed. -1 on error.
- */
-int closeSpellCheckerDictionary(
-    SpellCheckerDictionaryHandle dict);
-
-/**
- * Adds a valid word to an open dictionary previously created 
- * with spellCheckerCreateDictionary(). 
- * 
- * @param dict 
- *    An open dictionary handle previously returned from
- *    createSpellCheckerDictionary().
- *  
- * @param word 
- *    A null-terminated string containing a valid word to be
- *    added to the dictionary. Letters in the range [A-Z] are
- *    treated as equivalent to those in the range [a-z]. The
- *    word must contain only letters in the range [0-9a-zA-Z]
- *    and extended characters in the range 0x80-0xFF, or the
- *    word is rejected and false is returned. The word may be a
- *    duplicate of a word already in the dictionary, in which
- *    case it is accepted without error or effect.
- * 
- * @return int 
- *    0 if the word was accepted and either already existed in
- *    the dictionary or was successfully added. -1 otherwise.
- */
-int spellCheckerAddWord(
-    SpellCheckerDictionaryHandle dict,
-    const char *word);
-
-/**
- * Spellcheck a text document, using a dictionary previously 
- * created with spellCheckerCreateDictionary() and populated 
- * with spellCheckerAddWord(). For each misspelled word, invoke 
- * a callback function supplied by the caller, in the same order
- * in which the misspellings occur in the document. 
- * 
- * @param dict 
- *    An open dictionary handle previously returned from
- *    createSpellCheckerDictionary(), and populated with valid
- *    words using spellCheckerAddWord().
- *     
- * @param text 
- *    A null-terminated string containing text to be
- *    spell-checked. All characters other than those in the
- *    range [0-9a-zA-Z], or extended characters in the range
- *    0x80-0xFF, are considered to be delimeters that seperate
- *    words. Letters in the range [a-z] are considered to be
- *    equivalent to those in the range [A-Z] for the purposes of
- *    spelling.
- *  
- * @param callback 
- *    A function provided by the caller that should be invoked
- *    for each misspelled word in the provided text, in the same
- *    order in which the misspellings occur. Duplicate
- *    misspellings are not filtered out.
- */
-void spellCheck(
-    SpellCheckerDictionaryHandle dict,
-    const char *text,
-    SpellCheckerCallback callback);
-
-#endif
-
+#ifndef __SPELL_CHECKER_H
+#define __SPELL_CHECKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Abstract type used to represent a handle to a dictionary that 
+ * is being constructed or is being used to spell-check. 
+ */
+struct _SpellCheckerDictionary;
+typedef struct _SpellCheckerDictionary *SpellCheckerDictionaryHandle;
+
+/**
+ * Prototype for a callback function that is invoked by 
+ * spellCheck() for each misspelled word found in the supplied 
+ * text, in the order that such misspelled words appear in the 
+ * text (including potential duplicates). This function is 
+ * implemented by the caller of spellCheck(). 
+ *  
+ * @param unmatchedWord 
+ *    A null-terminated character string containing a word that
+ *    was not found in the dictionary. English alphabetic
+ *    characters are trivially normalized to lower-case (A-Z are
+ *    mapped to a-z, respectively). The word contains only
+ *    characters in the range [0-9a-z] and extended characters
+ *    in the range 0x80-0xFF.
+ */
+typedef void (*SpellCheckerCallback)(
+    const char *unmatchedWord);
+
+/**
+ * Prototype for a callback function that is invoked by 
+ * spellCheckSpan() for each misspelled word found in the 
+ * supplied text, in the order that such misspelled words appear 
+ * in the text (including potential duplicates). 
+ *  
+ * @param word 
+ *    A pointer to the misspelled word, inside the caller's
+ *    text. The word is not null-terminated, and is reported as
+ *    it appears in the text (it is not normalized).
+ *  
+ * @param length 
+ *    The length of the word, in bytes.
+ *  
+ * @param offset 
+ *    The offset of the word from the start of the text, in
+ *    bytes.
+ *  
+ * @param userdata 
+ *    The pointer passed to spellCheckSpan().
+ */
+typedef void (*SpellCheckerSpanCallback)(
+    const char *word,
+    size_t length,
+    size_t offset,
+    void *userdata);
+
+/**
+ * Abstract type used to represent a handle to a spell-check 
+ * started with spellCheckAsync(). 
+ */
+struct _SpellCheckerJob;
+typedef struct _SpellCheckerJob *SpellCheckerJobHandle;
+
+/**
+ * Abstract type used to represent a handle to a spell-check 
+ * started with spellCheckBegin(). 
+ */
+struct _SpellCheckerStream;
+typedef struct _SpellCheckerStream *SpellCheckerStreamHandle;
+
+/**
+ * Abstract type used to represent a handle to a pool of threads 
+ * shared by dictionaries, see createSpellCheckerExecutor(). 
+ */
+struct _SpellCheckerExecutor;
+typedef struct _SpellCheckerExecutor *SpellCheckerExecutorHandle;
+
+/**
+ * The states a spell-check job goes through. 
+ *  
+ * SPELL_CHECKER_JOB_PENDING 
+ *    Queued, waiting for the previous operations on the
+ *    dictionary to be done.
+ * SPELL_CHECKER_JOB_RUNNING 
+ *    Being checked, misspellings are being reported.
+ * SPELL_CHECKER_JOB_DONE 
+ *    All the misspellings were reported.
+ * SPELL_CHECKER_JOB_CANCELLED 
+ *    Cancelled with spellCheckerJobCancel() before it was done.
+ *    Some of the misspellings may have been reported.
+ */
+typedef enum SpellCheckerJobStatus
+{
+    SPELL_CHECKER_JOB_PENDING,
+    SPELL_CHECKER_JOB_RUNNING,
+    SPELL_CHECKER_JOB_DONE,
+    SPELL_CHECKER_JOB_CANCELLED
+} SpellCheckerJobStatus;
+
+/**
+ * Prototype for a callback function that is invoked once a job 
+ * is done or cancelled, after the last misspelling was 
+ * reported, and before spellCheckerJobWait() returns. 
+ *  
+ * @param job 
+ *    The job. It remains valid until released.
+ *  
+ * @param status 
+ *    SPELL_CHECKER_JOB_DONE or SPELL_CHECKER_JOB_CANCELLED.
+ *  
+ * @param userdata 
+ *    The pointer passed to spellCheckAsync().
+ */
+typedef void (*SpellCheckerJobCallback)(
+    SpellCheckerJobHandle job,
+    SpellCheckerJobStatus status,
+    void *userdata);
+
+/**
+ * The data structures available for storing the words of a 
+ * dictionary. 
+ *  
+ * SPELL_CHECKER_BACKEND_TRIE 
+ *    A Trie. Fast adds and lookups. The default.
+ * SPELL_CHECKER_BACKEND_HASH 
+ *    An open-addressing hash set. Fastest lookups for large
+ *    dictionaries, memory grows with the total length of the
+ *    words.
+ * SPELL_CHECKER_BACKEND_DAWG 
+ *    A minimized word graph, sharing prefixes and suffixes. The
+ *    smallest in memory, but rebuilt each time the words added
+ *    are committed (whenever the dictionary is done processing
+ *    the words queued so far), so best for dictionaries that
+ *    are loaded once, in bulk.
+ */
+typedef enum SpellCheckerBackend
+{
+    SPELL_CHECKER_BACKEND_TRIE,
+    SPELL_CHECKER_BACKEND_HASH,
+    SPELL_CHECKER_BACKEND_DAWG
+} SpellCheckerBackend;
+
+/**
+ * How a dictionary splits text into words, and compares them. 
+ *  
+ * SPELL_CHECKER_ENCODING_BYTES 
+ *    Words are made of the characters [0-9a-zA-Z] and of any
+ *    byte in the range 0x80-0xFF, A-Z are equivalent to a-z.
+ *    The default.
+ * SPELL_CHECKER_ENCODING_UTF8 
+ *    Words are made of UTF-8 letters, combining marks and
+ *    decimal digits (Unicode general categories L, M and Nd),
+ *    anything else (punctuation, dashes, non-breaking spaces,
+ *    ...) is a delimiter. Words are equivalent under Unicode
+ *    simple case folding ("Éclair" and "éclair" are the same
+ *    word, while "ß" does not match "ss"). Bytes that are not
+ *    valid UTF-8 are taken one at a time, as in byte mode.
+ *    Text that is all ASCII is checked about as fast as in byte
+ *    mode. Suggestions and completions are returned case
+ *    folded, and suggestion distances count bytes.
+ */
+typedef enum SpellCheckerEncoding
+{
+    SPELL_CHECKER_ENCODING_BYTES,
+    SPELL_CHECKER_ENCODING_UTF8
+} SpellCheckerEncoding;
+
+/**
+ * What a dictionary does when an operation is posted while its 
+ * queue of pending operations is full. 
+ *  
+ * SPELL_CHECKER_QUEUE_BLOCK 
+ *    Wait until the dictionary is done with enough of the
+ *    pending operations to make room. The default. Callbacks
+ *    (which run on the dictionary's own thread) cannot wait,
+ *    and fail instead.
+ * SPELL_CHECKER_QUEUE_FAIL 
+ *    Fail right away: the operation returns -1 (or NULL), and
+ *    has no effect.
+ * SPELL_CHECKER_QUEUE_DROP 
+ *    Drop the operation, but report success: the words are not
+ *    added, and the text is not checked (the job returned by
+ *    spellCheckAsync() is already cancelled).
+ *  
+ * The policy applies to spellCheckerAddWord(), 
+ * spellCheckerAddWordWithFrequency(), spellCheckerAddWords(), 
+ * spellCheck() and spellCheckAsync(). 
+ * The other operations always wait. 
+ */
+typedef enum SpellCheckerQueuePolicy
+{
+    SPELL_CHECKER_QUEUE_BLOCK,
+    SPELL_CHECKER_QUEUE_FAIL,
+    SPELL_CHECKER_QUEUE_DROP
+} SpellCheckerQueuePolicy;
+
+/**
+ * The settings of a new dictionary, see 
+ * createSpellCheckerDictionaryWithOptions(). 
+ *  
+ * backend 
+ *    The data structure storing the words.
+ * queueDepth 
+ *    The maximal number of operations waiting to be processed,
+ *    rounded up to a power of two, or 0 for the default (1024).
+ *    The queue is allocated once, when the dictionary is
+ *    created.
+ * queuePolicy 
+ *    What to do when the queue is full.
+ * suggestIndexDistance 
+ *    0 for no suggestion index, or the maximal distance (at most
+ *    3) that spellCheckerSuggest() answers from an index of the
+ *    words, instead of searching the whole dictionary. Lookups
+ *    become much faster, at the cost of memory and slower adds.
+ *    The index is also stored in compiled images.
+ * suggestIndexBudget 
+ *    The maximal memory of the suggestion index in bytes, or 0
+ *    for no limit. Past it, the index is dropped and
+ *    suggestions search the dictionary again.
+ * lookupCacheSize 
+ *    0 for no lookup cache, or the memory in bytes of the cache
+ *    each thread checking words keeps. It remembers whether the
+ *    recent words are spelled correctly or not, which speeds up
+ *    texts that repeat the same words. Adding words invalidates
+ *    the caches. See spellCheckerGetCacheStats() to size them.
+ * executor 
+ *    NULL for a thread of the dictionary's own (the default),
+ *    or the executor (see createSpellCheckerExecutor()) whose
+ *    threads process the dictionary's operations.
+ * encoding 
+ *    How text is split into words. Images compiled from the
+ *    dictionary keep it, and overlays take the one of their
+ *    base.
+ */
+typedef struct SpellCheckerOptions
+{
+    SpellCheckerBackend backend;
+    size_t queueDepth;
+    SpellCheckerQueuePolicy queuePolicy;
+    unsigned int suggestIndexDistance;
+    size_t suggestIndexBudget;
+    size_t lookupCacheSize;
+    SpellCheckerExecutorHandle executor;
+    SpellCheckerEncoding encoding;
+} SpellCheckerOptions;
+
+/**
+ * The counters of the lookup caches of a dictionary, summed 
+ * over all the threads, see spellCheckerGetCacheStats(). 
+ *  
+ * hits 
+ *    The number of words answered by a cache.
+ * misses 
+ *    The number of words looked up in the dictionary (and then
+ *    remembered by a cache).
+ */
+typedef struct SpellCheckerCacheStats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+} SpellCheckerCacheStats;
+
+/**
+ * The counters of a dictionary, see spellCheckerGetStats(). 
+ *  
+ * numWords 
+ *    The number of words the dictionary accepts.
+ * numNodes 
+ *    The number of nodes of the trie or DAWG storing the words,
+ *    0 for the hash backend.
+ * bytes 
+ *    The memory held by the words, including the suggestion
+ *    index and the frequencies (or the size of the mapped image).
+ * queueDepth 
+ *    The number of operations waiting to be processed.
+ * maxQueueDepth 
+ *    The largest queueDepth seen so far (the high-water mark).
+ * numMessages 
+ *    The number of operations processed.
+ * numTokens 
+ *    The number of words checked, by all the spell-check
+ *    functions (spellCheckerHasWord() lookups are not counted).
+ * numMisspellings 
+ *    The number of misspelled words found (and reported).
+ * runnerTimeNs 
+ *    The time the dictionary's thread spent processing
+ *    operations, in nanoseconds. Dividing by the time elapsed
+ *    gives its utilization.
+ */
+typedef struct SpellCheckerStats
+{
+    unsigned long long numWords;
+    unsigned long long numNodes;
+    unsigned long long bytes;
+    unsigned long long queueDepth;
+    unsigned long long maxQueueDepth;
+    unsigned long long numMessages;
+    unsigned long long numTokens;
+    unsigned long long numMisspellings;
+    unsigned long long runnerTimeNs;
+} SpellCheckerStats;
+
+/**
+ * This function creates a new, empty spell-checker dictionary 
+ * to which new words can be added.
+ * 
+ * @return SpellCheckerDictionaryHandle 
+ *             An opaque handle used to represent the dictionary
+ *             in subsequent calls. The handle remains valid
+ *             until closeSpellCheckerDictionary() is called.
+ *  
+ *             Returns NULL on error.
+ */
+SpellCheckerDictionaryHandle createSpellCheckerDictionary();
+
+/**
+ * Same as createSpellCheckerDictionary(), using the given data 
+ * structure to store the words of the dictionary. 
+ *  
+ * @param backend 
+ *    The data structure to use.
+ *  
+ * @return SpellCheckerDictionaryHandle 
+ *    An opaque handle used to represent the dictionary, or NULL
+ *    on error (including an unknown backend).
+ */
+SpellCheckerDictionaryHandle createSpellCheckerDictionaryWithBackend(
+    SpellCheckerBackend backend);
+
+/**
+ * Same as createSpellCheckerDictionary(), with the given 
+ * settings. 
+ *  
+ * @param options 
+ *    The settings of the dictionary, copied before this
+ *    function returns.
+ *  
+ * @return SpellCheckerDictionaryHandle 
+ *    An opaque handle used to represent the dictionary, or NULL
+ *    on error (including invalid options).
+ */
+SpellCheckerDictionaryHandle createSpellCheckerDictionaryWithOptions(
+    const SpellCheckerOptions *options);
+
+/**
+ * Creates an executor: a pool of threads that any number of 
+ * dictionaries can share (see SpellCheckerOptions), instead of 
+ * each dictionary having a thread of its own, which adds up when 
+ * there are many dictionaries (e.g. one per tenant or per 
+ * language), most of them idle. 
+ *  
+ * The operations posted to a dictionary (adding words, 
+ * spellCheck(), spellCheckAsync(), ...) are still processed one 
+ * at a time, in the order they were posted, and their callbacks 
+ * are invoked from one thread at a time; only that thread is any 
+ * of the executor's. A dictionary with many operations pending 
+ * lets the other dictionaries process theirs every so often. 
+ * Since the threads are shared, callbacks should not block: a 
+ * blocked callback holds one of the threads until it returns. 
+ * 
+ * @param numThreads 
+ *    The number of threads, 0 for one per online CPU.
+ *  
+ * @return SpellCheckerExecutorHandle 
+ *    An opaque handle used to represent the executor, or NULL on
+ *    error.
+ */
+SpellCheckerExecutorHandle createSpellCheckerExecutor(
+    unsigned int numThreads);
+
+/**
+ * Closes an executor. Its threads are stopped once the last 
+ * dictionary using it is closed, the handle becomes invalid 
+ * right away. 
+ * 
+ * @param executor 
+ *    An executor handle previously returned from
+ *    createSpellCheckerExecutor().
+ *  
+ * @return int 
+ *    0 if the handle was successfully closed. -1 on error.
+ */
+int closeSpellCheckerExecutor(
+    SpellCheckerExecutorHandle executor);
+
+/**
+ * Closes a dictionary previously created with 
+ * createSpellCheckerDictionary(). All resources associated with 
+ * the dictionary are freed, and the handle becomes invalid. 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously created with
+ *    createSpellCheckerDictionary().
+ *  
+ * @return int 
+ *    0 if the handle was successfully closed. -1 on error.
+ */
+int closeSpellCheckerDictionary(
+    SpellCheckerDictionaryHandle dict);
+
+/**
+ * Adds a valid word to an open dictionary previously created 
+ * with spellCheckerCreateDictionary(). 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously returned from
+ *    createSpellCheckerDictionary().
+ *  
+ * @param word 
+ *    A null-terminated string containing a valid word to be
+ *    added to the dictionary. Letters in the range [A-Z] are
+ *    treated as equivalent to those in the range [a-z]. The
+ *    word must contain only letters in the range [0-9a-zA-Z]
+ *    and extended characters in the range 0x80-0xFF (or, for a
+ *    UTF-8 dictionary, only characters that the dictionary's
+ *    SpellCheckerEncoding makes word characters), or the
+ *    word is rejected and false is returned. The word may be a
+ *    duplicate of a word already in the dictionary, in which
+ *    case it is accepted without error or effect.
+ * 
+ * @return int 
+ *    0 if the word was accepted and either already existed in
+ *    the dictionary or was successfully added. -1 otherwise.
+ */
+int spellCheckerAddWord(
+    SpellCheckerDictionaryHandle dict,
+    const char *word);
+
+/**
+ * Same as spellCheckerAddWord(), also giving the frequency of 
+ * the word: how common it is, e.g. its number of occurrences in 
+ * a corpus. Adding a word again replaces its frequency. 
+ *  
+ * Suggestions at the same distance are ranked by frequency, and 
+ * the most frequent words (the first few thousands) are kept 
+ * apart in a small table, checked before the rest of the 
+ * dictionary, which makes looking them up faster. 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously returned from
+ *    createSpellCheckerDictionary().
+ *  
+ * @param word 
+ *    The word to add, as in spellCheckerAddWord().
+ *  
+ * @param frequency 
+ *    The frequency of the word. Words added without a frequency
+ *    have a frequency of 0.
+ * 
+ * @return int 
+ *    0 if the word was accepted. -1 otherwise.
+ */
+int spellCheckerAddWordWithFrequency(
+    SpellCheckerDictionaryHandle dict,
+    const char *word,
+    unsigned int frequency);
+
+/**
+ * Adds a batch of valid words to an open dictionary. This is 
+ * equivalent to calling spellCheckerAddWord() for each word, 
+ * but the whole batch is handed to the dictionary at once, 
+ * which is much faster for large word lists. Loading words in 
+ * sorted order is faster still. 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously returned from
+ *    createSpellCheckerDictionary().
+ *  
+ * @param buf 
+ *    The words, separated by newlines ('\n', optionally
+ *    preceded by '\r'). The buffer does not have to be
+ *    null-terminated, and is copied before this function
+ *    returns. Empty lines are ignored. Each word follows the
+ *    rules of spellCheckerAddWord(): invalid words are rejected
+ *    without affecting the rest of the batch.
+ *  
+ * @param len 
+ *    The size of buf, in bytes.
+ * 
+ * @return int 
+ *    0 if the batch was accepted. -1 otherwise.
+ */
+int spellCheckerAddWords(
+    SpellCheckerDictionaryHandle dict,
+    const char *buf,
+    size_t len);
+
+/**
+ * Removes a word from an open dictionary. Like an added word, 
+ * the removal is processed asynchronously: the word stops being 
+ * found once the dictionary has processed it. Its frequency is 
+ * reset, and it is no longer suggested. The memory the word 
+ * used is reclaimed, once no lookup can be reading it anymore. 
+ * Removing a word that is not in the dictionary does nothing. 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously returned from
+ *    createSpellCheckerDictionary().
+ *  
+ * @param word 
+ *    The word to remove, as in spellCheckerAddWord().
+ * 
+ * @return int 
+ *    0 if the removal was accepted. -1 otherwise (including for
+ *    a dictionary opened with openSpellCheckerDictionaryMapped()).
+ */
+int spellCheckerRemoveWord(
+    SpellCheckerDictionaryHandle dict,
+    const char *word);
+
+/**
+ * Replaces the words of a dictionary, at once, with the words 
+ * of another dictionary: typically a new version of the word 
+ * list, built (and indexed) in the background with the usual 
+ * functions, while the dictionary keeps serving checks. 
+ * 
+ * Once the operations posted to both dictionaries before this 
+ * call are processed, the replacement's words (along with their 
+ * frequencies and suggestion index) are published with a single 
+ * pointer swap. Checks and lookups never wait for it: those 
+ * that started before the swap complete against the previous 
+ * words, those that start after see the new ones, and no check 
+ * sees a mix of both. The previous words are freed once the 
+ * checks using them are done. 
+ * 
+ * The settings of the dictionary (queue, lookup caches, 
+ * parallelism) are kept. It becomes read-only if the 
+ * replacement was opened with openSpellCheckerDictionaryMapped(), 
+ * and writable otherwise. 
+ * 
+ * Must not be called from a callback of either dictionary, nor 
+ * on overlays or on the base of overlays (see 
+ * createSpellCheckerOverlay()). 
+ * 
+ * @param dict 
+ *    The open dictionary whose words are replaced.
+ *  
+ * @param replacement 
+ *    An open dictionary holding the new words. Unless -1 is
+ *    returned it is closed, and the handle becomes invalid.
+ * 
+ * @return int 
+ *    0 once the new words are in use. -1 on error, in which
+ *    case both dictionaries are left untouched. 1 if the new
+ *    words could not be published once taken from the
+ *    replacement, in which case dict is left untouched, and the
+ *    replacement is closed as on success.
+ */
+int spellCheckerSwapDictionary(
+    SpellCheckerDictionaryHandle dict,
+    SpellCheckerDictionaryHandle replacement);
+
+/**
+ * Spellcheck a text document, using a dictionary previously 
+ * created with spellCheckerCreateDictionary() and populated 
+ * with spellCheckerAddWord(). For each misspelled word, invoke 
+ * a callback function supplied by the caller, in the same order
+ * in which the misspellings occur in the document. 
+ * 
+ * @param dict 
+ *    An open dictionary handle previously returned from
+ *    createSpellCheckerDictionary(), and populated with valid
+ *    words using spellCheckerAddWord().
+ *     
+ * @param text 
+ *    A null-terminated string containing text to be
+ *    spell-checked. All characters other than those in the
+ *    range [0-9a-zA-Z], or extended characters in the range
+ *    0x80-0xFF, are considered to be delimeters that seperate
+ *    words. Letters in the range [a-z] are considered to be
+ *    equivalent to those in the range [A-Z] for the purposes of
+ *    spelling. UTF-8 dictionaries split and compare words as
+ *    described in SpellCheckerEncoding.
+ *  
+ * @param callback 
+ *    A function provided by the caller that should be invoked
+ *    for each misspelled word in the provided text, in the same
+ *    order in which the misspellings occur. Duplicate
+ *    misspellings are not filtered out.
+ */
+void spellCheck(
+    SpellCheckerDictionaryHandle dict,
+    const char *text,
+    SpellCheckerCallback callback);
+
+/**
+ * Spellcheck a text asynchronously, like spellCheck(), tracking 
+ * the spell-check with a job that can be waited for, polled, or 
+ * cancelled. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *     
+ * @param text 
+ *    The text to be spell-checked. It does not have to be
+ *    null-terminated, and is copied before this function
+ *    returns. Words are delimited as in spellCheck().
+ *  
+ * @param len 
+ *    The size of the text, in bytes.
+ *  
+ * @param callback 
+ *    A function provided by the caller that is invoked for each
+ *    misspelled word in the text, in the same order in which
+ *    the misspellings occur. The word points into a copy of the
+ *    text, valid during the callback only.
+ *  
+ * @param onComplete 
+ *    A function invoked once the job is done or cancelled, or
+ *    NULL.
+ *  
+ * @param userdata 
+ *    An opaque pointer passed as is to the callbacks.
+ * 
+ * @return SpellCheckerJobHandle 
+ *    A handle to the job, to be released with
+ *    spellCheckerJobRelease(), or NULL on error (in which case
+ *    no callback is invoked).
+ */
+SpellCheckerJobHandle spellCheckAsync(
+    SpellCheckerDictionaryHandle dict,
+    const char *text,
+    size_t len,
+    SpellCheckerSpanCallback callback,
+    SpellCheckerJobCallback onComplete,
+    void *userdata);
+
+/**
+ * Waits for a job to be done or cancelled. Once this function 
+ * returns 0, no more callbacks are invoked for the job, and the 
+ * state they use can be freed. 
+ *  
+ * @param job 
+ *    A job returned by spellCheckAsync().
+ *  
+ * @param timeoutMs 
+ *    The maximal time to wait, in milliseconds. 0 only polls
+ *    the job, and a negative value waits for as long as it
+ *    takes.
+ * 
+ * @return int 
+ *    0 if the job is done or cancelled. -1 on timeout or error.
+ */
+int spellCheckerJobWait(
+    SpellCheckerJobHandle job,
+    long timeoutMs);
+
+/**
+ * Gets the current status of a job, without waiting. 
+ *  
+ * @param job 
+ *    A job returned by spellCheckAsync().
+ * 
+ * @return SpellCheckerJobStatus 
+ *    The status of the job.
+ */
+SpellCheckerJobStatus spellCheckerJobGetStatus(
+    SpellCheckerJobHandle job);
+
+/**
+ * Cancels a job. A job that did not start yet is cancelled 
+ * right away (its completion callback is invoked from this 
+ * function), a running job stops reporting misspellings 
+ * shortly after. Cancelling a job that is done has no effect. 
+ * Wait for the job to know when it is actually cancelled. 
+ *  
+ * @param job 
+ *    A job returned by spellCheckAsync().
+ * 
+ * @return int 
+ *    0 on success. -1 on error.
+ */
+int spellCheckerJobCancel(
+    SpellCheckerJobHandle job);
+
+/**
+ * Releases a job handle. The job itself is not cancelled, and 
+ * runs to completion. 
+ *  
+ * @param job 
+ *    A job returned by spellCheckAsync(). The handle becomes
+ *    invalid.
+ */
+void spellCheckerJobRelease(
+    SpellCheckerJobHandle job);
+
+/**
+ * Spellcheck a text synchronously, from the calling thread. 
+ * Unlike spellCheck(), the text is neither copied nor modified, 
+ * and all the callbacks have been invoked when this function 
+ * returns. Lookups do not take any lock: any number of threads 
+ * can check texts at once, while words are being added (see 
+ * spellCheckerHasWord() for when added words become visible). 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *     
+ * @param text 
+ *    The text to be spell-checked. It does not have to be
+ *    null-terminated. Words are delimited as in spellCheck().
+ *  
+ * @param len 
+ *    The size of the text, in bytes.
+ *  
+ * @param callback 
+ *    A function provided by the caller that is invoked, from
+ *    the calling thread, for each misspelled word in the text,
+ *    in the same order in which the misspellings occur.
+ *  
+ * @param userdata 
+ *    An opaque pointer passed as is to the callback.
+ * 
+ * @return int 
+ *    0 if the text was checked. -1 on error (in which case the
+ *    callback is not invoked).
+ */
+int spellCheckSpan(
+    SpellCheckerDictionaryHandle dict,
+    const char *text,
+    size_t len,
+    SpellCheckerSpanCallback callback,
+    void *userdata);
+
+/**
+ * Starts spell-checking a text given in chunks, e.g. a file 
+ * too large to be read at once, or data read from a socket. 
+ * Like spellCheckSpan(), the chunks are checked synchronously, 
+ * from the calling thread, without being copied or modified. 
+ * A word may span chunks: only the word a chunk ends with is 
+ * copied (up to 4096 bytes), so a stream checks any amount of 
+ * text in constant memory. 
+ * 
+ * @param dict 
+ *    An open dictionary handle. It must stay open until
+ *    spellCheckEnd() is called.
+ *  
+ * @param callback 
+ *    A function provided by the caller that is invoked, from
+ *    the thread feeding the stream, for each misspelled word,
+ *    in the same order in which the misspellings occur. The
+ *    offset it is given is from the start of the stream. The
+ *    word is valid during the callback only. A word longer
+ *    than 4096 bytes is reported as misspelled, truncated to
+ *    its first 4096 bytes.
+ *  
+ * @param userdata 
+ *    An opaque pointer passed as is to the callback.
+ * 
+ * @return SpellCheckerStreamHandle 
+ *    A handle to pass to spellCheckFeed() and spellCheckEnd().
+ *    NULL on error.
+ */
+SpellCheckerStreamHandle spellCheckBegin(
+    SpellCheckerDictionaryHandle dict,
+    SpellCheckerSpanCallback callback,
+    void *userdata);
+
+/**
+ * Spellcheck the next chunk of a stream. The misspelled words 
+ * the chunk completes are reported before this function 
+ * returns, except for the word it ends with, which the next 
+ * chunk may continue. 
+ * 
+ * @param stream 
+ *    A stream started with spellCheckBegin().
+ *  
+ * @param chunk 
+ *    The next bytes of the text, of any size. It does not have
+ *    to be null-terminated.
+ *  
+ * @param len 
+ *    The size of the chunk, in bytes.
+ * 
+ * @return int 
+ *    0 if the chunk was checked. -1 on error.
+ */
+int spellCheckFeed(
+    SpellCheckerStreamHandle stream,
+    const char *chunk,
+    size_t len);
+
+/**
+ * Ends a stream: the last word of the text is checked, and the 
+ * stream is released. 
+ * 
+ * @param stream 
+ *    A stream started with spellCheckBegin(). The handle
+ *    becomes invalid.
+ * 
+ * @return int 
+ *    0 if the last word was checked. -1 on error.
+ */
+int spellCheckEnd(
+    SpellCheckerStreamHandle stream);
+
+/**
+ * Spellcheck a file. The file is mapped into memory read-only, 
+ * and checked in place: it is neither read into a buffer, nor 
+ * copied, nor modified. Like spellCheckAsync(), the file is 
+ * checked by the dictionary's thread (and split among worker 
+ * threads, see spellCheckerSetParallelism()), after the 
+ * operations requested before, but this function only returns 
+ * once all the callbacks have been invoked. It must not be 
+ * called from a callback. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *     
+ * @param path 
+ *    The file to be spell-checked. Words are delimited as in
+ *    spellCheck().
+ *  
+ * @param callback 
+ *    A function provided by the caller that is invoked, from
+ *    the dictionary's thread, for each misspelled word in the
+ *    file, in the same order in which the misspellings occur.
+ *    The word points into the mapping, which is valid during
+ *    the callback only, and the offset is from the start of
+ *    the file.
+ *  
+ * @param userdata 
+ *    An opaque pointer passed as is to the callback.
+ * 
+ * @return int 
+ *    0 if the whole file was checked. -1 on error, or if the
+ *    check was dropped (see SPELL_CHECKER_QUEUE_DROP).
+ */
+int spellCheckFile(
+    SpellCheckerDictionaryHandle dict,
+    const char *path,
+    SpellCheckerSpanCallback callback,
+    void *userdata);
+
+/**
+ * Checks whether a single word is in a dictionary. Unlike 
+ * spellCheck(), the lookup is made synchronously, from the 
+ * calling thread, without taking any lock: any number of 
+ * threads can look up words at once, while words are being 
+ * added. 
+ *  
+ * Words added with spellCheckerAddWord() or 
+ * spellCheckerAddWords() are visible once the dictionary has 
+ * processed them, which happens asynchronously. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param word 
+ *    A null-terminated word. Letters in the range [A-Z] are
+ *    treated as equivalent to those in the range [a-z].
+ * 
+ * @return int 
+ *    1 if the word is in the dictionary, 0 if it is not, -1 on
+ *    error.
+ */
+int spellCheckerHasWord(
+    SpellCheckerDictionaryHandle dict,
+    const char *word);
+
+/**
+ * Checks whether each word of a batch is in a dictionary, like 
+ * spellCheckerHasWord(), for callers that split texts into 
+ * words on their own. The words are looked up together, which 
+ * hides most of the memory latency of each lookup: a batch of 
+ * words is looked up faster than the same words one by one. 
+ * The lookup caches (see SpellCheckerOptions) are not used. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param words 
+ *    The words to look up. They do not have to be
+ *    null-terminated.
+ *  
+ * @param lens 
+ *    The length of each word, in bytes.
+ *  
+ * @param numWords 
+ *    The number of words.
+ *  
+ * @param results 
+ *    Filled with 1 for each word that is in the dictionary, and
+ *    0 for each word that is not.
+ * 
+ * @return int 
+ *    0 on success. -1 on error.
+ */
+int spellCheckerHasWords(
+    SpellCheckerDictionaryHandle dict,
+    const char **words,
+    const size_t *lens,
+    size_t numWords,
+    uint8_t *results);
+
+/**
+ * Suggests corrections for a word: the words of a dictionary 
+ * closest to it, by edit distance (the number of characters 
+ * inserted, deleted, replaced, or swapped with the next one). 
+ * Like spellCheckerHasWord(), the search is made synchronously, 
+ * from the calling thread, without taking any lock. 
+ *  
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param word 
+ *    A null-terminated string, typically a misspelled word.
+ *    Letters are compared as in spellCheck().
+ *  
+ * @param maxDistance 
+ *    The maximal edit distance of a suggestion from the word.
+ *    The larger it is, the longer the search takes: 1 or 2 is
+ *    typical. Up to the suggestIndexDistance of the
+ *    dictionary, the search only takes a few lookups.
+ *  
+ * @param maxResults 
+ *    The maximal number of suggestions (at most 256).
+ *  
+ * @param out 
+ *    An array with room for maxResults words, filled with the
+ *    suggestions, closest first (then most frequent first, then
+ *    in alphabetical order).
+ *    Each suggestion is a lower-case, null-terminated string
+ *    that must be released with free().
+ * 
+ * @return int 
+ *    The number of suggestions. -1 on error.
+ */
+int spellCheckerSuggest(
+    SpellCheckerDictionaryHandle dict,
+    const char *word,
+    unsigned int maxDistance,
+    size_t maxResults,
+    char **out);
+
+/**
+ * Checks whether any word of a dictionary starts with a prefix. 
+ * Only whole words are in a dictionary: once "international" 
+ * is added, spellCheckerHasWord() rejects "inter", but this 
+ * function accepts it. Like spellCheckerHasWord(), the lookup 
+ * is made synchronously, from the calling thread. 
+ *  
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param prefix 
+ *    A null-terminated prefix. Letters are compared as in
+ *    spellCheckerHasWord(). A word is a prefix of itself.
+ * 
+ * @return int 
+ *    1 if a word of the dictionary starts with the prefix, 0 if
+ *    none does, -1 on error.
+ */
+int spellCheckerHasPrefix(
+    SpellCheckerDictionaryHandle dict,
+    const char *prefix);
+
+/**
+ * Completes a prefix: finds the words of a dictionary that 
+ * start with it, e.g. to suggest words as they are typed. The 
+ * trie and DAWG backends only walk as many words as they 
+ * return, the hash backend walks all its words. Like 
+ * spellCheckerHasWord(), the search is made synchronously, 
+ * from the calling thread. 
+ *  
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param prefix 
+ *    A null-terminated prefix, compared as in
+ *    spellCheckerHasPrefix().
+ *  
+ * @param maxResults 
+ *    The maximal number of words (at most 256).
+ *  
+ * @param out 
+ *    An array with room for maxResults words, filled with the
+ *    first words that start with the prefix, in alphabetical
+ *    order (the prefix itself first, if it is a word).
+ *    Each word is a lower-case, null-terminated string that
+ *    must be released with free().
+ * 
+ * @return int 
+ *    The number of words. -1 on error.
+ */
+int spellCheckerComplete(
+    SpellCheckerDictionaryHandle dict,
+    const char *prefix,
+    size_t maxResults,
+    char **out);
+
+/**
+ * Gets the counters of the lookup caches of a dictionary (see 
+ * SpellCheckerOptions.lookupCacheSize). A hit rate well below 
+ * the rate at which words repeat in the checked texts suggests 
+ * a larger cache. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param stats 
+ *    Filled with the counters, all 0 without caches.
+ * 
+ * @return int 
+ *    0 on success. -1 on error.
+ */
+int spellCheckerGetCacheStats(
+    SpellCheckerDictionaryHandle dict,
+    SpellCheckerCacheStats *stats);
+
+/**
+ * Gets the counters of a dictionary. The counters are always 
+ * kept, and cheap enough to be read periodically: each thread 
+ * counts on its own, and the counts are summed on read. Each 
+ * counter is consistent on its own, but they may not all be 
+ * from the same instant. The size of the dictionary is as of 
+ * the last operation processed. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param stats 
+ *    Filled with the counters.
+ * 
+ * @return int 
+ *    0 on success. -1 on error.
+ */
+int spellCheckerGetStats(
+    SpellCheckerDictionaryHandle dict,
+    SpellCheckerStats *stats);
+
+/**
+ * Sets the number of threads used to spell-check large texts. 
+ * A large text is split into chunks on word boundaries, which 
+ * are checked concurrently. The callback is still invoked from 
+ * a single thread, in the order in which the misspellings occur 
+ * in the document. Small texts are always checked by a single 
+ * thread. 
+ *  
+ * Applies to the texts passed to spellCheck() after this call. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param numThreads 
+ *    The number of threads: 1 (the default) to check each text
+ *    on a single thread, 0 to use one thread per online CPU.
+ * 
+ * @return int 
+ *    0 if the setting was accepted. -1 on error.
+ */
+int spellCheckerSetParallelism(
+    SpellCheckerDictionaryHandle dict,
+    unsigned int numThreads);
+
+/**
+ * Compiles a dictionary into a flat, pointer-free image file. 
+ * The image can be opened with 
+ * openSpellCheckerDictionaryMapped(), in constant time, by any 
+ * number of processes, which then share the same memory. 
+ *  
+ * All the words added before this call are included. This call 
+ * blocks until the image is written, and must not be called 
+ * from a SpellCheckerCallback. 
+ * 
+ * @param dict 
+ *    An open dictionary handle.
+ *  
+ * @param path 
+ *    The file to write the image to. If it exists, it is
+ *    replaced atomically, so processes that have the previous
+ *    image opened are not affected.
+ *  
+ * @return int 
+ *    0 if the image was written. -1 on error.
+ */
+int spellCheckerCompileDictionary(
+    SpellCheckerDictionaryHandle dict,
+    const char *path);
+
+/**
+ * Opens a dictionary image written by 
+ * spellCheckerCompileDictionary(), by mapping it read-only into 
+ * memory. The image is not parsed nor copied. 
+ *  
+ * The dictionary is read-only: spellCheckerAddWord() returns 
+ * -1. It is otherwise used (and closed) like any other 
+ * dictionary. The image file must not be modified while the 
+ * dictionary is open (replacing it, as 
+ * spellCheckerCompileDictionary() does, is fine). 
+ *  
+ * Only the layout of the image (its header, and that of its 
+ * suggestion index) is validated. The nodes, edges and words 
+ * are trusted, so only open images from trusted sources. 
+ * 
+ * @param path 
+ *    The image file.
+ *  
+ * @return SpellCheckerDictionaryHandle 
+ *    An opaque handle used to represent the dictionary, or NULL
+ *    on error (including a file that is not a valid image).
+ */
+SpellCheckerDictionaryHandle openSpellCheckerDictionaryMapped(
+    const char *path);
+
+/**
+ * Creates an overlay of a dictionary opened with 
+ * openSpellCheckerDictionaryMapped(): a new, empty dictionary 
+ * to which words can be added (and removed) as to any other, 
+ * and whose lookups, spell-checks, suggestions and completions 
+ * also accept the words of the base dictionary. 
+ *  
+ * Any number of overlays can share the same base, which is 
+ * neither copied nor modified: the memory of an overlay grows 
+ * with its own words only (spellCheckerGetStats() counts them 
+ * alone). A word is looked up in the overlay first, then in the 
+ * base. 
+ *  
+ * The base stays open as long as it has overlays, even once 
+ * closeSpellCheckerDictionary() was called on it, and cannot be 
+ * replaced with spellCheckerSwapDictionary() meanwhile. An 
+ * overlay cannot be compiled with 
+ * spellCheckerCompileDictionary(), and the words of the base 
+ * cannot be removed from it. 
+ * 
+ * @param base 
+ *    A dictionary handle previously returned from
+ *    openSpellCheckerDictionaryMapped().
+ *  
+ * @param options 
+ *    The settings of the overlay, as in
+ *    createSpellCheckerDictionaryWithOptions(), or NULL for the
+ *    defaults (a Trie).
+ *  
+ * @return SpellCheckerDictionaryHandle 
+ *    An opaque handle used to represent the overlay, or NULL on
+ *    error (including a base that is not a mapped dictionary).
+ */
+SpellCheckerDictionaryHandle createSpellCheckerOverlay(
+    SpellCheckerDictionaryHandle base,
+    const SpellCheckerOptions *options);
+
+#endif
+
@@ -0,0 +1,137 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "spell-checker_arena.h"
+
+/*
+ * The size of the chunks blocks are carved from.
+ */
+#define SCA_CHUNK_SIZE (1024 * 1024)
+
+/*
+ * The header of a mapping: either a chunk, or a single large block. Large
+ * blocks can be unmapped on their own, hence the doubly-linked list.
+ */
+typedef struct ScaChunk
+{
+    struct ScaChunk *prev;
+    struct ScaChunk *next;
+    size_t size;
+} ScaChunk;
+
+static inline size_t scaRoundUp(size_t size)
+{
+    return (size + SCA_GRANULE - 1) & ~(size_t)(SCA_GRANULE - 1);
+}
+
+/*
+ * Map size bytes (plus the header), and link the mapping to the arena.
+ * @return the memory past the header, or NULL on failure.
+ */
+static void *scaMap(ScaArena *arena, size_t size)
+{
+    size += sizeof(ScaChunk);
+    ScaChunk *chunk = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == chunk)
+    {
+        printf("Failed mapping memory for arena\n");
+        return NULL;
+    }
+
+    chunk->prev = NULL;
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    if (arena->chunks)
+        arena->chunks->prev = chunk;
+    arena->chunks = chunk;
+    arena->size += size;
+
+    return chunk + 1;
+}
+
+static void scaUnmap(ScaArena *arena, ScaChunk *chunk)
+{
+    if (chunk->prev)
+        chunk->prev->next = chunk->next;
+    else
+        arena->chunks = chunk->next;
+    if (chunk->next)
+        chunk->next->prev = chunk->prev;
+    arena->size -= chunk->size;
+
+    munmap(chunk, chunk->size);
+}
+
+void scaInit(ScaArena *arena)
+{
+    arena->chunks = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+    memset(arena->freeLists, 0, sizeof(arena->freeLists));
+    arena->size = 0;
+}
+
+void scaFinalize(ScaArena *arena)
+{
+    while (arena->chunks)
+    {
+        ScaChunk *next = arena->chunks->next;
+        munmap(arena->chunks, arena->chunks->size);
+        arena->chunks = next;
+    }
+
+    scaInit(arena);
+}
+
+void *scaAlloc(ScaArena *arena, size_t size)
+{
+    size = scaRoundUp(size ? size : 1);
+    if (size > SCA_MAX_BLOCK)
+        return scaMap(arena, size);
+
+    void **freeList = &arena->freeLists[size / SCA_GRANULE];
+    if (*freeList)
+    {
+        void *ptr = *freeList;
+        *freeList = *(void**)ptr;
+        return ptr;
+    }
+
+    if ((size_t)(arena->end - arena->next) < size)
+    {
+        char *chunk = scaMap(arena, SCA_CHUNK_SIZE - sizeof(ScaChunk));
+        if (!chunk)
+            return NULL;
+
+        /* Keep what is left of the previous chunk for smaller blocks */
+        if (arena->end > arena->next)
+            scaFree(arena, arena->next, arena->end - arena->next);
+
+        arena->next = chunk;
+        arena->end = chunk + SCA_CHUNK_SIZE - sizeof(ScaChunk);
+    }
+
+    void *ptr = arena->next;
+    arena->next += size;
+    return ptr;
+}
+
+void scaFree(ScaArena *arena, void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    size = scaRoundUp(size ? size : 1);
+    if (size > SCA_MAX_BLOCK)
+    {
+        scaUnmap(arena, (ScaChunk*)ptr - 1);
+        return;
+    }
+
+    *(void**)ptr = arena->freeLists[size / SCA_GRANULE];
+    arena->freeLists[size / SCA_GRANULE] = ptr;
+}
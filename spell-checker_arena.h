@@ -0,0 +1,71 @@
+#ifndef __SPELL_CHECKER_ARENA_H
+#define __SPELL_CHECKER_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * An arena allocator, for the many small blocks of a data structure that is
+ * released all at once.
+ *
+ * Memory is mapped from the system in large chunks, and blocks are carved out
+ * of the current chunk by bumping a pointer, so blocks allocated one after the
+ * other sit next to each other. A freed block is kept on a free list for its
+ * size (rounded up to SCA_GRANULE), and handed out again by the next
+ * allocation of that size. Blocks larger than SCA_MAX_BLOCK get a mapping of
+ * their own.
+ *
+ * Finalizing the arena unmaps its chunks, without visiting the blocks: the
+ * blocks still allocated are released along with them.
+ *
+ * An arena is not thread-safe: it is meant to be used by a single (writer)
+ * thread.
+ */
+
+/*
+ * Block sizes are rounded up to a multiple of SCA_GRANULE bytes, which is also
+ * the alignment of the blocks.
+ */
+#define SCA_GRANULE 8
+#define SCA_MAX_BLOCK 8192
+
+struct ScaChunk;
+
+typedef struct ScaArena
+{
+    /* The chunks, and the mappings of the large blocks */
+    struct ScaChunk *chunks;
+    char *next;
+    char *end;
+
+    /* Freed blocks, by size / SCA_GRANULE */
+    void *freeLists[SCA_MAX_BLOCK / SCA_GRANULE + 1];
+
+    /* The memory mapped so far, in bytes */
+    size_t size;
+} ScaArena;
+
+/**
+ * Initialize an empty arena. Nothing is mapped until the first allocation.
+ */
+void scaInit(ScaArena *arena);
+
+/**
+ * Unmap all the memory of the arena, including the blocks still allocated.
+ */
+void scaFinalize(ScaArena *arena);
+
+/**
+ * Allocate a block.
+ * @param size the size of the block, in bytes.
+ * @return the block, or NULL on failure.
+ */
+void *scaAlloc(ScaArena *arena, size_t size);
+
+/**
+ * Free a block, for the arena to reuse.
+ * @param ptr the block, may be NULL.
+ * @param size the size it was allocated with.
+ */
+void scaFree(ScaArena *arena, void *ptr, size_t size);
+
+#endif
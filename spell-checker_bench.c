@@ -0,0 +1,722 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "spell-checker.h"
+
+/**
+ * A benchmark of the spell-checker, reporting its results as JSON on stdout,
+ * so that they can be compared between versions.
+ *
+ * The dictionary and the text to check are either read from files, or
+ * generated: random words, and a text drawing its words from the dictionary
+ * with a Zipf-like distribution (a few words are very common, most are rare),
+ * a given share of which are misspelled. Generated inputs only depend on the
+ * seed, so runs with the same arguments check the same text.
+ *
+ * Measured:
+ * - build: the time to load the dictionary with spellCheckerAddWords(), until
+ *   the last word is visible, and the memory it takes.
+ * - check: spellCheckSpan() over the text, one call per chunk of
+ *   --chunk-size bytes, with the latency of each call.
+ * - async: spellCheckAsync() over the whole text at once, on --threads threads.
+ * - lookup: spellCheckerHasWord() on words of the text, with the latency of
+ *   each call.
+ * - batch_lookup: the same words looked up one by one, then with
+ *   spellCheckerHasWords() in batches of BENCH_LOOKUP_BATCH words.
+ *
+ * The tokens of the text, and the words looked up, are split the way byte
+ * dictionaries do, whatever the --encoding (the same for ASCII text).
+ *
+ * Run with --help for the options.
+ */
+
+#define BENCH_DEFAULT_WORDS 200000
+#define BENCH_DEFAULT_TEXT_SIZE (16 * 1024 * 1024)
+#define BENCH_DEFAULT_CHUNK_SIZE 4096
+#define BENCH_DEFAULT_LOOKUPS 1000000
+#define BENCH_DEFAULT_MISSPELL_PERCENT 5
+#define BENCH_LOOKUP_BATCH 64
+#define BENCH_MIN_WORD_LEN 2
+#define BENCH_MAX_WORD_LEN 20
+
+typedef struct BenchOptions
+{
+    SpellCheckerBackend backend;
+    const char *backendName;
+    SpellCheckerEncoding encoding;
+    const char *encodingName;
+    const char *dictFile; /* NULL to generate the words */
+    const char *textFile; /* NULL to generate the text */
+    size_t numWords;
+    size_t textSize;
+    size_t chunkSize;
+    size_t numLookups;
+    unsigned int misspellPercent;
+    unsigned int numThreads;
+    size_t cacheSize;
+    uint64_t seed;
+} BenchOptions;
+
+typedef struct BenchBuffer
+{
+    char *buf;
+    size_t len;
+    size_t capacity;
+} BenchBuffer;
+
+static double benchNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * xorshift64*: fast and good enough to pick words.
+ */
+static uint64_t benchRandom(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/*
+ * @return a random rank in [0, n), log-uniformly distributed: each power of
+ * two range of ranks is drawn as often, like the words of a Zipf distribution.
+ */
+static size_t benchZipfRank(uint64_t *state, size_t n)
+{
+    unsigned int bits = 0;
+    while (((size_t)1 << (bits + 1)) <= n)
+        ++bits;
+
+    const unsigned int range = benchRandom(state) % (bits + 1);
+    const size_t low = ((size_t)1 << range) - 1;
+    const size_t rank = low + benchRandom(state) % ((size_t)1 << range);
+    return (rank < n) ? rank : n - 1;
+}
+
+/*
+ * The current resident memory of the process, in bytes, or 0 if unknown.
+ */
+static size_t benchRss(void)
+{
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+
+    unsigned long size;
+    unsigned long resident = 0;
+    if (2 != fscanf(file, "%lu %lu", &size, &resident))
+        resident = 0;
+    fclose(file);
+    return resident * 4096;
+}
+
+/*
+ * The peak resident memory of the process, in bytes.
+ */
+static size_t benchPeakRss(void)
+{
+    struct rusage usage;
+    if (-1 == getrusage(RUSAGE_SELF, &usage))
+        return 0;
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+static int benchAppend(BenchBuffer *buffer, const char *data, size_t len)
+{
+    if (buffer->len + len > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (buffer->len + len > capacity)
+            capacity *= 2;
+        char *buf = realloc(buffer->buf, capacity);
+        if (!buf)
+        {
+            fprintf(stderr, "Failed allocating memory\n");
+            return -1;
+        }
+        buffer->buf = buf;
+        buffer->capacity = capacity;
+    }
+    memcpy(&buffer->buf[buffer->len], data, len);
+    buffer->len += len;
+    return 0;
+}
+
+static int benchReadFile(const char *path, BenchBuffer *buffer)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed opening '%s'\n", path);
+        return -1;
+    }
+
+    char block[65536];
+    size_t len;
+    int ret = 0;
+    while ((0 == ret) && (len = fread(block, 1, sizeof(block), file)))
+        ret = benchAppend(buffer, block, len);
+    fclose(file);
+    return ret;
+}
+
+/*
+ * Generate numWords random lower-case words, one per line.
+ */
+static int benchGenerateWords(size_t numWords, uint64_t *state,
+                              BenchBuffer *buffer)
+{
+    char word[BENCH_MAX_WORD_LEN + 1];
+    for (size_t i = 0; i < numWords; ++i)
+    {
+        /* Sum of two draws: lengths around the middle are the most common */
+        const size_t span = (BENCH_MAX_WORD_LEN - BENCH_MIN_WORD_LEN) / 2 + 1;
+        const size_t len = BENCH_MIN_WORD_LEN + benchRandom(state) % span +
+            benchRandom(state) % span;
+        for (size_t j = 0; j < len; ++j)
+            word[j] = 'a' + benchRandom(state) % 26;
+        word[len] = '\n';
+        if (-1 == benchAppend(buffer, word, len + 1))
+            return -1;
+    }
+    return 0;
+}
+
+static int isWordChar(char c)
+{
+    return (('a' <= c) && ('z' >= c)) || (('A' <= c) && ('Z' >= c)) ||
+        (('0' <= c) && ('9' >= c)) || (0x80 & (unsigned char)c);
+}
+
+/*
+ * Split the dictionary into words (in place, replacing newlines with null
+ * characters).
+ * @return the words, to be released with free(), or NULL on failure.
+ */
+static char **benchSplitWords(BenchBuffer *dict, size_t *numWords)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < dict->len; ++i)
+        count += ('\n' == dict->buf[i]);
+
+    char **words = malloc((count + 1) * sizeof(char*));
+    if (!words)
+    {
+        fprintf(stderr, "Failed allocating memory\n");
+        return NULL;
+    }
+
+    *numWords = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= dict->len; ++i)
+    {
+        if ((i < dict->len) && ('\n' != dict->buf[i]))
+            continue;
+
+        size_t end = i;
+        if ((end > start) && ('\r' == dict->buf[end - 1]))
+            --end;
+        if (i < dict->len)
+            dict->buf[end] = '\0';
+        if ((end > start) && (i < dict->len))
+            words[(*numWords)++] = &dict->buf[start];
+        start = i + 1;
+    }
+    return words;
+}
+
+/*
+ * Generate a text of about size bytes, drawing words from the dictionary, and
+ * misspelling some of them.
+ */
+static int benchGenerateText(char **words, size_t numWords, size_t size,
+                             unsigned int misspellPercent, uint64_t *state,
+                             BenchBuffer *buffer)
+{
+    static const char *delimiters[] = { " ", " ", " ", " ", ", ", ". ", "\n" };
+    char word[256];
+
+    while (buffer->len < size)
+    {
+        const char *source = words[benchZipfRank(state, numWords)];
+        size_t len = strlen(source);
+        if (len >= sizeof(word))
+            len = sizeof(word) - 1;
+        memcpy(word, source, len);
+
+        /* Replace a letter with one that is unlikely to give another word */
+        if (benchRandom(state) % 100 < misspellPercent)
+            word[benchRandom(state) % len] = 'q';
+
+        const char *delimiter = delimiters[benchRandom(state) %
+                                           (sizeof(delimiters) /
+                                            sizeof(delimiters[0]))];
+        if ((-1 == benchAppend(buffer, word, len)) ||
+            (-1 == benchAppend(buffer, delimiter, strlen(delimiter))))
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Words are added asynchronously: wait until the given word is visible to
+ * lookups (and with it, every word added before it).
+ */
+static void benchWaitForWord(SpellCheckerDictionaryHandle dict,
+                             const char *word)
+{
+    const struct timespec pollInterval = { 0, 100 * 1000 };
+    while (1 != spellCheckerHasWord(dict, word))
+        nanosleep(&pollInterval, NULL);
+}
+
+static void benchCountCallback(const char *word, size_t length, size_t offset,
+                               void *userdata)
+{
+    (void)word;
+    (void)length;
+    (void)offset;
+    ++*(size_t*)userdata;
+}
+
+static int benchCompareDoubles(const void *a, const void *b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+/*
+ * Sort the latencies, and print their percentiles, in microseconds.
+ */
+static void benchPrintLatencies(double *latencies, size_t num)
+{
+    qsort(latencies, num, sizeof(double), benchCompareDoubles);
+    const double p50 = num ? latencies[num / 2] : 0;
+    const double p99 = num ? latencies[num * 99 / 100] : 0;
+    const double max = num ? latencies[num - 1] : 0;
+    printf("\"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f",
+           p50 * 1e6, p99 * 1e6, max * 1e6);
+}
+
+static void benchUsage(FILE *out, const char *name)
+{
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "  --backend trie|hash|dawg  the dictionary backend (trie)\n"
+            "  --encoding bytes|utf8     how text is split into words (bytes)\n"
+            "  --dict FILE               newline-separated words to load\n"
+            "  --words N                 generate N words instead (%d)\n"
+            "  --text FILE               the text to check\n"
+            "  --text-size BYTES         generate a text instead (%d)\n"
+            "  --misspell PERCENT        misspelled generated words (%d)\n"
+            "  --chunk-size BYTES        text per spellCheckSpan() call (%d)\n"
+            "  --lookups N               spellCheckerHasWord() calls (%d)\n"
+            "  --threads N               threads of the async check (1)\n"
+            "  --cache BYTES             per-thread lookup cache (0)\n"
+            "  --seed N                  seed of the generated inputs (1)\n"
+            "  --help                    print this and exit\n",
+            name, BENCH_DEFAULT_WORDS, BENCH_DEFAULT_TEXT_SIZE,
+            BENCH_DEFAULT_MISSPELL_PERCENT, BENCH_DEFAULT_CHUNK_SIZE,
+            BENCH_DEFAULT_LOOKUPS);
+}
+
+/*
+ * @return 0 on success, 1 if --help was given, -1 on invalid arguments.
+ */
+static int benchParseOptions(int argc, char **argv, BenchOptions *options)
+{
+    options->backend = SPELL_CHECKER_BACKEND_TRIE;
+    options->backendName = "trie";
+    options->encoding = SPELL_CHECKER_ENCODING_BYTES;
+    options->encodingName = "bytes";
+    options->dictFile = NULL;
+    options->textFile = NULL;
+    options->numWords = BENCH_DEFAULT_WORDS;
+    options->textSize = BENCH_DEFAULT_TEXT_SIZE;
+    options->chunkSize = BENCH_DEFAULT_CHUNK_SIZE;
+    options->numLookups = BENCH_DEFAULT_LOOKUPS;
+    options->misspellPercent = BENCH_DEFAULT_MISSPELL_PERCENT;
+    options->numThreads = 1;
+    options->cacheSize = 0;
+    options->seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *name = argv[i];
+        if (0 == strcmp(name, "--help"))
+            return 1;
+
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value || (0 != strncmp(name, "--", 2)))
+            return -1;
+        ++i;
+
+        if (0 == strcmp(name, "--backend"))
+        {
+            options->backendName = value;
+            if (0 == strcmp(value, "trie"))
+                options->backend = SPELL_CHECKER_BACKEND_TRIE;
+            else if (0 == strcmp(value, "hash"))
+                options->backend = SPELL_CHECKER_BACKEND_HASH;
+            else if (0 == strcmp(value, "dawg"))
+                options->backend = SPELL_CHECKER_BACKEND_DAWG;
+            else
+                return -1;
+        }
+        else if (0 == strcmp(name, "--encoding"))
+        {
+            options->encodingName = value;
+            if (0 == strcmp(value, "bytes"))
+                options->encoding = SPELL_CHECKER_ENCODING_BYTES;
+            else if (0 == strcmp(value, "utf8"))
+                options->encoding = SPELL_CHECKER_ENCODING_UTF8;
+            else
+                return -1;
+        }
+        else if (0 == strcmp(name, "--dict"))
+            options->dictFile = value;
+        else if (0 == strcmp(name, "--words"))
+            options->numWords = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--text"))
+            options->textFile = value;
+        else if (0 == strcmp(name, "--text-size"))
+            options->textSize = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--misspell"))
+            options->misspellPercent = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--chunk-size"))
+            options->chunkSize = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--lookups"))
+            options->numLookups = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--threads"))
+            options->numThreads = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--cache"))
+            options->cacheSize = strtoul(value, NULL, 0);
+        else if (0 == strcmp(name, "--seed"))
+            options->seed = strtoull(value, NULL, 0);
+        else
+            return -1;
+    }
+
+    if (!options->numWords || !options->chunkSize || !options->seed)
+        return -1;
+    return 0;
+}
+
+/*
+ * Check the text one chunk at a time, each chunk ending on a word boundary.
+ */
+static void benchCheck(SpellCheckerDictionaryHandle dict,
+                       const BenchBuffer *text, size_t chunkSize,
+                       size_t numTokens)
+{
+    const size_t maxCalls = text->len / chunkSize + 1;
+    double *latencies = malloc(maxCalls * sizeof(double));
+    size_t numCalls = 0;
+    size_t misspellings = 0;
+
+    const double start = benchNow();
+    size_t begin = 0;
+    while (begin < text->len)
+    {
+        size_t end = begin + chunkSize;
+        if (end >= text->len)
+            end = text->len;
+        while ((end < text->len) && isWordChar(text->buf[end]))
+            ++end;
+
+        const double callStart = benchNow();
+        spellCheckSpan(dict, &text->buf[begin], end - begin,
+                       benchCountCallback, &misspellings);
+        if (latencies)
+            latencies[numCalls++] = benchNow() - callStart;
+        begin = end;
+    }
+    const double elapsed = benchNow() - start;
+
+    printf("  \"check\": { \"calls\": %zu, \"seconds\": %.6f, "
+           "\"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, "
+           "\"misspellings\": %zu, ", numCalls, elapsed,
+           text->len / elapsed / (1024 * 1024), numTokens / elapsed,
+           misspellings);
+    benchPrintLatencies(latencies, numCalls);
+    printf(" },\n");
+    free(latencies);
+}
+
+static void benchCheckAsync(SpellCheckerDictionaryHandle dict,
+                            const BenchBuffer *text, unsigned int numThreads,
+                            size_t numTokens)
+{
+    size_t misspellings = 0;
+    spellCheckerSetParallelism(dict, numThreads);
+
+    const double start = benchNow();
+    SpellCheckerJobHandle job = spellCheckAsync(dict, text->buf, text->len,
+                                                benchCountCallback, NULL,
+                                                &misspellings);
+    spellCheckerJobWait(job, -1);
+    const double elapsed = benchNow() - start;
+    spellCheckerJobRelease(job);
+
+    printf("  \"async\": { \"threads\": %u, \"seconds\": %.6f, "
+           "\"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, "
+           "\"misspellings\": %zu },\n", numThreads, elapsed,
+           text->len / elapsed / (1024 * 1024), numTokens / elapsed,
+           misspellings);
+}
+
+/*
+ * Look up the words of the text, in order, wrapping around.
+ */
+static void benchLookup(SpellCheckerDictionaryHandle dict,
+                        const BenchBuffer *text, size_t numLookups)
+{
+    double *latencies = malloc(numLookups * sizeof(double));
+    char word[256];
+    size_t found = 0;
+    size_t pos = 0;
+    size_t numCalls = 0;
+
+    const double start = benchNow();
+    while (numCalls < numLookups)
+    {
+        while ((pos < text->len) && !isWordChar(text->buf[pos]))
+            ++pos;
+        if (pos == text->len)
+        {
+            if (0 == numCalls)
+                break;
+            pos = 0;
+            continue;
+        }
+
+        size_t len = 0;
+        while ((pos < text->len) && isWordChar(text->buf[pos]))
+        {
+            if (len + 1 < sizeof(word))
+                word[len++] = text->buf[pos];
+            ++pos;
+        }
+        word[len] = '\0';
+
+        const double callStart = benchNow();
+        found += (1 == spellCheckerHasWord(dict, word));
+        if (latencies)
+            latencies[numCalls] = benchNow() - callStart;
+        ++numCalls;
+    }
+    const double elapsed = benchNow() - start;
+
+    printf("  \"lookup\": { \"calls\": %zu, \"found\": %zu, "
+           "\"seconds\": %.6f, \"calls_per_s\": %.0f, ", numCalls, found,
+           elapsed, numCalls / elapsed);
+    benchPrintLatencies(latencies, latencies ? numCalls : 0);
+    printf(" },\n");
+    free(latencies);
+}
+
+/*
+ * Look up the words of the text, in order, wrapping around, one by one and
+ * in batches.
+ */
+static void benchLookupBatch(SpellCheckerDictionaryHandle dict,
+                             const BenchBuffer *text, size_t numLookups)
+{
+    /* Null-terminated copies for spellCheckerHasWord() */
+    char *copies = malloc(text->len + 1);
+    const char **words = malloc(numLookups * sizeof(char*));
+    size_t *lens = malloc(numLookups * sizeof(size_t));
+    uint8_t *results = malloc(numLookups);
+    if (!copies || !words || !lens || !results)
+    {
+        fprintf(stderr, "Failed allocating memory\n");
+        goto out;
+    }
+    memcpy(copies, text->buf, text->len);
+    copies[text->len] = '\0';
+
+    size_t num = 0;
+    size_t pos = 0;
+    while (num < numLookups)
+    {
+        while ((pos < text->len) && !isWordChar(text->buf[pos]))
+            ++pos;
+        if (pos == text->len)
+        {
+            if (0 == num)
+                break;
+            pos = 0;
+            continue;
+        }
+
+        words[num] = &copies[pos];
+        while ((pos < text->len) && isWordChar(text->buf[pos]))
+            ++pos;
+        lens[num] = &copies[pos] - words[num];
+        ++num;
+    }
+    for (size_t i = 0; i < num; ++i)
+        ((char*) words[i])[lens[i]] = '\0';
+
+    size_t found = 0;
+    const double singleStart = benchNow();
+    for (size_t i = 0; i < num; ++i)
+        found += (1 == spellCheckerHasWord(dict, words[i]));
+    const double single = benchNow() - singleStart;
+
+    size_t batchFound = 0;
+    const double batchStart = benchNow();
+    for (size_t i = 0; i < num; i += BENCH_LOOKUP_BATCH)
+    {
+        const size_t n = (num - i < BENCH_LOOKUP_BATCH) ?
+            num - i : BENCH_LOOKUP_BATCH;
+        spellCheckerHasWords(dict, &words[i], &lens[i], n, &results[i]);
+    }
+    const double batch = benchNow() - batchStart;
+    for (size_t i = 0; i < num; ++i)
+        batchFound += results[i];
+
+    printf("  \"batch_lookup\": { \"calls\": %zu, \"batch\": %d, "
+           "\"found\": %zu, \"batch_found\": %zu, "
+           "\"single_calls_per_s\": %.0f, \"batch_calls_per_s\": %.0f, "
+           "\"speedup\": %.2f },\n", num, BENCH_LOOKUP_BATCH, found,
+           batchFound, num / single, num / batch, single / batch);
+
+out:
+    free(copies);
+    free(words);
+    free(lens);
+    free(results);
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    const int parsed = benchParseOptions(argc, argv, &options);
+    if (parsed)
+    {
+        benchUsage((1 == parsed) ? stdout : stderr, argv[0]);
+        return (1 == parsed) ? 0 : 1;
+    }
+
+    uint64_t state = options.seed;
+    BenchBuffer dictBuffer = { NULL, 0, 0 };
+    BenchBuffer text = { NULL, 0, 0 };
+    char **words = NULL;
+    size_t numWords = 0;
+    int ret = 1;
+
+    if ((options.dictFile ? benchReadFile(options.dictFile, &dictBuffer) :
+         benchGenerateWords(options.numWords, &state, &dictBuffer)) ||
+        (-1 == benchAppend(&dictBuffer, "\n", 1)))
+        goto out;
+
+    /* Load a copy: the words are split in place to generate the text */
+    char *dictCopy = malloc(dictBuffer.len);
+    if (!dictCopy)
+    {
+        fprintf(stderr, "Failed allocating memory\n");
+        goto out;
+    }
+    memcpy(dictCopy, dictBuffer.buf, dictBuffer.len);
+    const size_t dictLen = dictBuffer.len;
+
+    words = benchSplitWords(&dictBuffer, &numWords);
+    if (!words || !numWords)
+    {
+        fprintf(stderr, "No words to load\n");
+        free(dictCopy);
+        goto out;
+    }
+
+    if (options.textFile ? benchReadFile(options.textFile, &text) :
+        benchGenerateText(words, numWords, options.textSize,
+                          options.misspellPercent, &state, &text))
+    {
+        free(dictCopy);
+        goto out;
+    }
+
+    /* Invalid words are rejected, wait for the last valid one */
+    const char *lastWord = NULL;
+    for (size_t i = 0; !lastWord && (i < numWords); ++i)
+    {
+        const char *word = words[numWords - 1 - i];
+        while (*word && isWordChar(*word))
+            ++word;
+        if (!*word)
+            lastWord = words[numWords - 1 - i];
+    }
+    if (!lastWord)
+    {
+        fprintf(stderr, "No valid words to load\n");
+        free(dictCopy);
+        goto out;
+    }
+
+    size_t numTokens = 0;
+    for (size_t i = 0; i < text.len; ++i)
+        numTokens += isWordChar(text.buf[i]) &&
+            ((0 == i) || !isWordChar(text.buf[i - 1]));
+
+    const SpellCheckerOptions dictOptions = {
+        options.backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, options.cacheSize,
+        NULL, options.encoding
+    };
+    const size_t rssBefore = benchRss();
+    const double buildStart = benchNow();
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(&dictOptions);
+    if (!dict || (-1 == spellCheckerAddWords(dict, dictCopy, dictLen)))
+    {
+        fprintf(stderr, "Failed loading the dictionary\n");
+        free(dictCopy);
+        closeSpellCheckerDictionary(dict);
+        goto out;
+    }
+    benchWaitForWord(dict, lastWord);
+    const double buildTime = benchNow() - buildStart;
+    const size_t rssAfter = benchRss();
+    free(dictCopy);
+    const size_t dictBytes = (rssAfter > rssBefore) ? rssAfter - rssBefore : 0;
+
+    printf("{\n");
+    printf("  \"backend\": \"%s\",\n", options.backendName);
+    printf("  \"encoding\": \"%s\",\n", options.encodingName);
+    printf("  \"build\": { \"words\": %zu, \"seconds\": %.6f, "
+           "\"words_per_s\": %.0f, \"bytes\": %zu, "
+           "\"bytes_per_word\": %.1f },\n", numWords, buildTime,
+           numWords / buildTime, dictBytes, (double)dictBytes / numWords);
+    printf("  \"text\": { \"bytes\": %zu, \"tokens\": %zu },\n", text.len,
+           numTokens);
+
+    benchCheck(dict, &text, options.chunkSize, numTokens);
+    benchCheckAsync(dict, &text, options.numThreads, numTokens);
+    benchLookup(dict, &text, options.numLookups);
+    benchLookupBatch(dict, &text, options.numLookups);
+
+    const double closeStart = benchNow();
+    closeSpellCheckerDictionary(dict);
+    printf("  \"close\": { \"seconds\": %.6f },\n", benchNow() - closeStart);
+    printf("  \"peak_rss_bytes\": %zu\n", benchPeakRss());
+    printf("}\n");
+    ret = 0;
+
+out:
+    free(words);
+    free(text.buf);
+    free(dictBuffer.buf);
+    return ret;
+}
@@ -1,149 +1,233 @@
-#include <stdlib.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "spell-checker_data.h"
+#include "spell-checker_data_backend.h"
+#include "spell-checker_unicode.h"
 
 /**
- * A Trie implementation to hold the dictionary data.
- *
- * See https://en.wikipedia.org/wiki/Trie for a description of a Trie.
- *
- * TODO: Extract the implementation out, put into specific implementation file,
- * to easily test with other data-structures.
+ * The front-end of the data model: validates the arguments, and dispatches to
+ * the backend the data model was initialized with.
  *
- * This implementation is a bit wasteful in memory, but should be rather fast.
- * It is wasteful, as it is allocating an empty array for each node created,
- * even though potentially none of the children will be used. In practice, most
- * of them will probably not be used (TODO: measure how much exactly).
- * It is, however, rather fast, as the access to each element is O(1), as each
- * child is located at the index of it's character representation.
+ * Available backends:
+ * - Trie (spell-checker_data_trie.c): fast adds and lookups, a node per
+ *   character of each distinct prefix.
+ * - Hash (spell-checker_data_hash.c): open-addressing hash set, each word is
+ *   stored once along with its hash. Single probe lookups on average.
+ * - DAWG (spell-checker_data_dawg.c): a minimized directed acyclic word graph,
+ *   sharing both prefixes and suffixes. The smallest of the three, but adds are
+ *   batched and the graph is rebuilt when they are committed, so it is best
+ *   suited for dictionaries that are loaded once and then only queried.
  *
- * Visual representation of the Trie containing a single word 'air':
+ * Any data model can also be compiled into a DAWG image file, which is later
+ * mapped read-only (see scdCompile() and scdOpenImage()).
  *
- *                   (0)            <-- Root
- *              ______|______
- *              |     |      |
- *             (0)...(a)...(0xFF)   <-- ... 256 children (all but one empty)
- *              ______|_______
- *              |     |      |
- *             (0)...(i)...(0xFF)   <-- ... 256 children (all but one empty)
- *              ______|_______
- *              |     |      |
- *             (0)...(r)...(0xFF)   <-- ... 256 children (all but one empty)
- *              ______|_______
- *              |            |
- *             (0)         (0xFF)   <-- ... 256 children (all empty)
+ * Any data model can also keep a deletion index along with its words (see
+ * spell-checker_data_index.h), to answer scdSuggest() without walking it, and
+ * the frequencies of its words (see spell-checker_data_freq.h), to rank
+ * suggestions and to answer lookups of the most frequent words first.
  *
+ * A data model can be layered over a read-only one (see scdLayerOver()):
+ * lookups fall through to the lower data model when the word is not in the
+ * upper one, so many small data models can share a large one.
  *
- * Multiple strategies may be implemented to improve memory waste: allocating
- * nodes for legal characters only, allocating nodes as-needed only, not
- * allocating nodes for the leafs, etc.. All have different pros and cons.
- *
- * Each node in the Trie holds a single character and a list of children.
- * The root node has its character element set to 0.
- * Upon initialization, only the root node is created, with its children's
- * array zero-ed out.
- * Every time a word is added, a new node is created in place of the appropriate
- * child node.
+ * The words given to a UTF-8 data model (see scdSetUtf8()) are folded here,
+ * once: backends, the index and the frequencies only ever see folded words,
+ * and the lower data models are passed the words already folded.
  */
 
-/*
- *Max ascii values (with extended characters)
- */
-#define MAX_CHARS_PER_NODE 256
+static const ScdBackend *scdBackends[] = {
+    &scdTrieBackend,   /* SCD_BACKEND_TRIE */
+    &scdHashBackend,   /* SCD_BACKEND_HASH */
+    &scdDawgBackend    /* SCD_BACKEND_DAWG */
+};
+
+SpellCheckerDataHandle scdInit(ScdBackendType type)
+{
+    if ((unsigned)type >= sizeof(scdBackends) / sizeof(scdBackends[0]))
+    {
+        printf("Unknown data model backend (%d)\n", type);
+        return NULL;
+    }
+
+    SpellCheckerDataHandle data = scdBackends[type]->init();
+    if (data)
+    {
+        data->backend = scdBackends[type];
+        sceInit(&data->epoch);
+        data->index = NULL;
+        data->freq = NULL;
+        data->generation = 0;
+        data->hasRemovals = 0;
+        data->below = NULL;
+        data->isUtf8 = 0;
+    }
+    return data;
+}
+
+void scdFinalize(SpellCheckerDataHandle data)
+{
+    if (data)
+    {
+        sceFinalize(&data->epoch);
+        scdIndexFinalize(data->index);
+        scdFreqFinalize(data->freq);
+        data->backend->finalize(data);
+    }
+}
+
+static void scdFreeIndex(void *index)
+{
+    scdIndexFinalize(index);
+}
 
 /*
- * Each data node holds a character and an array of MAX_CHARS_PER_NODE children.
+ * Stop using the index once it misses words: suggestions fall back to walking
+ * the data model.
  */
-struct _SpellCheckerData
+static void scdDropIndex(SpellCheckerDataHandle data)
 {
-    char chr;
-    struct _SpellCheckerData *child;
-};
+    ScdIndex *index = data->index;
+    printf("Suggestion index disabled\n");
+    __atomic_store_n(&data->index, NULL, __ATOMIC_RELEASE);
+    sceRetire(&data->epoch, index, scdFreeIndex);
+}
+
+static int scdIndexWord(const char *word, size_t len, void *userdata)
+{
+    return scdIndexAddWord(userdata, word, len);
+}
 
 /*
- * Recursively delete a node.
- * Note: the node itself is not deleted, but all its children does.
+ * Index words before handing them to the backend, so that a word visible to
+ * lookups can always be suggested too. The index of a mapped image (whose
+ * backend has no init) is read-only, like the image.
  */
-static void scdDeleteNode(SpellCheckerDataHandle node)
+static void scdIndexWords(SpellCheckerDataHandle data, const char **words,
+                          const size_t *lens, size_t numWords)
 {
-    if (node)
+    if (!data->backend->init)
+        return;
+
+    for (size_t i = 0; data->index && (i < numWords); ++i)
     {
-        if (node->child)
-        {
-            for(int i = 0; i < MAX_CHARS_PER_NODE; ++i)
-                scdDeleteNode(&node->child[i]);
-            free(node->child);
-            node->child = NULL;
-        }
+        if (-1 == scdIndexAddWord(data->index, words[i], lens[i]))
+            scdDropIndex(data);
     }
 }
 
-/*
- * Initialize a node with the given character, and allocate memory for the
- * children array.
- */
-static int scdInitNode(char chr, SpellCheckerDataHandle node)
+int scdSetIndex(SpellCheckerDataHandle data, unsigned int maxDistance,
+                size_t budget)
 {
-    node->chr = chr;
+    if (!data || !data->backend->init || data->index)
+    {
+        printf("Invalid arguments passed to scdSetIndex\n");
+        return -1;
+    }
 
-    node->child = calloc(MAX_CHARS_PER_NODE, sizeof(struct _SpellCheckerData));
-    if (!node->child)
+    ScdIndex *index = scdIndexInit(&data->epoch, maxDistance, budget);
+    if (!index)
+        return -1;
+
+    if (-1 == data->backend->forEachWord(data, scdIndexWord, index))
     {
-        printf("Failed allocating memory for child array\n");
+        scdIndexFinalize(index);
         return -1;
     }
 
+    __atomic_store_n(&data->index, index, __ATOMIC_RELEASE);
     return 0;
 }
 
-static SpellCheckerDataHandle scdCreateNode(void)
+int scdSetUtf8(SpellCheckerDataHandle data)
 {
-    SpellCheckerDataHandle node = malloc(sizeof(struct _SpellCheckerData));
-    if (!node)
+    if (!data || !data->backend->init || scdGeneration(data))
     {
-        printf("Failed allocating memory for node\n");
-        return NULL;
+        printf("Invalid arguments passed to scdSetUtf8\n");
+        return -1;
     }
 
-    if (-1 == scdInitNode(0, node))
+    data->isUtf8 = 1;
+    return 0;
+}
+
+int scdIsUtf8(SpellCheckerDataHandle data)
+{
+    return data->isUtf8;
+}
+
+/*
+ * The size of the buffer a word is folded into on the stack, longer words are
+ * folded into an allocated one.
+ */
+#define SCD_FOLD_BUF 256
+
+/*
+ * Fold a word of the data model, if it needs to be.
+ * @param len the length of the word, updated to the length of the folded one.
+ * @param buf SCD_FOLD_BUF + 1 bytes the word may be folded into.
+ * @return the word itself if it needs no folding, else the folded word,
+ * null-terminated, to be released with scdFoldRelease(). NULL on failure.
+ */
+static const char *scdFold(SpellCheckerDataHandle data, const char *word,
+                           size_t *len, char *buf)
+{
+    if (!data->isUtf8 || scuIsAscii(word, *len))
+        return word;
+
+    char *folded = (SCU_MAX_FOLDED_LEN(*len) <= SCD_FOLD_BUF) ?
+        buf : malloc(SCU_MAX_FOLDED_LEN(*len) + 1);
+    if (!folded)
     {
-        free(node);
+        printf("Failed allocating memory for a folded word\n");
         return NULL;
     }
 
-    return node;
+    *len = scuFoldWord(word, *len, folded);
+    folded[*len] = '\0';
+    return folded;
 }
 
-SpellCheckerDataHandle scdInit(void)
+static void scdFoldRelease(const char *folded, const char *word,
+                           const char *buf)
 {
-    return scdCreateNode();
+    if ((folded != word) && (folded != buf))
+        free((char*)folded);
 }
 
-void scdFinalize(SpellCheckerDataHandle data)
+/*
+ * Called by the writer after the words visible to lookups may have changed
+ * (and not before, see scdGeneration()).
+ */
+static inline void scdBumpGeneration(SpellCheckerDataHandle data)
 {
-    scdDeleteNode(data);
-    free(data);
+    __atomic_store_n(&data->generation, data->generation + 1,
+                     __ATOMIC_RELEASE);
 }
 
-/*
- * Return an unsigned char instead of a signed one, and transform upper-case
- * letters to lower-case.
- */
-static inline unsigned char scdNormalizeChar(char c)
+unsigned int scdGeneration(SpellCheckerDataHandle data)
+{
+    return __atomic_load_n(&data->generation, __ATOMIC_ACQUIRE);
+}
+
+void scdContinueGeneration(SpellCheckerDataHandle data,
+                           SpellCheckerDataHandle previous)
 {
-    if (('A' <= c) && ('Z' >= c))
-        return c + 0x20;
-    return c;
+    __atomic_store_n(&data->generation, scdGeneration(previous) + 1,
+                     __ATOMIC_RELEASE);
 }
 
 /*
  * Make sure a word is valid, per the requirements given in spell-checker.h.
  */
-static inline int scdIsValid(const char *word)
+static inline int scdIsValid(SpellCheckerDataHandle data, const char *word,
+                             size_t len)
 {
-    for (size_t i = 0; i < strlen(word); ++i)
+    if (data->isUtf8)
+        return scuIsWord(word, len);
+
+    for (size_t i = 0; i < len; ++i)
     {
         if (!( (('a' <= word[i]) && ('z' >= word[i])) ||
                (('A' <= word[i]) && ('Z' >= word[i])) ||
@@ -156,13 +240,14 @@ static inline int scdIsValid(const char *word)
 
 int scdAddWord(SpellCheckerDataHandle data, const char *word)
 {
-    if (!data || !word || !data->child)
+    if (!data || !word)
     {
         printf("Invalid arguments when trying to add a word\n");
         return -1;
     }
 
-    if (!scdIsValid(word))
+    size_t len = strlen(word);
+    if (!scdIsValid(data, word, len))
     {
 #ifdef DEBUG
         printf("Attempted to add an invalid word (%s) to dictionary\n", word);
@@ -170,52 +255,1044 @@ int scdAddWord(SpellCheckerDataHandle data, const char *word)
         return -1;
     }
 
-    SpellCheckerDataHandle node = data;
-    size_t i = 0;
-    const size_t n = strlen(word);
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, word, &len, buf);
+    if (!folded)
+        return -1;
+
+    scdIndexWords(data, &folded, &len, 1);
+    const int ret = data->backend->addWord(data, folded, len);
+    scdBumpGeneration(data);
+    scdFoldRelease(folded, word, buf);
+    return ret;
+}
+
+int scdAddWordWithFrequency(SpellCheckerDataHandle data, const char *word,
+                            unsigned int frequency)
+{
+    if (-1 == scdAddWord(data, word))
+        return -1;
+
+    if (!data->freq)
+    {
+        ScdFreq *freq = scdFreqInit(&data->epoch);
+        if (!freq)
+            return -1;
+        __atomic_store_n(&data->freq, freq, __ATOMIC_RELEASE);
+    }
+
+    size_t len = strlen(word);
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, word, &len, buf);
+    if (!folded)
+        return -1;
+
+    const int ret = scdFreqSet(data->freq, folded, len, frequency);
+    scdFoldRelease(folded, word, buf);
+    return ret;
+}
+
+int scdRemoveWord(SpellCheckerDataHandle data, const char *word)
+{
+    if (!data || !word)
+    {
+        printf("Invalid arguments when trying to remove a word\n");
+        return -1;
+    }
+
+    if (!data->backend->removeWord)
+    {
+        printf("Cannot remove words from a %s data model\n",
+               data->backend->name);
+        return -1;
+    }
+
+    size_t len = strlen(word);
+    if (!scdIsValid(data, word, len))
+    {
+#ifdef DEBUG
+        printf("Attempted to remove an invalid word (%s) from dictionary\n",
+               word);
+#endif
+        return -1;
+    }
+
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, word, &len, buf);
+    if (!folded)
+        return -1;
+
+    /* Out of the hot words first, as they are looked up before the backend */
+    int ret = -1;
+    if (!data->freq || !scdFreqGet(data->freq, folded, len) ||
+        ((0 == scdFreqSet(data->freq, folded, len, 0)) &&
+         (0 == scdFreqCommit(data->freq))))
+    {
+        __atomic_store_n(&data->hasRemovals, 1, __ATOMIC_RELEASE);
+        ret = data->backend->removeWord(data, folded, len);
+        scdBumpGeneration(data);
+    }
+
+    scdFoldRelease(folded, word, buf);
+    return ret;
+}
+
+/*
+ * Words are handed to the backend in batches of this size, to keep the batch
+ * on the stack.
+ */
+#define SCD_ADD_WORDS_BATCH 256
+
+/*
+ * The size of the buffer the words of a batch are folded into, on the stack.
+ * A batch is cut short when the buffer is full.
+ */
+#define SCD_FOLD_ARENA 4096
+
+static int scdAddBatch(SpellCheckerDataHandle data, const char **words,
+                       const size_t *lens, size_t numWords)
+{
+    scdIndexWords(data, words, lens, numWords);
+
+    int ret = 0;
+    if (data->backend->addWords)
+    {
+        ret = data->backend->addWords(data, words, lens, numWords);
+    }
+    else
+    {
+        for (size_t i = 0; (0 == ret) && (i < numWords); ++i)
+            ret = data->backend->addWord(data, words[i], lens[i]);
+    }
 
-    /* Find existing nodes (characters) */
-    while ((i < n) && (0 != node->child[scdNormalizeChar(word[i])].chr))
+    scdBumpGeneration(data);
+    return ret;
+}
+
+int scdAddWords(SpellCheckerDataHandle data, const char *buf, size_t len)
+{
+    if (!data || (!buf && len))
     {
-        node = &node->child[scdNormalizeChar(word[i])];
-        ++i;
+        printf("Invalid arguments when trying to add words\n");
+        return -1;
     }
 
-    /* If word is longer than what we have stored, we need to add each letter */
-    while (i < n)
+    const char *words[SCD_ADD_WORDS_BATCH];
+    size_t lens[SCD_ADD_WORDS_BATCH];
+    size_t numWords = 0;
+    char arena[SCD_FOLD_ARENA];
+    size_t arenaUsed = 0;
+    const char *end = buf + len;
+
+    while (buf < end)
     {
-        if (-1 == scdInitNode(scdNormalizeChar(word[i]),
-                              &node->child[scdNormalizeChar(word[i])]))
+        const char *eol = memchr(buf, '\n', end - buf);
+        if (!eol)
+            eol = end;
+
+        size_t wordLen = eol - buf;
+        if (wordLen && ('\r' == buf[wordLen - 1]))
+            --wordLen;
+
+        if (wordLen && scdIsValid(data, buf, wordLen))
         {
-            /* TODO: cleanup nodes that were already created */
-            return -1;
+            const char *word = buf;
+            if (data->isUtf8 && !scuIsAscii(buf, wordLen))
+            {
+                if (SCU_MAX_FOLDED_LEN(wordLen) > SCD_FOLD_ARENA - arenaUsed)
+                {
+                    if (numWords &&
+                        (-1 == scdAddBatch(data, words, lens, numWords)))
+                        return -1;
+                    numWords = 0;
+                    arenaUsed = 0;
+                }
+
+                /* Too long for the arena, on its own */
+                if (SCU_MAX_FOLDED_LEN(wordLen) > SCD_FOLD_ARENA)
+                {
+                    char wordBuf[SCD_FOLD_BUF + 1];
+                    const char *folded = scdFold(data, buf, &wordLen, wordBuf);
+                    const int ret = folded ?
+                        scdAddBatch(data, &folded, &wordLen, 1) : -1;
+                    scdFoldRelease(folded, buf, wordBuf);
+                    if (-1 == ret)
+                        return -1;
+                    buf = (eol == end) ? end : eol + 1;
+                    continue;
+                }
+
+                word = &arena[arenaUsed];
+                wordLen = scuFoldWord(buf, wordLen, &arena[arenaUsed]);
+                arenaUsed += wordLen;
+            }
+
+            words[numWords] = word;
+            lens[numWords] = wordLen;
+            if (SCD_ADD_WORDS_BATCH == ++numWords)
+            {
+                if (-1 == scdAddBatch(data, words, lens, numWords))
+                    return -1;
+                numWords = 0;
+                arenaUsed = 0;
+            }
         }
-        node = &node->child[scdNormalizeChar(word[i])];
-        ++i;
+#ifdef DEBUG
+        else if (wordLen)
+        {
+            printf("Attempted to add an invalid word (%.*s) to dictionary\n",
+                   (int)wordLen, buf);
+        }
+#endif
+
+        buf = (eol == end) ? end : eol + 1;
     }
 
-    return 0;
+    return numWords ? scdAddBatch(data, words, lens, numWords) : 0;
+}
+
+int scdCommit(SpellCheckerDataHandle data)
+{
+    if (!data)
+    {
+        printf("Invalid arguments passed to scdCommit\n");
+        return -1;
+    }
+
+    if (data->backend->commit)
+    {
+        const int ret = data->backend->commit(data);
+        scdBumpGeneration(data);
+        if (-1 == ret)
+            return -1;
+    }
+
+    /* After the backend, so that hot words are always visible in it too */
+    return data->freq ? scdFreqCommit(data->freq) : 0;
+}
+
+/*
+ * Answer the lookup of a hot word without going to the backend.
+ */
+static inline int scdIsHot(SpellCheckerDataHandle data, const char *word,
+                           size_t len)
+{
+    const ScdFreq *freq = __atomic_load_n(&data->freq, __ATOMIC_ACQUIRE);
+    return freq && scdFreqIsHot(freq, word, len);
 }
 
 int scdHasWord(SpellCheckerDataHandle data, const char *word)
 {
-    if (!data || !word || !data->child)
+    if (!data || !word)
     {
         printf("Invalid arguments passed to scdHasWord\n");
         return -1;
     }
 
-    SpellCheckerDataHandle node = data;
-    const size_t n = strlen(word);
+    return scdHasWordLen(data, word, strlen(word));
+}
+
+/*
+ * Same as scdHasWordLen(), for a word already folded.
+ */
+static int scdHasFoldedWord(SpellCheckerDataHandle data, const char *word,
+                            size_t len)
+{
+    if (scdIsHot(data, word, len))
+        return 1;
+
+    const int ret = data->backend->hasWord(data, word, len);
+    if ((0 == ret) && data->below)
+        return scdHasFoldedWord(data->below, word, len);
+    return ret;
+}
+
+int scdHasWordLen(SpellCheckerDataHandle data, const char *word, size_t len)
+{
+    if (!data || (!word && len))
+    {
+        printf("Invalid arguments passed to scdHasWordLen\n");
+        return -1;
+    }
+
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, word, &len, buf);
+    if (!folded)
+        return -1;
+
+    const int ret = scdHasFoldedWord(data, folded, len);
+    scdFoldRelease(folded, word, buf);
+    return ret;
+}
+
+/*
+ * Number of words a batch lookup passes at once to the lower data model.
+ */
+#define SCD_LAYER_BATCH 64
+
+static int scdHasFoldedWords(SpellCheckerDataHandle data, const char **words,
+                             const size_t *lens, size_t numWords,
+                             uint8_t *results);
+
+/*
+ * Look up in the lower data model the words of a batch that are not in the
+ * upper one, a sub-batch at a time.
+ */
+static int scdHasWordsBelow(SpellCheckerDataHandle data, const char **words,
+                            const size_t *lens, size_t numWords,
+                            uint8_t *results)
+{
+    const char *missed[SCD_LAYER_BATCH];
+    size_t missedLens[SCD_LAYER_BATCH];
+    size_t positions[SCD_LAYER_BATCH];
+    uint8_t found[SCD_LAYER_BATCH];
+
+    size_t i = 0;
+    while (i < numWords)
+    {
+        size_t num = 0;
+        for (; (i < numWords) && (num < SCD_LAYER_BATCH); ++i)
+        {
+            if (results[i])
+                continue;
+            missed[num] = words[i];
+            missedLens[num] = lens[i];
+            positions[num] = i;
+            ++num;
+        }
+
+        if (num && (-1 == scdHasFoldedWords(data->below, missed, missedLens,
+                                            num, found)))
+            return -1;
+        for (size_t j = 0; j < num; ++j)
+            results[positions[j]] = found[j];
+    }
+    return 0;
+}
+
+/*
+ * Same as scdHasWords(), for words already folded.
+ */
+static int scdHasFoldedWords(SpellCheckerDataHandle data, const char **words,
+                             const size_t *lens, size_t numWords,
+                             uint8_t *results)
+{
+    /* Hot words are in the backend too, they are only a shortcut */
+    if (data->backend->hasWords)
+    {
+        if (-1 == data->backend->hasWords(data, words, lens, numWords,
+                                          results))
+            return -1;
+    }
+    else
+    {
+        for (size_t i = 0; i < numWords; ++i)
+        {
+            const int ret = data->backend->hasWord(data, words[i], lens[i]);
+            if (-1 == ret)
+                return -1;
+            results[i] = ret;
+        }
+    }
+
+    return data->below ?
+        scdHasWordsBelow(data, words, lens, numWords, results) : 0;
+}
+
+/*
+ * Look up a batch of words of a UTF-8 data model, folding them into an arena
+ * a sub-batch at a time.
+ */
+static int scdHasWordsUtf8(SpellCheckerDataHandle data, const char **words,
+                           const size_t *lens, size_t numWords,
+                           uint8_t *results)
+{
+    const char *folded[SCD_LAYER_BATCH];
+    size_t foldedLens[SCD_LAYER_BATCH];
+    char arena[SCD_FOLD_ARENA];
+
     size_t i = 0;
-    while (i < n)
+    while (i < numWords)
     {
-        if (0 == node->child[scdNormalizeChar(word[i])].chr)
-            return 0;
+        size_t num = 0;
+        size_t arenaUsed = 0;
+        for (; (i + num < numWords) && (num < SCD_LAYER_BATCH); ++num)
+        {
+            const char *word = words[i + num];
+            const size_t len = lens[i + num];
+            if (scuIsAscii(word, len))
+            {
+                folded[num] = word;
+                foldedLens[num] = len;
+                continue;
+            }
+            if (SCU_MAX_FOLDED_LEN(len) > SCD_FOLD_ARENA - arenaUsed)
+                break;
+            folded[num] = &arena[arenaUsed];
+            foldedLens[num] = scuFoldWord(word, len, &arena[arenaUsed]);
+            arenaUsed += foldedLens[num];
+        }
+
+        if (num)
+        {
+            if (-1 == scdHasFoldedWords(data, folded, foldedLens, num,
+                                        &results[i]))
+                return -1;
+            i += num;
+        }
         else
-            node = &node->child[scdNormalizeChar(word[i])];
-        ++i;
+        {
+            /* Too long for the arena, on its own */
+            const int ret = scdHasWordLen(data, words[i], lens[i]);
+            if (-1 == ret)
+                return -1;
+            results[i++] = ret;
+        }
+    }
+    return 0;
+}
+
+int scdHasWords(SpellCheckerDataHandle data, const char **words,
+                const size_t *lens, size_t numWords, uint8_t *results)
+{
+    if (!data || ((!words || !lens || !results) && numWords))
+    {
+        printf("Invalid arguments passed to scdHasWords\n");
+        return -1;
+    }
+
+    /* Batches of ASCII words (English text, mostly) need no folding */
+    size_t numAscii = 0;
+    while (data->isUtf8 && (numAscii < numWords) &&
+           scuIsAscii(words[numAscii], lens[numAscii]))
+        ++numAscii;
+
+    return (data->isUtf8 && (numAscii < numWords)) ?
+        scdHasWordsUtf8(data, words, lens, numWords, results) :
+        scdHasFoldedWords(data, words, lens, numWords, results);
+}
+
+/*
+ * Suggestions are found by walking the prefixes of the dictionary (see
+ * ScdPrefixCallback), computing for each prefix its row of the edit distance
+ * matrix against the word: row[j] is the distance between the prefix and the
+ * first j characters of the word, computed from the rows of the two shorter
+ * prefixes. When no entry of a row is within the threshold, no word starting
+ * with that prefix can be, and the walk skips them. The cost of a search thus
+ * follows the branches of the dictionary close to the word, rather than the
+ * size of the dictionary (at least for the Trie and the DAWG, which share
+ * prefixes).
+ *
+ * Once maxResults suggestions are found, the threshold drops to the distance
+ * of the worst of them. Suggestions at the same distance are ranked by
+ * frequency, most frequent first.
+ *
+ * The data models of a layered one are searched in turn, from the top, with
+ * the same results and threshold.
+ */
+typedef struct ScdSuggestion
+{
+    char *word;
+    unsigned int distance;
+    uint32_t frequency;
+} ScdSuggestion;
+
+typedef struct ScdSuggestSearch
+{
+    unsigned char *word; /* normalized */
+    size_t len;
+
+    /* The rows of the prefixes walked so far, (len + 1) entries per depth */
+    unsigned int *rows;
+    /* The current prefix, null-terminated when offered */
+    char *prefix;
+    size_t capacity; /* in depths, for both */
+
+    const ScdFreq *freq; /* NULL if no word has a frequency */
+    /* Set if words were removed, to look up the ones found in the index */
+    SpellCheckerDataHandle data;
+    /* Set if several data models are searched, which may share words */
+    int isLayered;
+    unsigned int threshold;
+    ScdSuggestion *results; /* sorted, best first */
+    size_t numResults;
+    size_t maxResults;
+} ScdSuggestSearch;
+
+static int scdSuggestGrow(ScdSuggestSearch *search, size_t depth)
+{
+    if (depth < search->capacity)
+        return 0;
+
+    const size_t capacity = 2 * depth;
+    unsigned int *rows = realloc(search->rows, capacity * (search->len + 1) *
+                                 sizeof(unsigned int));
+    if (!rows)
+    {
+        printf("Failed allocating memory for suggestions\n");
+        return -1;
+    }
+    search->rows = rows;
+
+    char *prefix = realloc(search->prefix, capacity + 1);
+    if (!prefix)
+    {
+        printf("Failed allocating memory for suggestions\n");
+        return -1;
+    }
+    search->prefix = prefix;
+    search->capacity = capacity;
+
+    return 0;
+}
+
+/*
+ * @return a negative value if suggestion a goes before b, a positive one if
+ * it goes after.
+ */
+static int scdSuggestionCompare(const ScdSuggestion *a, const ScdSuggestion *b)
+{
+    if (a->distance != b->distance)
+        return (a->distance < b->distance) ? -1 : 1;
+    if (a->frequency != b->frequency)
+        return (a->frequency > b->frequency) ? -1 : 1;
+    return strcmp(a->word, b->word);
+}
+
+/*
+ * Add the current prefix to the suggestions, if it is among the best ones.
+ */
+static int scdSuggestOffer(ScdSuggestSearch *search, size_t depth,
+                           unsigned int distance)
+{
+    search->prefix[depth] = '\0';
+
+    /* A word of several layers is kept as found in the top one */
+    if (search->isLayered)
+    {
+        for (size_t i = 0; i < search->numResults; ++i)
+        {
+            if (0 == strcmp(search->results[i].word, search->prefix))
+                return 0;
+        }
+    }
+
+    ScdSuggestion suggestion;
+    suggestion.word = search->prefix;
+    suggestion.distance = distance;
+    suggestion.frequency = search->freq ?
+        scdFreqGet(search->freq, search->prefix, depth) : 0;
+
+    size_t pos = search->numResults;
+    while ((pos > 0) &&
+           (scdSuggestionCompare(&suggestion,
+                                 &search->results[pos - 1]) < 0))
+        --pos;
+    if (pos == search->maxResults)
+        return 0;
+
+    char *word = malloc(depth + 1);
+    if (!word)
+    {
+        printf("Failed allocating memory for suggestion\n");
+        return -1;
+    }
+    memcpy(word, search->prefix, depth + 1);
+
+    if (search->numResults == search->maxResults)
+        free(search->results[--search->numResults].word);
+    memmove(&search->results[pos + 1], &search->results[pos],
+            (search->numResults - pos) * sizeof(ScdSuggestion));
+    suggestion.word = word;
+    search->results[pos] = suggestion;
+    ++search->numResults;
+
+    if (search->numResults == search->maxResults)
+        search->threshold = search->results[search->numResults - 1].distance;
+
+    return 0;
+}
+
+static int scdSuggestIndexed(const char *word, size_t len,
+                             unsigned int distance, void *userdata)
+{
+    ScdSuggestSearch *search = userdata;
+    if (distance > search->threshold)
+        return 0;
+
+    /* Removed words stay in the index */
+    if (search->data &&
+        (1 != search->data->backend->hasWord(search->data, word, len)))
+        return 0;
+
+    if (-1 == scdSuggestGrow(search, len))
+        return -1;
+    memcpy(search->prefix, word, len);
+    return scdSuggestOffer(search, len, distance);
+}
+
+static int scdSuggestPrefix(unsigned char chr, size_t depth, int isWord,
+                            void *userdata)
+{
+    ScdSuggestSearch *search = userdata;
+    if (-1 == scdSuggestGrow(search, depth))
+        return -1;
+
+    const unsigned char *word = search->word;
+    const size_t width = search->len + 1;
+    unsigned int *row = &search->rows[depth * width];
+    const unsigned int *prev = row - width;
+    search->prefix[depth - 1] = chr;
+
+    row[0] = depth;
+    unsigned int best = row[0];
+    for (size_t j = 1; j < width; ++j)
+    {
+        unsigned int d = prev[j - 1] + (word[j - 1] != chr);
+        if (prev[j] + 1 < d)
+            d = prev[j] + 1;
+        if (row[j - 1] + 1 < d)
+            d = row[j - 1] + 1;
+        /* Swapped characters */
+        if ((depth > 1) && (j > 1) && (word[j - 2] == chr) &&
+            (word[j - 1] == (unsigned char)search->prefix[depth - 2]) &&
+            (prev[j - 2 - width] + 1 < d))
+            d = prev[j - 2 - width] + 1;
+        row[j] = d;
+        if (d < best)
+            best = d;
+    }
+
+    if (isWord && (row[width - 1] <= search->threshold) &&
+        (-1 == scdSuggestOffer(search, depth, row[width - 1])))
+        return -1;
+
+    return (best <= search->threshold) ? 1 : 0;
+}
+
+/*
+ * Add the suggestions found in one data model (of a layered one) to the
+ * search.
+ */
+static int scdSuggestIn(SpellCheckerDataHandle data, const char *word,
+                        unsigned int maxDistance, ScdSuggestSearch *search)
+{
+    search->freq = __atomic_load_n(&data->freq, __ATOMIC_ACQUIRE);
+    search->data = __atomic_load_n(&data->hasRemovals, __ATOMIC_ACQUIRE) ?
+        data : NULL;
+
+    const ScdIndex *index = __atomic_load_n(&data->index, __ATOMIC_ACQUIRE);
+    if (index && (maxDistance <= scdIndexMaxDistance(index)))
+        return scdIndexSuggest(index, word, search->len, maxDistance,
+                               scdSuggestIndexed, search);
+
+    for (size_t j = 0; j <= search->len; ++j)
+        search->rows[j] = j;
+    return data->backend->forEachPrefix(data, scdSuggestPrefix, search);
+}
+
+int scdSuggest(SpellCheckerDataHandle data, const char *word,
+               unsigned int maxDistance, size_t maxResults, char **out)
+{
+    if (!data || !word || (!out && maxResults))
+    {
+        printf("Invalid arguments passed to scdSuggest\n");
+        return -1;
+    }
+
+    if (maxResults > SCD_MAX_SUGGESTIONS)
+        maxResults = SCD_MAX_SUGGESTIONS;
+    if (0 == maxResults)
+        return 0;
+
+    ScdSuggestSearch search;
+    search.len = strlen(word);
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, word, &search.len, buf);
+    if (!folded)
+        return -1;
+
+    search.word = malloc(search.len + 1);
+    search.rows = NULL;
+    search.prefix = NULL;
+    search.capacity = 0;
+    search.isLayered = (NULL != data->below);
+    search.threshold = maxDistance;
+    search.results = malloc(maxResults * sizeof(ScdSuggestion));
+    search.numResults = 0;
+    search.maxResults = maxResults;
+
+    int ret = -1;
+    if (!search.word || !search.results)
+    {
+        printf("Failed allocating memory for suggestions\n");
+        goto out;
+    }
+    for (size_t i = 0; i < search.len; ++i)
+        search.word[i] = scdNormalizeChar(folded[i]);
+
+    if (-1 == scdSuggestGrow(&search, 1))
+        goto out;
+
+    for (SpellCheckerDataHandle layer = data; layer; layer = layer->below)
+    {
+        if (-1 == scdSuggestIn(layer, folded, maxDistance, &search))
+            goto out;
+    }
+
+    for (size_t i = 0; i < search.numResults; ++i)
+        out[i] = search.results[i].word;
+    ret = search.numResults;
+    search.numResults = 0;
+
+out:
+    for (size_t i = 0; i < search.numResults; ++i)
+        free(search.results[i].word);
+    free(search.results);
+    free(search.prefix);
+    free(search.rows);
+    free(search.word);
+    scdFoldRelease(folded, word, buf);
+    return ret;
+}
+
+/*
+ * Prefix queries walk the prefixes of the dictionary along the given prefix
+ * only, so the trie and the DAWG answer them in O(prefix length). The hash
+ * backend has no shared prefixes, and walks the first character of every word.
+ */
+typedef struct ScdPrefixSearch
+{
+    const char *prefix;
+    size_t len;
+
+    /* The current path, null-terminated when offered */
+    char *path;
+    size_t capacity;
+
+    int found;
+    char **results; /* sorted */
+    size_t numResults;
+    size_t maxResults;
+} ScdPrefixSearch;
+
+/*
+ * Check that the path walked follows the prefix.
+ * @return 1 if the path is a prefix of the prefix, 0 if the path went off it,
+ * and 2 once the path covers the whole prefix.
+ */
+static inline int scdPrefixFollow(const ScdPrefixSearch *search,
+                                  unsigned char chr, size_t depth)
+{
+    if (depth > search->len)
+        return 2;
+    if (scdNormalizeChar(search->prefix[depth - 1]) != chr)
+        return 0;
+    return (depth == search->len) ? 2 : 1;
+}
+
+static int scdHasPrefixStep(unsigned char chr, size_t depth, int isWord,
+                            void *userdata)
+{
+    ScdPrefixSearch *search = userdata;
+    (void)isWord;
+
+    const int ret = scdPrefixFollow(search, chr, depth);
+    if (2 != ret)
+        return ret;
+
+    /* Any word reaching this far starts with the prefix, stop the walk */
+    search->found = 1;
+    return -1;
+}
+
+int scdHasPrefix(SpellCheckerDataHandle data, const char *prefix)
+{
+    if (!data || !prefix)
+    {
+        printf("Invalid arguments passed to scdHasPrefix\n");
+        return -1;
+    }
+
+    size_t len = strlen(prefix);
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, prefix, &len, buf);
+    if (!folded)
+        return -1;
+
+    int ret = 0;
+    for (SpellCheckerDataHandle layer = data; layer && (0 == ret);
+         layer = layer->below)
+    {
+        ScdPrefixSearch search = { folded, len, NULL, 0, 0, NULL, 0, 0 };
+        ret = layer->backend->forEachPrefix(layer, scdHasPrefixStep, &search);
+        if (search.found)
+            ret = 1;
+    }
+
+    scdFoldRelease(folded, prefix, buf);
+    return ret;
+}
+
+/*
+ * Compare the current path with a result.
+ */
+static int scdCompleteCompare(const ScdPrefixSearch *search, size_t depth,
+                              const char *result)
+{
+    const size_t len = strlen(result);
+    const int ret = memcmp(search->path, result, (depth < len) ? depth : len);
+    if (ret)
+        return ret;
+    return (depth > len) - (depth < len);
+}
+
+static int scdCompleteStep(unsigned char chr, size_t depth, int isWord,
+                           void *userdata)
+{
+    ScdPrefixSearch *search = userdata;
+    const int follow = scdPrefixFollow(search, chr, depth);
+    if (0 == follow)
+        return 0;
+
+    if (depth + 1 > search->capacity)
+    {
+        const size_t capacity = 2 * (depth + 1);
+        char *path = realloc(search->path, capacity);
+        if (!path)
+        {
+            printf("Failed allocating memory for completions\n");
+            return -1;
+        }
+        search->path = path;
+        search->capacity = capacity;
+    }
+    search->path[depth - 1] = chr;
+    if (1 == follow)
+        return 1;
+
+    /* The longer paths only sort after this one */
+    const int full = (search->numResults == search->maxResults);
+    if (full && (scdCompleteCompare(search, depth,
+                                    search->results[search->numResults - 1])
+                 >= 0))
+        return 0;
+    if (!isWord)
+        return 1;
+
+    search->path[depth] = '\0';
+    size_t pos = search->numResults;
+    while ((pos > 0) && (strcmp(search->path, search->results[pos - 1]) < 0))
+        --pos;
+    if ((pos > 0) && (0 == strcmp(search->path, search->results[pos - 1])))
+        return 1;
+
+    char *word = malloc(depth + 1);
+    if (!word)
+    {
+        printf("Failed allocating memory for completion\n");
+        return -1;
+    }
+    memcpy(word, search->path, depth + 1);
+
+    if (full)
+        free(search->results[--search->numResults]);
+    memmove(&search->results[pos + 1], &search->results[pos],
+            (search->numResults - pos) * sizeof(char*));
+    search->results[pos] = word;
+    ++search->numResults;
+
+    return 1;
+}
+
+int scdComplete(SpellCheckerDataHandle data, const char *prefix,
+                size_t maxResults, char **out)
+{
+    if (!data || !prefix || (!out && maxResults))
+    {
+        printf("Invalid arguments passed to scdComplete\n");
+        return -1;
+    }
+
+    if (maxResults > SCD_MAX_COMPLETIONS)
+        maxResults = SCD_MAX_COMPLETIONS;
+    if (0 == maxResults)
+        return 0;
+
+    size_t len = strlen(prefix);
+    char buf[SCD_FOLD_BUF + 1];
+    const char *folded = scdFold(data, prefix, &len, buf);
+    if (!folded)
+        return -1;
+
+    ScdPrefixSearch search = { folded, len, NULL, 0, 0, NULL, 0, maxResults };
+    search.path = malloc(len + 1);
+    search.capacity = len + 1;
+    search.results = malloc(maxResults * sizeof(char*));
+
+    int ret = -1;
+    if (!search.path || !search.results)
+    {
+        printf("Failed allocating memory for completions\n");
+        goto out;
+    }
+
+    /* The layers add to the same sorted results, which skip duplicates */
+    for (SpellCheckerDataHandle layer = data; layer; layer = layer->below)
+    {
+        if (-1 == layer->backend->forEachPrefix(layer, scdCompleteStep,
+                                                &search))
+            goto out;
+    }
+
+    memcpy(out, search.results, search.numResults * sizeof(char*));
+    ret = search.numResults;
+    search.numResults = 0;
+
+out:
+    for (size_t i = 0; i < search.numResults; ++i)
+        free(search.results[i]);
+    free(search.results);
+    free(search.path);
+    scdFoldRelease(folded, prefix, buf);
+    return ret;
+}
+
+static int scdCompileWord(const char *word, size_t len, void *userdata)
+{
+    SpellCheckerDataHandle dawg = userdata;
+    return dawg->backend->addWord(dawg, word, len);
+}
+
+/*
+ * The index to write along with the words. The index still holds the removed
+ * words, which a mapped image cannot look up to skip: once words were removed,
+ * index the remaining ones again. It holds fewer words than the current index,
+ * so no budget is needed.
+ * @return 0 on success, -1 on failure.
+ */
+static int scdCompileIndex(SpellCheckerDataHandle data, ScdIndex **index)
+{
+    *index = data->index;
+    if (!*index || !data->hasRemovals)
+        return 0;
+
+    *index = scdIndexInit(&data->epoch, scdIndexMaxDistance(data->index), 0);
+    if (!*index)
+        return -1;
+
+    if (-1 == data->backend->forEachWord(data, scdIndexWord, *index))
+    {
+        scdIndexFinalize(*index);
+        return -1;
+    }
+    return 0;
+}
+
+int scdCompile(SpellCheckerDataHandle data, const char *path)
+{
+    if (!data || !path)
+    {
+        printf("Invalid arguments passed to scdCompile\n");
+        return -1;
+    }
+
+    if (data->below)
+    {
+        printf("Cannot compile a layered data model\n");
+        return -1;
+    }
+
+    ScdIndex *index;
+    if (-1 == scdCompileIndex(data, &index))
+        return -1;
+
+    int ret = -1;
+    if (&scdDawgBackend == data->backend)
+    {
+        ret = scdDawgWriteImage(data, index, path);
+    }
+    else
+    {
+        SpellCheckerDataHandle dawg = scdInit(SCD_BACKEND_DAWG);
+        if (dawg)
+        {
+            /* The words are folded already, only the image needs it */
+            dawg->isUtf8 = data->isUtf8;
+            ret = data->backend->forEachWord(data, scdCompileWord, dawg);
+            if (0 == ret)
+                ret = scdDawgWriteImage(dawg, index, path);
+
+            scdFinalize(dawg);
+        }
+    }
+
+    if (index != data->index)
+        scdIndexFinalize(index);
+    return ret;
+}
+
+SpellCheckerDataHandle scdOpenImage(const char *path)
+{
+    if (!path)
+    {
+        printf("Invalid arguments passed to scdOpenImage\n");
+        return NULL;
+    }
+
+    SpellCheckerDataHandle data = scdDawgOpenImage(path);
+    if (data)
+        sceInit(&data->epoch);
+    return data;
+}
+
+int scdLayerOver(SpellCheckerDataHandle data, SpellCheckerDataHandle below)
+{
+    if (!data || !below || (data == below))
+    {
+        printf("Invalid arguments passed to scdLayerOver\n");
+        return -1;
+    }
+
+    if (data->below || (&scdDawgImageBackend != below->backend))
+    {
+        printf("A data model can only be layered once, over a mapped image\n");
+        return -1;
+    }
+
+    data->below = below;
+    data->isUtf8 = below->isUtf8;
+    return 0;
+}
+
+int scdGetStats(SpellCheckerDataHandle data, ScdStats *stats)
+{
+    if (!data || !stats)
+    {
+        printf("Invalid arguments passed to scdGetStats\n");
+        return -1;
     }
 
-    return (i == n);
+    data->backend->getStats(data, stats);
+    if (data->index)
+        stats->bytes += scdIndexMemory(data->index);
+    if (data->freq)
+        stats->bytes += scdFreqMemory(data->freq);
+    return 0;
+}
+
+unsigned int scdReadLock(SpellCheckerDataHandle data)
+{
+    return sceReadLock(&data->epoch);
+}
+
+void scdReadUnlock(SpellCheckerDataHandle data, unsigned int token)
+{
+    sceReadUnlock(&data->epoch, token);
+}
+
+void scdReclaim(SpellCheckerDataHandle data)
+{
+    if (data)
+        sceReclaim(&data->epoch);
 }
@@ -1,24 +1,62 @@
 #ifndef __SPELL_CHECKER_DATA_H
 #define __SPELL_CHECKER_DATA_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * A data model for storing dictionary words.
+ *
+ * The data model is an interface with multiple backends (see
+ * spell-checker_data_backend.h), each with its own memory/speed trade-off.
+ * The backend is selected when the data model is initialized.
+ *
+ * A data model has a single writer: all the functions below must be called
+ * from the same thread, except for lookups (scdHasWord(), scdHasWordLen(),
+ * scdHasWords(), scdHasPrefix(), scdSuggest(), scdComplete()),
+ * which can be called from any number of threads at once, concurrently with
+ * the writer, as long as they are made between scdReadLock() and
+ * scdReadUnlock(). Lookups never block, and never block the writer.
  */
 
 struct _SpellCheckerData;
 typedef struct _SpellCheckerData *SpellCheckerDataHandle;
 
+typedef enum ScdBackendType { SCD_BACKEND_TRIE,
+                              SCD_BACKEND_HASH,
+                              SCD_BACKEND_DAWG } ScdBackendType;
+
 /**
  * Initialize the data model.
- * @return a handle to the data model.
+ * @param type the backend to use for storing the words.
+ * @return a handle to the data model, or NULL on failure.
  */
-SpellCheckerDataHandle scdInit(void);
+SpellCheckerDataHandle scdInit(ScdBackendType type);
 
 /**
  * Finalize the data model, releasing all the resources attached to it.
  */
 void scdFinalize(SpellCheckerDataHandle data);
 
+/**
+ * Make the data model a UTF-8 one (see spell-checker_unicode.h): its words
+ * are made of Unicode letters, marks and digits, and are compared under simple
+ * case folding. Words, prefixes and the words suggested for are folded before
+ * anything else (ASCII-only ones are left as they are, the backends fold
+ * their letters), and the words returned (suggestions, completions) are
+ * folded ones. Must be called before any word is added. Compiled images keep
+ * the setting.
+ * @param data a handle to the current data model.
+ * @return 0 on success, -1 on failure.
+ */
+int scdSetUtf8(SpellCheckerDataHandle data);
+
+/**
+ * @return non-zero if the data model is a UTF-8 one (see scdSetUtf8()), 0 if
+ * not.
+ */
+int scdIsUtf8(SpellCheckerDataHandle data);
+
 /**
  * Add a word to the dictionary.
  * @param data a handle to the current data model.
@@ -27,12 +65,252 @@ void scdFinalize(SpellCheckerDataHandle data);
  */
 int scdAddWord(SpellCheckerDataHandle data, const char *word);
 
+/**
+ * Add a word to the dictionary, along with its frequency (any measure of how
+ * common the word is, e.g. its number of occurrences in a corpus), which
+ * replaces the previous one if the word already had one. Frequencies rank the
+ * suggestions of scdSuggest(), and the most frequent words are looked up first
+ * (see spell-checker_data_freq.h).
+ * @param data a handle to the current data model.
+ * @param word the word to add.
+ * @param frequency the frequency of the word, 0 for none.
+ * @return 0 on success, -1 on failure.
+ */
+int scdAddWordWithFrequency(SpellCheckerDataHandle data, const char *word,
+                            unsigned int frequency);
+
+/**
+ * Add a batch of words to the dictionary.
+ * @param data a handle to the current data model.
+ * @param buf newline-separated words (a trailing '\r' on a line is ignored).
+ * Empty lines are skipped. Invalid words are rejected, and do not stop the
+ * rest of the batch from being added.
+ * @param len the size of buf, in bytes.
+ * @return 0 on success (even if some words were rejected), -1 on failure.
+ */
+int scdAddWords(SpellCheckerDataHandle data, const char *buf, size_t len);
+
+/**
+ * Remove a word from the dictionary. The memory only the word used is
+ * reclaimed once no reader can reach it anymore, except in the hash backend,
+ * whose words stay in its string pool. The word may stay in the suggestion
+ * index, which is checked against the backend once words were removed.
+ * Mapped images are read-only.
+ * @param data a handle to the current data model.
+ * @param word the word to remove.
+ * @return 0 on success (whether the word was in the dictionary or not), -1 on
+ * failure.
+ */
+int scdRemoveWord(SpellCheckerDataHandle data, const char *word);
+
+/**
+ * Make all the words added (or removed) so far visible to lookups. Some
+ * backends (DAWG) batch the words added, and only look them up once committed.
+ * @param data a handle to the current data model.
+ * @return 0 on success, -1 on failure.
+ */
+int scdCommit(SpellCheckerDataHandle data);
+
 /**
  * Check if the dictionary contains the word given.
  * @param data a handle to the current data model.
  * @param word the word to check for existance in the dictionary.
- * @return 0 on success, -1 on failure.
+ * @return 1 if the word exists, 0 if it does not, -1 on failure.
  */
 int scdHasWord(SpellCheckerDataHandle data, const char *word);
 
+/**
+ * Same as scdHasWord(), for a word that is not null-terminated.
+ * @param data a handle to the current data model.
+ * @param word the word to check for existance in the dictionary.
+ * @param len the length of the word.
+ * @return 1 if the word exists, 0 if it does not, -1 on failure.
+ */
+int scdHasWordLen(SpellCheckerDataHandle data, const char *word, size_t len);
+
+/**
+ * Same as scdHasWordLen(), for a batch of words at once. Backends that can
+ * overlap the memory accesses of several lookups (the trie and the hash) do,
+ * which is faster than looking the words up one by one.
+ * @param data a handle to the current data model.
+ * @param words the words to check, not necessarily null-terminated.
+ * @param lens the lengths of the words.
+ * @param numWords the number of words.
+ * @param results set to 1 for each word that exists, 0 for the others.
+ * @return 0 on success, -1 on failure.
+ */
+int scdHasWords(SpellCheckerDataHandle data, const char **words,
+                const size_t *lens, size_t numWords, uint8_t *results);
+
+/*
+ * The maximal number of suggestions scdSuggest() looks for at once.
+ */
+#define SCD_MAX_SUGGESTIONS 256
+
+/**
+ * Find the words of the dictionary closest to the given one, by
+ * Damerau-Levenshtein distance (the number of characters inserted, deleted,
+ * substituted, or swapped with the next one; optimal string alignment).
+ * @param data a handle to the current data model.
+ * @param word the word to find suggestions for.
+ * @param maxDistance the maximal distance of a suggestion from the word.
+ * @param maxResults the maximal number of suggestions, capped at
+ * SCD_MAX_SUGGESTIONS.
+ * @param out filled with the suggestions (normalized, null-terminated, to be
+ * released with free()), closest first, then most frequent first, then in
+ * alphabetical order. Must have room for maxResults of them.
+ * @return the number of suggestions, or -1 on failure.
+ */
+int scdSuggest(SpellCheckerDataHandle data, const char *word,
+               unsigned int maxDistance, size_t maxResults, char **out);
+
+/**
+ * Check if any word of the dictionary starts with the given prefix (the prefix
+ * itself included).
+ * @param data a handle to the current data model.
+ * @param prefix the prefix to look for.
+ * @return 1 if a word starts with the prefix, 0 if none does, -1 on failure.
+ */
+int scdHasPrefix(SpellCheckerDataHandle data, const char *prefix);
+
+/*
+ * The maximal number of completions scdComplete() looks for at once.
+ */
+#define SCD_MAX_COMPLETIONS 256
+
+/**
+ * Find the words of the dictionary that start with the given prefix (the
+ * prefix itself included), e.g. to complete a word as it is typed. The trie
+ * and the DAWG stop walking once they have maxResults of them, the hash
+ * backend walks all its words.
+ * @param data a handle to the current data model.
+ * @param prefix the prefix of the words.
+ * @param maxResults the maximal number of words, capped at
+ * SCD_MAX_COMPLETIONS.
+ * @param out filled with the first words in alphabetical order (normalized,
+ * null-terminated, to be released with free()). Must have room for
+ * maxResults of them.
+ * @return the number of words, or -1 on failure.
+ */
+int scdComplete(SpellCheckerDataHandle data, const char *prefix,
+                size_t maxResults, char **out);
+
+/**
+ * Keep a deletion index along with the words, so that scdSuggest() finds the
+ * words within maxDistance with a few hash lookups instead of walking the data
+ * model. The words already in the data model are indexed right away, and the
+ * index is stored in the images compiled from it. If the index outgrows its
+ * budget, it is dropped and scdSuggest() walks the data model again.
+ * @param data a handle to the current data model (not a mapped image), that
+ * does not have an index yet.
+ * @param maxDistance the maximal distance the index answers for, capped at
+ * SCD_INDEX_MAX_DISTANCE (see spell-checker_data_index.h). Larger ones fall
+ * back to a walk.
+ * @param budget the maximal memory of the index in bytes, 0 for no limit.
+ * @return 0 on success, -1 on failure.
+ */
+int scdSetIndex(SpellCheckerDataHandle data, unsigned int maxDistance,
+                size_t budget);
+
+/**
+ * Get the generation of the data model, which changes whenever lookups may
+ * start returning different results (i.e. after words are added, removed or
+ * committed). The result of a lookup can be reused as long as the generation
+ * read before it did not change.
+ * @param data a handle to the current data model.
+ * @return the generation.
+ */
+unsigned int scdGeneration(SpellCheckerDataHandle data);
+
+/**
+ * Continue the generation of the data model a new one replaces (writer only),
+ * so that the lookups made in the previous one are not taken for lookups made
+ * in the new one.
+ * @param data a handle to the new data model.
+ * @param previous a handle to the data model it replaces.
+ */
+void scdContinueGeneration(SpellCheckerDataHandle data,
+                           SpellCheckerDataHandle previous);
+
+/**
+ * The size of a data model, see scdGetStats().
+ *
+ * numWords: the number of words lookups accept (not counting the words added
+ * but not committed yet).
+ * numNodes: the number of nodes of the trie or DAWG, 0 for the hash backend.
+ * bytes: the memory held by the data model (including its suggestion index
+ * and frequencies), or mapped for it.
+ */
+typedef struct ScdStats
+{
+    size_t numWords;
+    size_t numNodes;
+    size_t bytes;
+} ScdStats;
+
+/**
+ * Get the size of the data model. Cheap enough to be called after each change
+ * (writer only).
+ * @param data a handle to the current data model.
+ * @param stats set to the size of the data model.
+ * @return 0 on success, -1 on failure.
+ */
+int scdGetStats(SpellCheckerDataHandle data, ScdStats *stats);
+
+/**
+ * Enter a read-side critical section, in which lookups can be made
+ * concurrently with the writer. The memory of the data model is not released
+ * while the section lasts, so it should be kept short (a batch of lookups).
+ * Lookups made from the writer's thread do not need one.
+ * @param data a handle to the current data model.
+ * @return a token to pass to scdReadUnlock().
+ */
+unsigned int scdReadLock(SpellCheckerDataHandle data);
+
+/**
+ * Leave a read-side critical section.
+ * @param data a handle to the current data model.
+ * @param token the value returned by the matching scdReadLock().
+ */
+void scdReadUnlock(SpellCheckerDataHandle data, unsigned int token);
+
+/**
+ * Release the memory the writer replaced, if no reader can still be looking
+ * at it. Called by the writer, never blocks.
+ * @param data a handle to the current data model.
+ */
+void scdReclaim(SpellCheckerDataHandle data);
+
+/**
+ * Compile the dictionary into a flat, pointer-free image file, that can later
+ * be mapped with scdOpenImage().
+ * @param data a handle to the current data model.
+ * @param path the file to write the image to. It is replaced atomically.
+ * @return 0 on success, -1 on failure.
+ */
+int scdCompile(SpellCheckerDataHandle data, const char *path);
+
+/**
+ * Layer a data model over a mapped image, which many data models can share:
+ * the lookups of the data model (scdHasWord(), scdSuggest(), ...) also find
+ * the words of the image, while its writes (and scdGetStats()) only apply to
+ * its own words. Removing a word of the image is not possible, and a layered
+ * data model cannot be compiled. Must be called before any lookup, and before
+ * any word is added: the data model takes the UTF-8 setting of the image (see
+ * scdSetUtf8()).
+ * @param data a handle to the data model, not layered yet.
+ * @param below a handle to the image (see scdOpenImage()). It is not owned,
+ * and must outlive the data model.
+ * @return 0 on success, -1 on failure.
+ */
+int scdLayerOver(SpellCheckerDataHandle data, SpellCheckerDataHandle below);
+
+/**
+ * Map an image written by scdCompile(). The resulting data model is
+ * read-only: scdAddWord() fails.
+ * @param path the image file.
+ * @return a handle to the data model, or NULL on failure.
+ */
+SpellCheckerDataHandle scdOpenImage(const char *path);
+
 #endif
@@ -0,0 +1,206 @@
+#ifndef __SPELL_CHECKER_DATA_BACKEND_H
+#define __SPELL_CHECKER_DATA_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spell-checker_data.h"
+#include "spell-checker_data_freq.h"
+#include "spell-checker_data_index.h"
+#include "spell-checker_epoch.h"
+
+/*
+ * Callback used to iterate over the words of a data model.
+ * The word is normalized, and not null-terminated.
+ * @return 0 to continue the iteration, -1 to abort it.
+ */
+typedef int (*ScdWordCallback)(const char *word, size_t len, void *userdata);
+
+/*
+ * Callback used to walk the prefixes of the words of a data model, depth-first.
+ * @param chr the (normalized) character extending the previous prefix, i.e.
+ * the prefix walked at depth - 1.
+ * @param depth the length of the prefix, starting at 1.
+ * @param isWord 1 if the prefix is a word, 0 if not.
+ * @return 1 to walk the longer prefixes, 0 to skip them, -1 to abort the walk.
+ */
+typedef int (*ScdPrefixCallback)(unsigned char chr, size_t depth, int isWord,
+                                 void *userdata);
+
+/**
+ * The interface implemented by each of the data model backends.
+ *
+ * The front-end in spell-checker_data.c validates the arguments (and the
+ * words being added) before dispatching, so backends can assume that they get
+ * a valid handle of their own type and a valid word of the given length.
+ * Words are passed as given by the user, and backends are expected to
+ * normalize them with scdNormalizeChar().
+ *
+ * All the operations but hasWord(), hasWords() and forEachPrefix() are only
+ * called from a single (writer) thread. The latter three may run concurrently
+ * with them, from any number of reader threads: a writer publishes changes
+ * with atomic stores (after which readers must see a consistent data model),
+ * and hands the memory readers may still be looking at to sceRetire() (using
+ * the epoch in the data model header) instead of freeing it.
+ */
+typedef struct ScdBackend
+{
+    const char *name;
+
+    /* Create an empty data model. @return NULL on failure. */
+    SpellCheckerDataHandle (*init)(void);
+
+    /* Release all the resources attached to the data model. */
+    void (*finalize)(SpellCheckerDataHandle data);
+
+    /* Add a word. @return 0 on success, -1 on failure. */
+    int (*addWord)(SpellCheckerDataHandle data, const char *word, size_t len);
+
+    /*
+     * Add a batch of words. Optional: if NULL, addWord() is called for each
+     * word. @return 0 on success, -1 on failure.
+     */
+    int (*addWords)(SpellCheckerDataHandle data, const char **words,
+                    const size_t *lens, size_t numWords);
+
+    /*
+     * Remove a word, retiring the memory only it used. Like an add, the
+     * removal may only be visible once committed. Optional: if NULL, words
+     * cannot be removed.
+     * @return 0 on success (whether the word was there or not), -1 on failure.
+     */
+    int (*removeWord)(SpellCheckerDataHandle data, const char *word,
+                      size_t len);
+
+    /*
+     * Make the words added so far visible to hasWord(). Optional: if NULL,
+     * words are visible as soon as they are added.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*commit)(SpellCheckerDataHandle data);
+
+    /*
+     * Look up a word. Must not modify the data model, as it may be called from
+     * multiple threads at once, concurrently with the writer.
+     * @return 1 if found, 0 if not, -1 on failure.
+     */
+    int (*hasWord)(SpellCheckerDataHandle data, const char *word, size_t len);
+
+    /*
+     * Look up a batch of words, setting results[i] to 1 if words[i] is found,
+     * 0 if not. Optional: if NULL, hasWord() is called for each word. Meant
+     * for backends that can overlap the cache misses of several lookups.
+     * Same rules as hasWord(). @return 0 on success, -1 on failure.
+     */
+    int (*hasWords)(SpellCheckerDataHandle data, const char **words,
+                    const size_t *lens, size_t numWords, uint8_t *results);
+
+    /*
+     * Call cb for each word that hasWord() accepts, in no particular order.
+     * @return 0 on success, -1 on failure or if cb aborted the iteration.
+     */
+    int (*forEachWord)(SpellCheckerDataHandle data, ScdWordCallback cb,
+                       void *userdata);
+
+    /*
+     * Walk the prefixes of the words that hasWord() accepts, depth-first (see
+     * ScdPrefixCallback), letting cb prune the walk. A prefix shared by
+     * several words may be walked more than once. Like hasWord(), must not
+     * modify the data model.
+     * @return 0 on success, -1 on failure or if cb aborted the walk.
+     */
+    int (*forEachPrefix)(SpellCheckerDataHandle data, ScdPrefixCallback cb,
+                         void *userdata);
+
+    /*
+     * Get the size of the data model (see ScdStats), leaving out the index
+     * and frequencies, which the front-end adds. Called after each change, so
+     * it must not walk the words.
+     */
+    void (*getStats)(SpellCheckerDataHandle data, ScdStats *stats);
+} ScdBackend;
+
+/*
+ * Every backend's data structure starts with this header, so a
+ * SpellCheckerDataHandle can be dispatched without knowing its type.
+ */
+struct _SpellCheckerData
+{
+    const ScdBackend *backend;
+
+    /* Reclamation of the memory retired by the writer */
+    SceEpoch epoch;
+
+    /*
+     * The suggestion index kept along with the words (see scdSetIndex()), NULL
+     * if none. Maintained by the front-end, backends only store it in images.
+     */
+    ScdIndex *index;
+
+    /*
+     * The frequencies of the words that were given one, NULL if none (see
+     * scdAddWordWithFrequency()). Maintained by the front-end.
+     */
+    ScdFreq *freq;
+
+    /* Bumped whenever lookups may change (see scdGeneration()) */
+    unsigned int generation;
+
+    /*
+     * Set once a word was removed: the index and the frequencies still hold
+     * the removed words, and suggestions are looked up before being offered.
+     */
+    int hasRemovals;
+
+    /*
+     * The read-only data model this one is layered over (see scdLayerOver()),
+     * NULL if none. Not owned.
+     */
+    SpellCheckerDataHandle below;
+
+    /*
+     * Set for UTF-8 data models (see scdSetUtf8()): the front-end folds the
+     * words before passing them on, so backends only see folded words.
+     */
+    int isUtf8;
+};
+
+extern const ScdBackend scdTrieBackend;
+extern const ScdBackend scdHashBackend;
+extern const ScdBackend scdDawgBackend;
+extern const ScdBackend scdDawgImageBackend;
+
+/*
+ * DAWG specifics, used to compile any data model into a DAWG image and to map
+ * such an image back (see spell-checker_data_dawg.c).
+ */
+int scdDawgWriteImage(SpellCheckerDataHandle dawg, const ScdIndex *index,
+                      const char *path);
+SpellCheckerDataHandle scdDawgOpenImage(const char *path);
+
+/*
+ * Return an unsigned char instead of a signed one, and transform upper-case
+ * letters to lower-case.
+ */
+static inline unsigned char scdNormalizeChar(char c)
+{
+    if (('A' <= c) && ('Z' >= c))
+        return c + 0x20;
+    return c;
+}
+
+/*
+ * 64-bit FNV-1a hash of the normalized word.
+ */
+static inline uint64_t scdHashWord(const char *word, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= scdNormalizeChar(word[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#endif
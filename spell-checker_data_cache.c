@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "spell-checker_data_cache.h"
+#include "spell-checker_data_backend.h"
+
+/*
+ * 32 bytes, two entries per cache line.
+ */
+typedef struct ScdCacheEntry
+{
+    uint64_t hash;
+    unsigned int generation;
+    uint8_t len; /* 0 marks an empty entry */
+    uint8_t isWord;
+    char word[SCD_CACHE_MAX_WORD_LEN]; /* normalized, not null-terminated */
+} ScdCacheEntry;
+
+struct ScdCache
+{
+    size_t mask; /* the number of entries, minus 1 */
+    ScdCacheEntry *entries;
+
+    /* Only written by the owner, read by anyone */
+    uint64_t hits;
+    uint64_t misses;
+};
+
+ScdCache *scdCacheInit(size_t size)
+{
+    size_t numEntries = 1;
+    while (numEntries * 2 * sizeof(ScdCacheEntry) <= size)
+        numEntries *= 2;
+    if (numEntries * sizeof(ScdCacheEntry) > size)
+        return NULL;
+
+    ScdCache *cache = malloc(sizeof(ScdCache));
+    if (!cache)
+    {
+        printf("Failed allocating memory for lookup cache\n");
+        return NULL;
+    }
+
+    cache->entries = calloc(numEntries, sizeof(ScdCacheEntry));
+    if (!cache->entries)
+    {
+        printf("Failed allocating memory for lookup cache\n");
+        free(cache);
+        return NULL;
+    }
+    cache->mask = numEntries - 1;
+    cache->hits = 0;
+    cache->misses = 0;
+
+    return cache;
+}
+
+void scdCacheFinalize(ScdCache *cache)
+{
+    if (cache)
+    {
+        free(cache->entries);
+        free(cache);
+    }
+}
+
+int scdCacheHasWord(ScdCache *cache, SpellCheckerDataHandle data,
+                    const char *word, size_t len)
+{
+    if (!len || (len > SCD_CACHE_MAX_WORD_LEN))
+        return scdHasWordLen(data, word, len);
+
+    /* Before the lookup, so that words added meanwhile invalidate its result */
+    const unsigned int generation = scdGeneration(data);
+    const uint64_t hash = scdHashWord(word, len);
+    ScdCacheEntry *entry = &cache->entries[hash & cache->mask];
+
+    if ((entry->hash == hash) && (entry->len == len) &&
+        (entry->generation == generation))
+    {
+        size_t i = 0;
+        while ((i < len) &&
+               ((unsigned char)entry->word[i] == scdNormalizeChar(word[i])))
+            ++i;
+        if (i == len)
+        {
+            __atomic_store_n(&cache->hits, cache->hits + 1, __ATOMIC_RELAXED);
+            return entry->isWord;
+        }
+    }
+
+    __atomic_store_n(&cache->misses, cache->misses + 1, __ATOMIC_RELAXED);
+    const int ret = scdHasWordLen(data, word, len);
+    if (-1 != ret)
+    {
+        entry->hash = hash;
+        entry->generation = generation;
+        entry->len = len;
+        entry->isWord = ret;
+        for (size_t i = 0; i < len; ++i)
+            entry->word[i] = scdNormalizeChar(word[i]);
+    }
+    return ret;
+}
+
+void scdCacheGetStats(const ScdCache *cache, uint64_t *hits,
+                      uint64_t *misses)
+{
+    *hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+    *misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+}
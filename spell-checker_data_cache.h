@@ -0,0 +1,56 @@
+#ifndef __SPELL_CHECKER_DATA_CACHE_H
+#define __SPELL_CHECKER_DATA_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spell-checker_data.h"
+
+/**
+ * A lookup cache, in front of scdHasWordLen(): remembers the result of recent
+ * lookups, both hits and misses, so that the words repeated throughout a text
+ * are only looked up in the data model once.
+ *
+ * A cache is owned by a single thread, and needs no synchronization: it is
+ * direct-mapped by word hash, and each entry holds the (short, normalized)
+ * word it is for. An entry is only valid for the generation of the data model
+ * it was filled in (see scdGeneration()), so adding words invalidates the
+ * whole cache at once, without touching it.
+ */
+
+/*
+ * Longer words are not cached (they are rare, and make entries larger).
+ */
+#define SCD_CACHE_MAX_WORD_LEN 18
+
+struct ScdCache;
+typedef struct ScdCache ScdCache;
+
+/**
+ * Create an empty cache.
+ * @param size the memory of the cache in bytes, rounded down to a power of
+ * two entries (of 32 bytes).
+ * @return the cache, or NULL on failure (or if size is too small).
+ */
+ScdCache *scdCacheInit(size_t size);
+
+/**
+ * Release the cache.
+ */
+void scdCacheFinalize(ScdCache *cache);
+
+/**
+ * Same as scdHasWordLen(), through the cache. Must be called from the thread
+ * owning the cache, within a read-side critical section (as lookups are).
+ */
+int scdCacheHasWord(ScdCache *cache, SpellCheckerDataHandle data,
+                    const char *word, size_t len);
+
+/**
+ * Get the number of lookups answered by the cache (hits) and by the data model
+ * (misses) so far. May be called from any thread.
+ */
+void scdCacheGetStats(const ScdCache *cache, uint64_t *hits,
+                      uint64_t *misses);
+
+#endif
@@ -0,0 +1,1198 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "spell-checker_data_backend.h"
+
+/**
+ * A minimized DAWG (Directed Acyclic Word Graph) to hold the dictionary data.
+ *
+ * See https://en.wikipedia.org/wiki/Deterministic_acyclic_finite_state_automaton
+ *
+ * A DAWG is a Trie in which identical sub-trees are merged, so words share
+ * their suffixes as well as their prefixes ("walking", "talking" and "tall"
+ * share the nodes for "alking" and "all"). For natural language dictionaries
+ * this needs an order of magnitude fewer nodes than a Trie.
+ *
+ * The graph is stored flat, without pointers: an array of nodes, each pointing
+ * to a range of edges in two parallel arrays (the edge characters, sorted, and
+ * the edge target nodes). Node 0 is the root.
+ *
+ * A minimal graph cannot be cheaply updated in place, so words that are added
+ * are kept in a pending buffer, and the graph is rebuilt (with the pending
+ * words merged in) when they are committed. Building uses the incremental
+ * algorithm for sorted input described by Daciuk et al. in "Incremental
+ * Construction of Minimal Acyclic Finite-State Automata" (2000), in time linear
+ * in the total length of the words. This makes the DAWG a good fit for
+ * dictionaries that are loaded once and then queried, and a poor fit for
+ * interleaving adds and lookups.
+ *
+ * Removed words are kept in a buffer of their own, and left out of the graph
+ * when it is rebuilt. The words added before a removal are merged in first,
+ * so that the removals of a rebuild always come before its adds.
+ *
+ * Lookups run concurrently with rebuilds, without locking: the rebuilt graph
+ * is atomically published in place of the previous one, which is retired (see
+ * spell-checker_epoch.h).
+ *
+ * Since the graph has no pointers, it can be written to a file as is (an
+ * "image", see scdDawgWriteImage()), and later mapped read-only into memory
+ * (scdDawgOpenImage()) without any parsing or copying. Opening an image is
+ * O(1), and processes mapping the same image share the same physical pages.
+ * Image layout (in the byte order of the machine that wrote it):
+ *
+ *   ScdDawgImageHeader   magic, version, flags, counts and offsets of the
+ *                        arrays
+ *   (padding)            up to SCD_DAWG_IMAGE_ALIGN bytes
+ *   nodes                numNodes x ScdDawgNode
+ *   edge targets         numEdges x uint32_t
+ *   edge characters      numEdges x unsigned char
+ *   (padding)            up to SCD_DAWG_IMAGE_ALIGN bytes, if indexed
+ *   suggestion index     indexSize bytes (see scdIndexWriteImage()), if any
+ */
+
+typedef struct ScdDawgNode
+{
+    uint32_t firstEdge;
+    uint16_t numEdges;
+    uint16_t isFinal;
+} ScdDawgNode;
+
+/*
+ * The minimized graph, published as a whole.
+ */
+typedef struct ScdDawgGraph
+{
+    ScdDawgNode *nodes;
+    uint32_t numNodes;
+    unsigned char *edgeChr;
+    uint32_t *edgeTarget;
+    uint32_t numEdges;
+} ScdDawgGraph;
+
+typedef struct ScdDawg
+{
+    struct _SpellCheckerData base;
+
+    /* The minimized graph, NULL while empty */
+    ScdDawgGraph *graph;
+    size_t numWords; /* in the graph, SIZE_MAX while not counted (images) */
+
+    /* Normalized, null-separated words added since the graph was built */
+    char *pending;
+    size_t pendingSize;
+    size_t pendingCapacity;
+    size_t numPending;
+
+    /* Same, for the words removed since the graph was built */
+    char *removed;
+    size_t removedSize;
+    size_t removedCapacity;
+    size_t numRemoved;
+
+    /* The mapped image the graph lives in, for a read-only DAWG */
+    void *image;
+    size_t imageSize;
+    ScdDawgGraph imageGraph;
+} ScdDawg;
+
+#define SCD_DAWG_IMAGE_MAGIC "SCDDAWG"
+#define SCD_DAWG_IMAGE_VERSION 3
+#define SCD_DAWG_IMAGE_BYTE_ORDER 0x01020304u
+#define SCD_DAWG_IMAGE_ALIGN 64
+
+/* The words are folded UTF-8 ones (see scdSetUtf8()) */
+#define SCD_DAWG_IMAGE_UTF8 0x1u
+
+typedef struct ScdDawgImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t flags;
+    uint32_t reserved;
+    uint32_t numNodes;
+    uint32_t numEdges;
+    uint64_t nodesOffset;
+    uint64_t edgeTargetOffset;
+    uint64_t edgeChrOffset;
+    uint64_t indexOffset; /* 0 if the image has no suggestion index */
+    uint64_t indexSize;
+    uint64_t size;
+} ScdDawgImageHeader;
+
+/*
+ * A growable list of null-terminated words, used while rebuilding.
+ */
+typedef struct ScdDawgWordList
+{
+    char *buf;
+    size_t size;
+    size_t capacity;
+    const char **words;
+    size_t numWords;
+} ScdDawgWordList;
+
+/*
+ * The mutable node used while building the graph.
+ */
+typedef struct ScdDawgBuildNode
+{
+    unsigned char *edgeChr;
+    uint32_t *edgeTarget;
+    uint16_t numEdges;
+    uint16_t capacity;
+    uint16_t isFinal;
+} ScdDawgBuildNode;
+
+typedef struct ScdDawgBuilder
+{
+    ScdDawgBuildNode *nodes;
+    uint32_t numNodes;
+    uint32_t capacity;
+
+    /* Register of the unique (already minimized) nodes: open addressing */
+    uint32_t *reg;
+    uint32_t regCapacity;
+    uint32_t regSize;
+
+    /* Path of the previous word, whose nodes are not yet minimized */
+    uint32_t *path;
+    size_t pathCapacity;
+} ScdDawgBuilder;
+
+#define SCD_DAWG_NO_NODE UINT32_MAX
+
+static int scdDawgGrow(void **buf, size_t *capacity, size_t needed,
+                       size_t elemSize)
+{
+    if (needed <= *capacity)
+        return 0;
+
+    size_t capacity2 = *capacity ? *capacity : 16;
+    while (capacity2 < needed)
+        capacity2 *= 2;
+
+    void *buf2 = realloc(*buf, capacity2 * elemSize);
+    if (!buf2)
+    {
+        printf("Failed allocating memory while building DAWG\n");
+        return -1;
+    }
+    *buf = buf2;
+    *capacity = capacity2;
+    return 0;
+}
+
+/*
+ * Builder
+ */
+
+static uint32_t scdDawgBuilderNewNode(ScdDawgBuilder *b)
+{
+    if (b->numNodes == b->capacity)
+    {
+        size_t capacity = b->capacity;
+        if (-1 == scdDawgGrow((void**)&b->nodes, &capacity, b->numNodes + 1,
+                              sizeof(ScdDawgBuildNode)))
+            return SCD_DAWG_NO_NODE;
+        b->capacity = capacity;
+    }
+    memset(&b->nodes[b->numNodes], 0, sizeof(ScdDawgBuildNode));
+    return b->numNodes++;
+}
+
+static int scdDawgBuilderAddEdge(ScdDawgBuilder *b, uint32_t from,
+                                 unsigned char chr, uint32_t to)
+{
+    ScdDawgBuildNode *node = &b->nodes[from];
+    if (node->numEdges == node->capacity)
+    {
+        const uint16_t capacity = node->capacity ? node->capacity * 2 : 2;
+        unsigned char *edgeChr = realloc(node->edgeChr, capacity);
+        if (!edgeChr)
+            return -1;
+        node->edgeChr = edgeChr;
+        uint32_t *edgeTarget =
+            realloc(node->edgeTarget, capacity * sizeof(uint32_t));
+        if (!edgeTarget)
+            return -1;
+        node->edgeTarget = edgeTarget;
+        node->capacity = capacity;
+    }
+    node->edgeChr[node->numEdges] = chr;
+    node->edgeTarget[node->numEdges] = to;
+    ++node->numEdges;
+    return 0;
+}
+
+static void scdDawgBuilderFreeNode(ScdDawgBuildNode *node)
+{
+    free(node->edgeChr);
+    free(node->edgeTarget);
+    node->edgeChr = NULL;
+    node->edgeTarget = NULL;
+    node->numEdges = 0;
+}
+
+static uint32_t scdDawgNodeHash(const ScdDawgBuildNode *node)
+{
+    uint32_t hash = 2166136261u ^ node->isFinal;
+    for (uint16_t i = 0; i < node->numEdges; ++i)
+    {
+        hash = (hash ^ node->edgeChr[i]) * 16777619u;
+        hash = (hash ^ node->edgeTarget[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int scdDawgNodeEquals(const ScdDawgBuildNode *a,
+                             const ScdDawgBuildNode *b)
+{
+    /* The edges of a leaf are NULL, which memcmp() must not be given */
+    return (a->isFinal == b->isFinal) && (a->numEdges == b->numEdges) &&
+        (!a->numEdges ||
+         (!memcmp(a->edgeChr, b->edgeChr, a->numEdges) &&
+          !memcmp(a->edgeTarget, b->edgeTarget,
+                  a->numEdges * sizeof(uint32_t))));
+}
+
+static int scdDawgRegisterGrow(ScdDawgBuilder *b)
+{
+    const uint32_t capacity = b->regCapacity ? b->regCapacity * 2 : 1024;
+    uint32_t *reg = malloc(capacity * sizeof(uint32_t));
+    if (!reg)
+    {
+        printf("Failed allocating memory for DAWG register\n");
+        return -1;
+    }
+    memset(reg, 0xff, capacity * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < b->regCapacity; ++i)
+    {
+        if (SCD_DAWG_NO_NODE == b->reg[i])
+            continue;
+        uint32_t j = scdDawgNodeHash(&b->nodes[b->reg[i]]) & (capacity - 1);
+        while (SCD_DAWG_NO_NODE != reg[j])
+            j = (j + 1) & (capacity - 1);
+        reg[j] = b->reg[i];
+    }
+
+    free(b->reg);
+    b->reg = reg;
+    b->regCapacity = capacity;
+    return 0;
+}
+
+/*
+ * Return the registered node equivalent to the given one, registering it if
+ * there is none.
+ */
+static uint32_t scdDawgRegister(ScdDawgBuilder *b, uint32_t idx)
+{
+    if ((b->regSize + 1) * 2 > b->regCapacity)
+    {
+        if (-1 == scdDawgRegisterGrow(b))
+            return SCD_DAWG_NO_NODE;
+    }
+
+    const uint32_t mask = b->regCapacity - 1;
+    uint32_t i = scdDawgNodeHash(&b->nodes[idx]) & mask;
+    while (SCD_DAWG_NO_NODE != b->reg[i])
+    {
+        if (scdDawgNodeEquals(&b->nodes[b->reg[i]], &b->nodes[idx]))
+            return b->reg[i];
+        i = (i + 1) & mask;
+    }
+    b->reg[i] = idx;
+    ++b->regSize;
+    return idx;
+}
+
+/*
+ * Minimize the path of the previous word, from its end up to the given depth.
+ * The nodes below depth cannot change anymore, as the next words are sorted
+ * after the previous one.
+ */
+static int scdDawgMinimize(ScdDawgBuilder *b, size_t pathLen, size_t depth)
+{
+    for (size_t i = pathLen; i > depth; --i)
+    {
+        ScdDawgBuildNode *parent = &b->nodes[b->path[i - 1]];
+        const uint32_t child = b->path[i];
+        const uint32_t canonical = scdDawgRegister(b, child);
+        if (SCD_DAWG_NO_NODE == canonical)
+            return -1;
+        if (canonical != child)
+        {
+            parent->edgeTarget[parent->numEdges - 1] = canonical;
+            scdDawgBuilderFreeNode(&b->nodes[child]);
+        }
+    }
+    return 0;
+}
+
+static void scdDawgFreeGraph(void *ptr)
+{
+    ScdDawgGraph *graph = ptr;
+    if (!graph)
+        return;
+    free(graph->nodes);
+    free(graph->edgeChr);
+    free(graph->edgeTarget);
+    free(graph);
+}
+
+/*
+ * Flatten the minimized graph into the DAWG, renumbering the reachable nodes.
+ */
+static int scdDawgFlatten(ScdDawg *dawg, ScdDawgBuilder *b)
+{
+    int ret = -1;
+    ScdDawgGraph *graph = NULL;
+    uint32_t *map = malloc(b->numNodes * sizeof(uint32_t));
+    uint32_t *order = malloc(b->numNodes * sizeof(uint32_t));
+    size_t stackCapacity = 0;
+    uint32_t *stack = NULL;
+    ScdDawgNode *nodes = NULL;
+    unsigned char *edgeChr = NULL;
+    uint32_t *edgeTarget = NULL;
+    if (!map || !order ||
+        (-1 == scdDawgGrow((void**)&stack, &stackCapacity, 1,
+                           sizeof(uint32_t))))
+        goto out;
+    memset(map, 0xff, b->numNodes * sizeof(uint32_t));
+
+    /*
+     * Number the nodes in DFS pre-order, so the nodes along a word's path are
+     * close in memory.
+     */
+    uint32_t numNodes = 0;
+    uint32_t numEdges = 0;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize)
+    {
+        const uint32_t idx = stack[--stackSize];
+        if (SCD_DAWG_NO_NODE != map[idx])
+            continue;
+        map[idx] = numNodes;
+        order[numNodes++] = idx;
+
+        const ScdDawgBuildNode *node = &b->nodes[idx];
+        numEdges += node->numEdges;
+        if (-1 == scdDawgGrow((void**)&stack, &stackCapacity,
+                              stackSize + node->numEdges, sizeof(uint32_t)))
+            goto out;
+        for (uint16_t e = node->numEdges; e > 0; --e)
+        {
+            if (SCD_DAWG_NO_NODE == map[node->edgeTarget[e - 1]])
+                stack[stackSize++] = node->edgeTarget[e - 1];
+        }
+    }
+
+    graph = malloc(sizeof(ScdDawgGraph));
+    nodes = malloc(numNodes * sizeof(ScdDawgNode));
+    edgeChr = malloc(numEdges ? numEdges : 1);
+    edgeTarget = malloc((numEdges ? numEdges : 1) * sizeof(uint32_t));
+    if (!graph || !nodes || !edgeChr || !edgeTarget)
+        goto out;
+
+    uint32_t edge = 0;
+    for (uint32_t i = 0; i < numNodes; ++i)
+    {
+        const ScdDawgBuildNode *node = &b->nodes[order[i]];
+        nodes[i].firstEdge = edge;
+        nodes[i].numEdges = node->numEdges;
+        nodes[i].isFinal = node->isFinal;
+        for (uint16_t e = 0; e < node->numEdges; ++e, ++edge)
+        {
+            edgeChr[edge] = node->edgeChr[e];
+            edgeTarget[edge] = map[node->edgeTarget[e]];
+        }
+    }
+
+    graph->nodes = nodes;
+    graph->numNodes = numNodes;
+    graph->edgeChr = edgeChr;
+    graph->edgeTarget = edgeTarget;
+    graph->numEdges = numEdges;
+
+    ScdDawgGraph *old = dawg->graph;
+    __atomic_store_n(&dawg->graph, graph, __ATOMIC_RELEASE);
+    if (old)
+        sceRetire(&dawg->base.epoch, old, scdDawgFreeGraph);
+
+    graph = NULL;
+    nodes = NULL;
+    edgeChr = NULL;
+    edgeTarget = NULL;
+    ret = 0;
+
+out:
+    if (-1 == ret)
+        printf("Failed allocating memory for DAWG\n");
+    free(map);
+    free(order);
+    free(stack);
+    free(graph);
+    free(nodes);
+    free(edgeChr);
+    free(edgeTarget);
+    return ret;
+}
+
+/*
+ * Build the minimized graph from a sorted list of unique words.
+ */
+static int scdDawgBuild(ScdDawg *dawg, const char **words, size_t numWords)
+{
+    int ret = -1;
+    ScdDawgBuilder b;
+    memset(&b, 0, sizeof(b));
+
+    if (SCD_DAWG_NO_NODE == scdDawgBuilderNewNode(&b))
+        goto out;
+
+    const char *prev = "";
+    size_t pathLen = 0; /* path[0..pathLen] are the nodes of prev */
+    if (-1 == scdDawgGrow((void**)&b.path, &b.pathCapacity, 1,
+                          sizeof(uint32_t)))
+        goto out;
+    b.path[0] = 0;
+
+    for (size_t w = 0; w < numWords; ++w)
+    {
+        const char *word = words[w];
+        const size_t len = strlen(word);
+        size_t common = 0;
+        while ((common < pathLen) && (prev[common] == word[common]))
+            ++common;
+
+        if (-1 == scdDawgMinimize(&b, pathLen, common))
+            goto out;
+
+        if (-1 == scdDawgGrow((void**)&b.path, &b.pathCapacity, len + 1,
+                              sizeof(uint32_t)))
+            goto out;
+        for (size_t i = common; i < len; ++i)
+        {
+            const uint32_t child = scdDawgBuilderNewNode(&b);
+            if ((SCD_DAWG_NO_NODE == child) ||
+                (-1 == scdDawgBuilderAddEdge(&b, b.path[i],
+                                             (unsigned char)word[i], child)))
+                goto out;
+            b.path[i + 1] = child;
+        }
+        b.nodes[b.path[len]].isFinal = 1;
+
+        prev = word;
+        pathLen = len;
+    }
+
+    if (-1 == scdDawgMinimize(&b, pathLen, 0))
+        goto out;
+
+    ret = scdDawgFlatten(dawg, &b);
+    if (0 == ret)
+        dawg->numWords = numWords;
+
+out:
+    for (uint32_t i = 0; i < b.numNodes; ++i)
+        scdDawgBuilderFreeNode(&b.nodes[i]);
+    free(b.nodes);
+    free(b.reg);
+    free(b.path);
+    return ret;
+}
+
+/*
+ * Word lists
+ */
+
+static int scdDawgWordListAdd(ScdDawgWordList *list, const char *word,
+                              size_t len)
+{
+    if (-1 == scdDawgGrow((void**)&list->buf, &list->capacity,
+                          list->size + len + 1, 1))
+        return -1;
+
+    memcpy(&list->buf[list->size], word, len);
+    list->buf[list->size + len] = '\0';
+    list->size += len + 1;
+    return 0;
+}
+
+/*
+ * Index the words of a null-separated buffer.
+ */
+static int scdDawgWordListIndex(ScdDawgWordList *list, size_t numWords)
+{
+    list->words = malloc((numWords ? numWords : 1) * sizeof(const char*));
+    if (!list->words)
+    {
+        printf("Failed allocating memory for DAWG word list\n");
+        return -1;
+    }
+    list->numWords = 0;
+    for (size_t pos = 0; list->numWords < numWords; ++list->numWords)
+    {
+        list->words[list->numWords] = &list->buf[pos];
+        pos += strlen(&list->buf[pos]) + 1;
+    }
+    return 0;
+}
+
+/*
+ * Call cb for each word in the graph, in sorted order.
+ */
+static int scdDawgWalk(const ScdDawgGraph *graph, ScdWordCallback cb,
+                       void *userdata)
+{
+    int ret = -1;
+    /* Iterative DFS: stack of (node, next edge) and the current word */
+    uint32_t *nodeStack = NULL;
+    uint32_t *edgeStack = NULL;
+    char *word = NULL;
+    size_t nodeCapacity = 0, edgeCapacity = 0, wordCapacity = 0;
+    size_t depth = 0;
+
+    if (!graph || !graph->numNodes)
+        return 0;
+
+    if (scdDawgGrow((void**)&nodeStack, &nodeCapacity, 1, sizeof(uint32_t)) ||
+        scdDawgGrow((void**)&edgeStack, &edgeCapacity, 1, sizeof(uint32_t)) ||
+        scdDawgGrow((void**)&word, &wordCapacity, 1, 1))
+        goto out;
+    nodeStack[0] = 0;
+    edgeStack[0] = graph->nodes[0].firstEdge;
+    if (graph->nodes[0].isFinal && (-1 == cb("", 0, userdata)))
+        goto out;
+
+    for (;;)
+    {
+        const ScdDawgNode *node = &graph->nodes[nodeStack[depth]];
+        const uint32_t e = edgeStack[depth];
+        if (e == node->firstEdge + node->numEdges)
+        {
+            if (0 == depth)
+                break;
+            --depth;
+            continue;
+        }
+        ++edgeStack[depth];
+
+        const uint32_t child = graph->edgeTarget[e];
+        if (scdDawgGrow((void**)&nodeStack, &nodeCapacity, depth + 2,
+                        sizeof(uint32_t)) ||
+            scdDawgGrow((void**)&edgeStack, &edgeCapacity, depth + 2,
+                        sizeof(uint32_t)) ||
+            scdDawgGrow((void**)&word, &wordCapacity, depth + 1, 1))
+            goto out;
+        word[depth] = graph->edgeChr[e];
+        ++depth;
+        nodeStack[depth] = child;
+        edgeStack[depth] = graph->nodes[child].firstEdge;
+        if (graph->nodes[child].isFinal && (-1 == cb(word, depth, userdata)))
+            goto out;
+    }
+    ret = 0;
+
+out:
+    free(nodeStack);
+    free(edgeStack);
+    free(word);
+    return ret;
+}
+
+static int scdDawgCollectWord(const char *word, size_t len, void *userdata)
+{
+    ScdDawgWordList *list = userdata;
+    if (-1 == scdDawgWordListAdd(list, word, len))
+        return -1;
+    ++list->numWords;
+    return 0;
+}
+
+static int scdDawgCompareWords(const void *a, const void *b)
+{
+    return strcmp(*(const char**)a, *(const char**)b);
+}
+
+/*
+ * Append a normalized copy of a word to a null-separated buffer.
+ */
+static int scdDawgAppendWord(char **buf, size_t *size, size_t *capacity,
+                             const char *word, size_t len)
+{
+    if (-1 == scdDawgGrow((void**)buf, capacity, *size + len + 1, 1))
+        return -1;
+
+    char *copy = &(*buf)[*size];
+    for (size_t i = 0; i < len; ++i)
+        copy[i] = scdNormalizeChar(word[i]);
+    copy[len] = '\0';
+    *size += len + 1;
+
+    return 0;
+}
+
+/*
+ * Rebuild the graph with the removed words left out, and the pending words
+ * merged in.
+ */
+static int scdDawgRebuild(ScdDawg *dawg)
+{
+    int ret = -1;
+    ScdDawgWordList existing, pending, removed;
+    const char **merged = NULL;
+    memset(&existing, 0, sizeof(existing));
+    memset(&pending, 0, sizeof(pending));
+    memset(&removed, 0, sizeof(removed));
+
+    if (-1 == scdDawgWalk(dawg->graph, scdDawgCollectWord, &existing) ||
+        -1 == scdDawgWordListIndex(&existing, existing.numWords))
+        goto out;
+
+    /* Both sorted: skip the removed words along the walk */
+    removed.buf = dawg->removed;
+    if (-1 == scdDawgWordListIndex(&removed, dawg->numRemoved))
+        goto out;
+    qsort(removed.words, removed.numWords, sizeof(const char*),
+          scdDawgCompareWords);
+    size_t numKept = 0;
+    for (size_t i = 0, r = 0; i < existing.numWords; ++i)
+    {
+        int cmp = 1;
+        while ((r < removed.numWords) &&
+               ((cmp = strcmp(removed.words[r], existing.words[i])) < 0))
+            ++r;
+        if ((r == removed.numWords) || (0 != cmp))
+            existing.words[numKept++] = existing.words[i];
+    }
+    existing.numWords = numKept;
+
+    /* Borrow the pending buffer, it is released once the graph is built */
+    pending.buf = dawg->pending;
+    if (-1 == scdDawgWordListIndex(&pending, dawg->numPending))
+        goto out;
+    qsort(pending.words, pending.numWords, sizeof(const char*),
+          scdDawgCompareWords);
+
+    merged = malloc((existing.numWords + pending.numWords + 1) *
+                    sizeof(const char*));
+    if (!merged)
+        goto out;
+
+    size_t i = 0, j = 0, n = 0;
+    while ((i < existing.numWords) || (j < pending.numWords))
+    {
+        const char *next;
+        if (j == pending.numWords)
+            next = existing.words[i++];
+        else if (i == existing.numWords)
+            next = pending.words[j++];
+        else if (strcmp(existing.words[i], pending.words[j]) <= 0)
+            next = existing.words[i++];
+        else
+            next = pending.words[j++];
+
+        if (!n || strcmp(merged[n - 1], next))
+            merged[n++] = next;
+    }
+
+    ret = scdDawgBuild(dawg, merged, n);
+    if (0 == ret)
+    {
+        dawg->pendingSize = 0;
+        dawg->numPending = 0;
+        dawg->removedSize = 0;
+        dawg->numRemoved = 0;
+    }
+
+out:
+    if (-1 == ret)
+        printf("Failed rebuilding DAWG\n");
+    free(existing.buf);
+    free(existing.words);
+    free(pending.words);
+    free(removed.words);
+    free(merged);
+    return ret;
+}
+
+/*
+ * Backend interface
+ */
+
+static SpellCheckerDataHandle scdDawgInit(void)
+{
+    ScdDawg *dawg = calloc(1, sizeof(ScdDawg));
+    if (!dawg)
+    {
+        printf("Failed allocating memory for DAWG\n");
+        return NULL;
+    }
+
+    return &dawg->base;
+}
+
+static void scdDawgFinalize(SpellCheckerDataHandle data)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    scdDawgFreeGraph(dawg->graph);
+    free(dawg->pending);
+    free(dawg->removed);
+    free(dawg);
+}
+
+static int scdDawgAddWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+
+    if (-1 == scdDawgAppendWord(&dawg->pending, &dawg->pendingSize,
+                                &dawg->pendingCapacity, word, len))
+        return -1;
+    ++dawg->numPending;
+
+    return 0;
+}
+
+static int scdDawgRemoveWord(SpellCheckerDataHandle data, const char *word,
+                             size_t len)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+
+    /* The words added so far may include this one */
+    if (dawg->numPending && (-1 == scdDawgRebuild(dawg)))
+        return -1;
+
+    if (-1 == scdDawgAppendWord(&dawg->removed, &dawg->removedSize,
+                                &dawg->removedCapacity, word, len))
+        return -1;
+    ++dawg->numRemoved;
+
+    return 0;
+}
+
+static int scdDawgCommit(SpellCheckerDataHandle data)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    return (dawg->numPending || dawg->numRemoved) ? scdDawgRebuild(dawg) : 0;
+}
+
+static int scdDawgHasWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    const ScdDawgGraph *graph = __atomic_load_n(&dawg->graph, __ATOMIC_ACQUIRE);
+
+    if (!graph || !graph->numNodes)
+        return 0;
+
+    const ScdDawgNode *node = &graph->nodes[0];
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned char c = scdNormalizeChar(word[i]);
+        const unsigned char *edgeChr = &graph->edgeChr[node->firstEdge];
+        uint16_t e = 0;
+        while ((e < node->numEdges) && (edgeChr[e] < c))
+            ++e;
+        if ((e == node->numEdges) || (edgeChr[e] != c))
+            return 0;
+        node = &graph->nodes[graph->edgeTarget[node->firstEdge + e]];
+    }
+
+    return node->isFinal;
+}
+
+static int scdDawgForEachWord(SpellCheckerDataHandle data, ScdWordCallback cb,
+                              void *userdata)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+
+    if ((dawg->numPending || dawg->numRemoved) &&
+        (-1 == scdDawgRebuild(dawg)))
+        return -1;
+
+    return scdDawgWalk(dawg->graph, cb, userdata);
+}
+
+/*
+ * Walk the prefixes below the given node.
+ */
+static int scdDawgWalkPrefixes(const ScdDawgGraph *graph, uint32_t idx,
+                               size_t depth, ScdPrefixCallback cb,
+                               void *userdata)
+{
+    const ScdDawgNode *node = &graph->nodes[idx];
+    for (uint32_t e = node->firstEdge; e < node->firstEdge + node->numEdges;
+         ++e)
+    {
+        const uint32_t child = graph->edgeTarget[e];
+        const int ret = cb(graph->edgeChr[e], depth + 1,
+                           graph->nodes[child].isFinal, userdata);
+        if ((-1 == ret) ||
+            ((1 == ret) &&
+             (-1 == scdDawgWalkPrefixes(graph, child, depth + 1, cb,
+                                        userdata))))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int scdDawgForEachPrefix(SpellCheckerDataHandle data,
+                                ScdPrefixCallback cb, void *userdata)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    const ScdDawgGraph *graph = __atomic_load_n(&dawg->graph, __ATOMIC_ACQUIRE);
+
+    if (!graph || !graph->numNodes)
+        return 0;
+
+    return scdDawgWalkPrefixes(graph, 0, 0, cb, userdata);
+}
+
+/*
+ * Count the words below a node, memoizing the count of each node (SIZE_MAX
+ * while not counted), as the nodes are shared.
+ */
+static size_t scdDawgCountWords(const ScdDawgGraph *graph, uint32_t idx,
+                                size_t *counts)
+{
+    if (SIZE_MAX != counts[idx])
+        return counts[idx];
+
+    const ScdDawgNode *node = &graph->nodes[idx];
+    size_t count = node->isFinal;
+    for (uint32_t e = node->firstEdge; e < node->firstEdge + node->numEdges;
+         ++e)
+        count += scdDawgCountWords(graph, graph->edgeTarget[e], counts);
+
+    counts[idx] = count;
+    return count;
+}
+
+static void scdDawgGetStats(SpellCheckerDataHandle data, ScdStats *stats)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    const ScdDawgGraph *graph = dawg->graph;
+
+    /* The word count is not stored in images: count them once */
+    if ((SIZE_MAX == dawg->numWords) && graph && graph->numNodes)
+    {
+        size_t *counts = malloc(graph->numNodes * sizeof(size_t));
+        if (counts)
+        {
+            memset(counts, 0xff, graph->numNodes * sizeof(size_t));
+            dawg->numWords = scdDawgCountWords(graph, 0, counts);
+            free(counts);
+        }
+    }
+
+    stats->numWords = (SIZE_MAX == dawg->numWords) ? 0 : dawg->numWords;
+    stats->numNodes = graph ? graph->numNodes : 0;
+    if (dawg->image)
+    {
+        stats->bytes = sizeof(ScdDawg) + dawg->imageSize;
+    }
+    else
+    {
+        stats->bytes = sizeof(ScdDawg) + dawg->pendingCapacity +
+            dawg->removedCapacity;
+        if (graph)
+            stats->bytes += sizeof(ScdDawgGraph) +
+                graph->numNodes * sizeof(ScdDawgNode) +
+                graph->numEdges * (sizeof(uint32_t) + 1);
+    }
+}
+
+const ScdBackend scdDawgBackend = {
+    "dawg",
+    scdDawgInit,
+    scdDawgFinalize,
+    scdDawgAddWord,
+    NULL,
+    scdDawgRemoveWord,
+    scdDawgCommit,
+    scdDawgHasWord,
+    NULL,
+    scdDawgForEachWord,
+    scdDawgForEachPrefix,
+    scdDawgGetStats
+};
+
+/*
+ * Images
+ */
+
+static size_t scdDawgAlign(size_t offset)
+{
+    return (offset + SCD_DAWG_IMAGE_ALIGN - 1) & ~(size_t)(SCD_DAWG_IMAGE_ALIGN - 1);
+}
+
+static int scdDawgWriteImageFile(const ScdDawgGraph *graph,
+                                 const ScdIndex *index, uint32_t flags,
+                                 FILE *file)
+{
+    static const char padding[SCD_DAWG_IMAGE_ALIGN];
+    static const ScdDawgGraph empty;
+    if (!graph)
+        graph = &empty;
+
+    ScdDawgImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCD_DAWG_IMAGE_MAGIC, sizeof(SCD_DAWG_IMAGE_MAGIC));
+    header.version = SCD_DAWG_IMAGE_VERSION;
+    header.byteOrder = SCD_DAWG_IMAGE_BYTE_ORDER;
+    header.flags = flags;
+    header.numNodes = graph->numNodes;
+    header.numEdges = graph->numEdges;
+    header.nodesOffset = scdDawgAlign(sizeof(header));
+    header.edgeTargetOffset =
+        header.nodesOffset + (uint64_t)graph->numNodes * sizeof(ScdDawgNode);
+    header.edgeChrOffset =
+        header.edgeTargetOffset + (uint64_t)graph->numEdges * sizeof(uint32_t);
+    header.size = header.edgeChrOffset + graph->numEdges;
+    if (index)
+    {
+        header.indexOffset = scdDawgAlign(header.size);
+        header.indexSize = scdIndexImageSize(index);
+        header.size = header.indexOffset + header.indexSize;
+    }
+
+    if ((1 != fwrite(&header, sizeof(header), 1, file)) ||
+        (header.nodesOffset - sizeof(header) !=
+         fwrite(padding, 1, header.nodesOffset - sizeof(header), file)) ||
+        (graph->numNodes != fwrite(graph->nodes, sizeof(ScdDawgNode),
+                                   graph->numNodes, file)) ||
+        (graph->numEdges != fwrite(graph->edgeTarget, sizeof(uint32_t),
+                                   graph->numEdges, file)) ||
+        (graph->numEdges != fwrite(graph->edgeChr, 1, graph->numEdges, file)))
+        return -1;
+
+    if (index)
+    {
+        const size_t end = header.edgeChrOffset + graph->numEdges;
+        if ((header.indexOffset - end !=
+             fwrite(padding, 1, header.indexOffset - end, file)) ||
+            (-1 == scdIndexWriteImage(index, file)))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Write the graph (and the suggestion index, if any) to the given path. The
+ * image is written to a temporary file first and then renamed, so processes
+ * that have the previous image mapped are not affected.
+ */
+int scdDawgWriteImage(SpellCheckerDataHandle data, const ScdIndex *index,
+                      const char *path)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+
+    if ((dawg->numPending || dawg->numRemoved) &&
+        (-1 == scdDawgRebuild(dawg)))
+        return -1;
+
+    const size_t pathLen = strlen(path);
+    char *tmpPath = malloc(pathLen + sizeof(".tmp"));
+    if (!tmpPath)
+    {
+        printf("Failed allocating memory for image path\n");
+        return -1;
+    }
+    memcpy(tmpPath, path, pathLen);
+    memcpy(&tmpPath[pathLen], ".tmp", sizeof(".tmp"));
+
+    FILE *file = fopen(tmpPath, "wb");
+    if (!file)
+    {
+        printf("Failed opening image file (%s) for writing\n", tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+
+    int ret = scdDawgWriteImageFile(dawg->graph, index,
+                                    data->isUtf8 ? SCD_DAWG_IMAGE_UTF8 : 0,
+                                    file);
+    if (0 != fclose(file))
+        ret = -1;
+    if ((0 == ret) && (0 != rename(tmpPath, path)))
+        ret = -1;
+    if (-1 == ret)
+    {
+        printf("Failed writing image file (%s)\n", path);
+        remove(tmpPath);
+    }
+
+    free(tmpPath);
+    return ret;
+}
+
+/*
+ * @return whether len bytes at offset are within an image of the given size,
+ * without overflowing.
+ */
+static inline int scdDawgImageHolds(uint64_t offset, uint64_t len, size_t size)
+{
+    return (offset <= size) && (len <= size - offset);
+}
+
+/*
+ * The header is untrusted: each array is checked to be within the image before
+ * its end is computed, so no offset can wrap around.
+ */
+static int scdDawgImageIsValid(const ScdDawgImageHeader *header, size_t size)
+{
+    const uint64_t nodesSize =
+        (uint64_t)header->numNodes * sizeof(ScdDawgNode);
+    const uint64_t edgeTargetSize =
+        (uint64_t)header->numEdges * sizeof(uint32_t);
+    if (memcmp(header->magic, SCD_DAWG_IMAGE_MAGIC,
+               sizeof(SCD_DAWG_IMAGE_MAGIC)) ||
+        (SCD_DAWG_IMAGE_VERSION != header->version) ||
+        (SCD_DAWG_IMAGE_BYTE_ORDER != header->byteOrder) ||
+        (size != header->size) ||
+        (header->nodesOffset < sizeof(*header)) ||
+        (0 != header->nodesOffset % sizeof(uint64_t)) ||
+        !scdDawgImageHolds(header->nodesOffset, nodesSize, size) ||
+        (header->edgeTargetOffset != header->nodesOffset + nodesSize) ||
+        !scdDawgImageHolds(header->edgeTargetOffset, edgeTargetSize, size) ||
+        (header->edgeChrOffset != header->edgeTargetOffset + edgeTargetSize) ||
+        !scdDawgImageHolds(header->edgeChrOffset, header->numEdges, size))
+        return 0;
+
+    const uint64_t end = header->edgeChrOffset + header->numEdges;
+    if (!header->indexOffset)
+        return size == end;
+
+    return (header->indexOffset >= end) &&
+        (0 == header->indexOffset % sizeof(uint64_t)) &&
+        scdDawgImageHolds(header->indexOffset, header->indexSize, size) &&
+        (size == header->indexOffset + header->indexSize);
+}
+
+/*
+ * Map an image written by scdDawgWriteImage(). Only the header is validated,
+ * the rest of the image is trusted.
+ */
+SpellCheckerDataHandle scdDawgOpenImage(const char *path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (-1 == fd)
+    {
+        printf("Failed opening image file (%s)\n", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if ((-1 == fstat(fd, &st)) ||
+        ((size_t)st.st_size < sizeof(ScdDawgImageHeader)))
+    {
+        printf("Invalid image file (%s)\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    const size_t size = st.st_size;
+    void *image = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == image)
+    {
+        printf("Failed mapping image file (%s)\n", path);
+        return NULL;
+    }
+
+    const ScdDawgImageHeader *header = image;
+    if (!scdDawgImageIsValid(header, size))
+    {
+        printf("Invalid image file (%s)\n", path);
+        munmap(image, size);
+        return NULL;
+    }
+
+    ScdDawg *dawg = calloc(1, sizeof(ScdDawg));
+    if (!dawg)
+    {
+        printf("Failed allocating memory for DAWG\n");
+        munmap(image, size);
+        return NULL;
+    }
+
+    /* The arrays are only read, casting away const is safe */
+    dawg->image = image;
+    dawg->imageSize = size;
+    dawg->imageGraph.nodes =
+        (ScdDawgNode*)((char*)image + header->nodesOffset);
+    dawg->imageGraph.numNodes = header->numNodes;
+    dawg->imageGraph.edgeTarget =
+        (uint32_t*)((char*)image + header->edgeTargetOffset);
+    dawg->imageGraph.edgeChr = (unsigned char*)image + header->edgeChrOffset;
+    dawg->imageGraph.numEdges = header->numEdges;
+    dawg->graph = &dawg->imageGraph;
+    dawg->numWords = SIZE_MAX;
+    dawg->base.backend = &scdDawgImageBackend;
+    dawg->base.isUtf8 = !!(header->flags & SCD_DAWG_IMAGE_UTF8);
+
+    if (header->indexOffset)
+    {
+        dawg->base.index = scdIndexOpenImage((char*)image + header->indexOffset,
+                                             header->indexSize);
+        if (!dawg->base.index)
+        {
+            printf("Invalid suggestion index in image file (%s)\n", path);
+            munmap(image, size);
+            free(dawg);
+            return NULL;
+        }
+    }
+
+    return &dawg->base;
+}
+
+static void scdDawgImageFinalize(SpellCheckerDataHandle data)
+{
+    ScdDawg *dawg = (ScdDawg*) data;
+    munmap(dawg->image, dawg->imageSize);
+    free(dawg);
+}
+
+static int scdDawgImageAddWord(SpellCheckerDataHandle data, const char *word,
+                               size_t len)
+{
+    (void)data;
+    (void)word;
+    (void)len;
+    printf("Cannot add words to a mapped dictionary\n");
+    return -1;
+}
+
+/*
+ * A mapped image is a read-only DAWG, it is never created empty (init is not
+ * used).
+ */
+const ScdBackend scdDawgImageBackend = {
+    "dawg-image",
+    NULL,
+    scdDawgImageFinalize,
+    scdDawgImageAddWord,
+    NULL,
+    NULL,
+    NULL,
+    scdDawgHasWord,
+    NULL,
+    scdDawgForEachWord,
+    scdDawgForEachPrefix,
+    scdDawgGetStats
+};
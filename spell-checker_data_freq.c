@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spell-checker_data_freq.h"
+#include "spell-checker_data_backend.h"
+#include "spell-checker_data_words.h"
+
+/*
+ * A word with a frequency: the offset of the word in the word pool (see
+ * spell-checker_data_words.h). A hash of 0 marks an empty slot.
+ */
+typedef struct ScdFreqEntry
+{
+    uint64_t hash;
+    uint32_t word;
+    uint32_t frequency;
+} ScdFreqEntry;
+
+typedef struct ScdFreqTable
+{
+    uint64_t capacity; /* always a power of 2 */
+    ScdFreqEntry entries[];
+} ScdFreqTable;
+
+/*
+ * A hot word: the high half of its hash (0 marks an empty slot), and its offset
+ * in the words that follow the entries. 8 bytes, so the table of SCD_HOT_WORDS
+ * words fits in 128KB.
+ */
+typedef struct ScdHotEntry
+{
+    uint32_t tag;
+    uint32_t word;
+} ScdHotEntry;
+
+/*
+ * Built once, never modified: a new one replaces it on commit.
+ */
+typedef struct ScdHotWords
+{
+    size_t capacity; /* always a power of 2 */
+    size_t size; /* in bytes, along with the words */
+    const char *words;
+    ScdHotEntry entries[];
+} ScdHotWords;
+
+struct ScdFreq
+{
+    SceEpoch *epoch;
+
+    ScdFreqTable *table;
+    ScdWords *words;
+    size_t numEntries;
+
+    /* Set when a frequency changed since the hot words were built */
+    int isDirty;
+    ScdHotWords *hot; /* NULL while no word has a frequency */
+};
+
+#define SCD_FREQ_INITIAL_CAPACITY 1024
+#define SCD_FREQ_INITIAL_WORDS_CAPACITY (16 * 1024)
+
+static inline uint64_t scdFreqHash(const char *word, size_t len)
+{
+    const uint64_t hash = scdHashWord(word, len);
+    return hash ? hash : 1;
+}
+
+static inline uint32_t scdHotTag(uint64_t hash)
+{
+    return (uint32_t)(hash >> 32) | 1;
+}
+
+/*
+ * Compare a stored (normalized, null-terminated) word with a given one.
+ */
+static inline int scdFreqEquals(const char *stored, const char *word,
+                                size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if ((unsigned char)stored[i] != scdNormalizeChar(word[i]))
+            return 0;
+    }
+    return '\0' == stored[len];
+}
+
+static ScdFreqTable *scdFreqNewTable(size_t capacity)
+{
+    ScdFreqTable *table = calloc(1, sizeof(ScdFreqTable) +
+                                 capacity * sizeof(ScdFreqEntry));
+    if (!table)
+    {
+        printf("Failed allocating memory for word frequencies\n");
+        return NULL;
+    }
+    table->capacity = capacity;
+    return table;
+}
+
+ScdFreq *scdFreqInit(SceEpoch *epoch)
+{
+    ScdFreq *freq = calloc(1, sizeof(ScdFreq));
+    if (!freq)
+    {
+        printf("Failed allocating memory for word frequencies\n");
+        return NULL;
+    }
+
+    freq->epoch = epoch;
+    freq->table = scdFreqNewTable(SCD_FREQ_INITIAL_CAPACITY);
+    freq->words = scdWordsInit(SCD_FREQ_INITIAL_WORDS_CAPACITY);
+    if (!freq->table || !freq->words)
+    {
+        printf("Failed allocating memory for word frequencies\n");
+        scdFreqFinalize(freq);
+        return NULL;
+    }
+
+    return freq;
+}
+
+void scdFreqFinalize(ScdFreq *freq)
+{
+    if (!freq)
+        return;
+
+    free(freq->table);
+    free(freq->words);
+    free(freq->hot);
+    free(freq);
+}
+
+/*
+ * Find the entry of a word. Safe to call concurrently with the writer.
+ */
+static const ScdFreqEntry *scdFreqFind(const ScdFreq *freq, const char *word,
+                                       size_t len)
+{
+    const uint64_t hash = scdFreqHash(word, len);
+    const ScdFreqTable *table = __atomic_load_n(&freq->table, __ATOMIC_ACQUIRE);
+    const size_t mask = table->capacity - 1;
+    uint64_t stored;
+
+    for (size_t i = hash & mask;
+         (stored = __atomic_load_n(&table->entries[i].hash, __ATOMIC_ACQUIRE));
+         i = (i + 1) & mask)
+    {
+        if (stored != hash)
+            continue;
+
+        const char *stored =
+            scdWordsGet(&freq->words, table->entries[i].word, len);
+        if (stored && scdFreqEquals(stored, word, len))
+            return &table->entries[i];
+    }
+
+    return NULL;
+}
+
+uint32_t scdFreqGet(const ScdFreq *freq, const char *word, size_t len)
+{
+    const ScdFreqEntry *entry = scdFreqFind(freq, word, len);
+    return entry ? __atomic_load_n(&entry->frequency, __ATOMIC_RELAXED) : 0;
+}
+
+static int scdFreqGrowTable(ScdFreq *freq)
+{
+    const ScdFreqTable *old = freq->table;
+    const size_t capacity = old->capacity * 2;
+    ScdFreqTable *table = scdFreqNewTable(capacity);
+    if (!table)
+        return -1;
+
+    for (size_t i = 0; i < old->capacity; ++i)
+    {
+        if (!old->entries[i].hash)
+            continue;
+        size_t j = old->entries[i].hash & (capacity - 1);
+        while (table->entries[j].hash)
+            j = (j + 1) & (capacity - 1);
+        table->entries[j] = old->entries[i];
+    }
+
+    __atomic_store_n(&freq->table, table, __ATOMIC_RELEASE);
+    sceRetire(freq->epoch, (void*)old, free);
+
+    return 0;
+}
+
+int scdFreqSet(ScdFreq *freq, const char *word, size_t len,
+               uint32_t frequency)
+{
+    ScdFreqEntry *entry = (ScdFreqEntry*)scdFreqFind(freq, word, len);
+    if (entry)
+    {
+        if (entry->frequency != frequency)
+        {
+            __atomic_store_n(&entry->frequency, frequency, __ATOMIC_RELAXED);
+            freq->isDirty = 1;
+        }
+        return 0;
+    }
+
+    if (((freq->numEntries + 1) * 4 > freq->table->capacity * 3) &&
+        (-1 == scdFreqGrowTable(freq)))
+        return -1;
+
+    const int64_t offset =
+        scdWordsAdd(&freq->words, freq->epoch, word, len, SIZE_MAX);
+    if (-1 == offset)
+        return -1;
+
+    const uint64_t hash = scdFreqHash(word, len);
+    ScdFreqTable *table = freq->table;
+    const size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    while (table->entries[i].hash)
+        i = (i + 1) & mask;
+
+    table->entries[i].word = offset;
+    table->entries[i].frequency = frequency;
+    __atomic_store_n(&table->entries[i].hash, hash, __ATOMIC_RELEASE);
+    ++freq->numEntries;
+    freq->isDirty = 1;
+
+    return 0;
+}
+
+/*
+ * Sift the entry at pos down a min-heap of entries, ordered by frequency.
+ */
+static void scdFreqSiftDown(const ScdFreqEntry **heap, size_t size, size_t pos)
+{
+    for (;;)
+    {
+        size_t min = pos;
+        const size_t left = 2 * pos + 1;
+        const size_t right = left + 1;
+        if ((left < size) && (heap[left]->frequency < heap[min]->frequency))
+            min = left;
+        if ((right < size) && (heap[right]->frequency < heap[min]->frequency))
+            min = right;
+        if (min == pos)
+            return;
+
+        const ScdFreqEntry *tmp = heap[pos];
+        heap[pos] = heap[min];
+        heap[min] = tmp;
+        pos = min;
+    }
+}
+
+static void scdFreqSiftUp(const ScdFreqEntry **heap, size_t pos)
+{
+    while ((pos > 0) && (heap[pos]->frequency < heap[(pos - 1) / 2]->frequency))
+    {
+        const ScdFreqEntry *tmp = heap[pos];
+        heap[pos] = heap[(pos - 1) / 2];
+        heap[(pos - 1) / 2] = tmp;
+        pos = (pos - 1) / 2;
+    }
+}
+
+int scdFreqCommit(ScdFreq *freq)
+{
+    if (!freq->isDirty)
+        return 0;
+
+    /* Select the most frequent words, with a min-heap of the best so far */
+    const ScdFreqEntry **heap = malloc(SCD_HOT_WORDS * sizeof(ScdFreqEntry*));
+    if (!heap)
+    {
+        printf("Failed allocating memory for hot words\n");
+        return -1;
+    }
+
+    const ScdFreqTable *table = freq->table;
+    size_t numHot = 0;
+    size_t wordsSize = 0;
+    for (size_t i = 0; i < table->capacity; ++i)
+    {
+        const ScdFreqEntry *entry = &table->entries[i];
+        if (!entry->hash || !entry->frequency)
+            continue;
+
+        if (numHot < SCD_HOT_WORDS)
+        {
+            heap[numHot] = entry;
+            scdFreqSiftUp(heap, numHot++);
+        }
+        else if (entry->frequency > heap[0]->frequency)
+        {
+            heap[0] = entry;
+            scdFreqSiftDown(heap, numHot, 0);
+        }
+    }
+    for (size_t i = 0; i < numHot; ++i)
+        wordsSize += strlen(&freq->words->data[heap[i]->word]) + 1;
+
+    ScdHotWords *hot = NULL;
+    if (numHot)
+    {
+        size_t capacity = 16;
+        while (capacity < 2 * numHot)
+            capacity *= 2;
+
+        hot = calloc(1, sizeof(ScdHotWords) + capacity * sizeof(ScdHotEntry) +
+                     wordsSize);
+        if (!hot)
+        {
+            printf("Failed allocating memory for hot words\n");
+            free(heap);
+            return -1;
+        }
+        hot->capacity = capacity;
+        hot->size = sizeof(ScdHotWords) + capacity * sizeof(ScdHotEntry) +
+            wordsSize;
+        char *words = (char*)&hot->entries[capacity];
+        hot->words = words;
+
+        size_t offset = 0;
+        for (size_t i = 0; i < numHot; ++i)
+        {
+            const char *word = &freq->words->data[heap[i]->word];
+            const size_t len = strlen(word);
+            memcpy(&words[offset], word, len + 1);
+
+            size_t j = heap[i]->hash & (capacity - 1);
+            while (hot->entries[j].tag)
+                j = (j + 1) & (capacity - 1);
+            hot->entries[j].tag = scdHotTag(heap[i]->hash);
+            hot->entries[j].word = offset;
+
+            offset += len + 1;
+        }
+    }
+    free(heap);
+
+    ScdHotWords *old = freq->hot;
+    __atomic_store_n(&freq->hot, hot, __ATOMIC_RELEASE);
+    if (old)
+        sceRetire(freq->epoch, old, free);
+    freq->isDirty = 0;
+
+    return 0;
+}
+
+size_t scdFreqMemory(const ScdFreq *freq)
+{
+    return sizeof(ScdFreq) +
+        sizeof(ScdFreqTable) + freq->table->capacity * sizeof(ScdFreqEntry) +
+        sizeof(ScdWords) + freq->words->capacity +
+        (freq->hot ? freq->hot->size : 0);
+}
+
+int scdFreqIsHot(const ScdFreq *freq, const char *word, size_t len)
+{
+    const ScdHotWords *hot = __atomic_load_n(&freq->hot, __ATOMIC_ACQUIRE);
+    if (!hot)
+        return 0;
+
+    const uint64_t hash = scdFreqHash(word, len);
+    const uint32_t tag = scdHotTag(hash);
+    const size_t mask = hot->capacity - 1;
+    for (size_t i = hash & mask; hot->entries[i].tag; i = (i + 1) & mask)
+    {
+        if ((hot->entries[i].tag == tag) &&
+            scdFreqEquals(&hot->words[hot->entries[i].word], word, len))
+            return 1;
+    }
+    return 0;
+}
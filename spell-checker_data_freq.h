@@ -0,0 +1,76 @@
+#ifndef __SPELL_CHECKER_DATA_FREQ_H
+#define __SPELL_CHECKER_DATA_FREQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spell-checker_epoch.h"
+
+/**
+ * Word frequencies, kept by the data model front-end along with the words of
+ * any backend (see scdAddWordWithFrequency()).
+ *
+ * The frequencies are used to rank suggestions, and to pick the hot words: the
+ * SCD_HOT_WORDS most frequent ones, kept in a small table of their own that is
+ * checked before the backend. In natural text, a few thousand words make most
+ * of the tokens, so most lookups are answered from a table that stays in the
+ * cache, instead of walking a trie or probing a large hash table.
+ *
+ * Both tables follow the hash backend: open addressing, entries published with
+ * atomic stores, replaced by a copy (and retired) when they grow. The hot words
+ * are rebuilt as a whole on commit, after the frequencies changed.
+ */
+
+/*
+ * The maximal number of hot words.
+ */
+#define SCD_HOT_WORDS 8192
+
+struct ScdFreq;
+typedef struct ScdFreq ScdFreq;
+
+/**
+ * Create an empty set of frequencies.
+ * @param epoch the epoch of the data model, used to retire the memory replaced
+ * while readers may still look at it.
+ * @return the frequencies, or NULL on failure.
+ */
+ScdFreq *scdFreqInit(SceEpoch *epoch);
+
+/**
+ * Release the frequencies. There must not be any readers left.
+ */
+void scdFreqFinalize(ScdFreq *freq);
+
+/**
+ * Set the frequency of a word (writer only), replacing the previous one.
+ * @return 0 on success, -1 on failure.
+ */
+int scdFreqSet(ScdFreq *freq, const char *word, size_t len,
+               uint32_t frequency);
+
+/**
+ * @return the frequency of a word, 0 if it has none. Safe to call
+ * concurrently with the writer.
+ */
+uint32_t scdFreqGet(const ScdFreq *freq, const char *word, size_t len);
+
+/**
+ * Rebuild the hot words if frequencies were set since the last commit (writer
+ * only).
+ * @return 0 on success, -1 on failure (the previous hot words are kept).
+ */
+int scdFreqCommit(ScdFreq *freq);
+
+/**
+ * @return the memory held by the frequencies, in bytes (writer only).
+ */
+size_t scdFreqMemory(const ScdFreq *freq);
+
+/**
+ * @return 1 if the word is one of the hot words, 0 if not. Safe to call
+ * concurrently with the writer.
+ */
+int scdFreqIsHot(const ScdFreq *freq, const char *word, size_t len);
+
+#endif
@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spell-checker_data_backend.h"
+
+/**
+ * An open-addressing hash set to hold the dictionary data.
+ *
+ * Each slot in the table holds the precomputed 64-bit hash of a word and a
+ * pointer to the (normalized, null-terminated) word itself. Collisions are
+ * resolved with linear probing, and the full word is only compared when the
+ * hashes match, so a lookup is usually a single hash computation, one cache
+ * miss on the table and one on the word.
+ *
+ * The words are copied into large chunks of memory (a string pool) rather than
+ * allocated one by one, and the table is doubled once it is 3/4 full.
+ *
+ * Lookups run concurrently with adds, without locking. A slot is filled by
+ * writing the hash and then atomically publishing the word pointer, so a
+ * reader that sees the word also sees its hash. The table is doubled into a
+ * new table that is atomically published in place of the old one, which is
+ * retired (see spell-checker_epoch.h). Words never move.
+ *
+ * A removed word leaves a tombstone in its slot, so that lookups keep probing
+ * past it. Tombstones are dropped when the table is rebuilt, which happens at
+ * the same size if they are what filled it. The words themselves stay in the
+ * string pool, which is only released with the hash set.
+ *
+ * Unlike the Trie, a word is stored as a whole, so prefixes are not shared, and
+ * walking them (see scdHashForEachPrefix()) goes through every word.
+ */
+
+#define SCD_HASH_INITIAL_CAPACITY 1024
+#define SCD_HASH_POOL_CHUNK_SIZE (64 * 1024)
+
+typedef struct ScdHashEntry
+{
+    uint64_t hash;
+    const char *word; /* NULL for an empty slot */
+} ScdHashEntry;
+
+/*
+ * The word of the slots whose word was removed.
+ */
+static const char scdHashTombstone[] = "";
+
+/*
+ * A chunk of the string pool. Words longer than a chunk get a chunk of their
+ * own.
+ */
+typedef struct ScdHashChunk
+{
+    struct ScdHashChunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ScdHashChunk;
+
+/*
+ * The table and its size, published together.
+ */
+typedef struct ScdHashTable
+{
+    size_t capacity; /* always a power of 2 */
+    ScdHashEntry entries[];
+} ScdHashTable;
+
+typedef struct ScdHash
+{
+    struct _SpellCheckerData base;
+
+    ScdHashTable *table;
+    size_t numWords;
+    size_t numTombstones;
+
+    ScdHashChunk *pool;
+    size_t poolSize; /* in bytes, along with the chunk headers */
+} ScdHash;
+
+static ScdHashTable *scdHashNewTable(size_t capacity)
+{
+    ScdHashTable *table = calloc(1, sizeof(ScdHashTable) +
+                                 capacity * sizeof(ScdHashEntry));
+    if (!table)
+    {
+        printf("Failed allocating memory for hash table\n");
+        return NULL;
+    }
+    table->capacity = capacity;
+    return table;
+}
+
+static SpellCheckerDataHandle scdHashInit(void)
+{
+    ScdHash *hash = malloc(sizeof(ScdHash));
+    if (!hash)
+    {
+        printf("Failed allocating memory for hash set\n");
+        return NULL;
+    }
+
+    hash->table = scdHashNewTable(SCD_HASH_INITIAL_CAPACITY);
+    if (!hash->table)
+    {
+        free(hash);
+        return NULL;
+    }
+    hash->numWords = 0;
+    hash->numTombstones = 0;
+    hash->pool = NULL;
+    hash->poolSize = 0;
+
+    return &hash->base;
+}
+
+static void scdHashFinalize(SpellCheckerDataHandle data)
+{
+    ScdHash *hash = (ScdHash*) data;
+
+    while (hash->pool)
+    {
+        ScdHashChunk *next = hash->pool->next;
+        free(hash->pool);
+        hash->pool = next;
+    }
+    free(hash->table);
+    free(hash);
+}
+
+/*
+ * Compare a stored (normalized) word with a user supplied one.
+ */
+static inline int scdHashWordEquals(const char *stored, const char *word,
+                                    size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if ((unsigned char)stored[i] != scdNormalizeChar(word[i]))
+            return 0;
+    }
+    return ('\0' == stored[len]);
+}
+
+/*
+ * Find the slot holding the given word, or the empty slot it should go to.
+ * Safe to call concurrently with the writer (which may fill the empty slot
+ * right after it is found, so found tells which one it is).
+ */
+static ScdHashEntry *scdHashFindSlot(ScdHashTable *table, uint64_t h,
+                                     const char *word, size_t len, int *found)
+{
+    const size_t mask = table->capacity - 1;
+    size_t i = h & mask;
+    const char *stored;
+    *found = 0;
+    while ((stored = __atomic_load_n(&table->entries[i].word,
+                                     __ATOMIC_ACQUIRE)))
+    {
+        if ((table->entries[i].hash == h) && (stored != scdHashTombstone) &&
+            scdHashWordEquals(stored, word, len))
+        {
+            *found = 1;
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &table->entries[i];
+}
+
+/*
+ * Rebuild the table without its tombstones, doubled unless the words left fill
+ * less than half of it.
+ */
+static int scdHashGrow(ScdHash *hash)
+{
+    const ScdHashTable *old = hash->table;
+    const size_t capacity = ((hash->numWords + 1) * 2 > old->capacity) ?
+        old->capacity * 2 : old->capacity;
+    ScdHashTable *table = scdHashNewTable(capacity);
+    if (!table)
+        return -1;
+
+    /* Hashes are stored, so re-inserting does not touch the words */
+    for (size_t i = 0; i < old->capacity; ++i)
+    {
+        if (!old->entries[i].word ||
+            (old->entries[i].word == scdHashTombstone))
+            continue;
+        size_t j = old->entries[i].hash & (capacity - 1);
+        while (table->entries[j].word)
+            j = (j + 1) & (capacity - 1);
+        table->entries[j] = old->entries[i];
+    }
+
+    __atomic_store_n(&hash->table, table, __ATOMIC_RELEASE);
+    sceRetire(&hash->base.epoch, (void*)old, free);
+    hash->numTombstones = 0;
+
+    return 0;
+}
+
+/*
+ * Copy a normalized version of the word into the string pool.
+ */
+static const char *scdHashPoolAdd(ScdHash *hash, const char *word, size_t len)
+{
+    ScdHashChunk *chunk = hash->pool;
+    if (!chunk || (chunk->size - chunk->used < len + 1))
+    {
+        const size_t size = (len + 1 > SCD_HASH_POOL_CHUNK_SIZE) ?
+            len + 1 : SCD_HASH_POOL_CHUNK_SIZE;
+        chunk = malloc(sizeof(ScdHashChunk) + size);
+        if (!chunk)
+        {
+            printf("Failed allocating memory for string pool\n");
+            return NULL;
+        }
+        chunk->size = size;
+        chunk->used = 0;
+        chunk->next = hash->pool;
+        hash->pool = chunk;
+        hash->poolSize += sizeof(ScdHashChunk) + size;
+    }
+
+    char *copy = &chunk->data[chunk->used];
+    for (size_t i = 0; i < len; ++i)
+        copy[i] = scdNormalizeChar(word[i]);
+    copy[len] = '\0';
+    chunk->used += len + 1;
+
+    return copy;
+}
+
+static int scdHashAddWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    ScdHash *hash = (ScdHash*) data;
+    const uint64_t h = scdHashWord(word, len);
+
+    int found;
+    ScdHashEntry *entry = scdHashFindSlot(hash->table, h, word, len, &found);
+    if (found)
+        return 0;
+
+    if ((hash->numWords + hash->numTombstones + 1) * 4 >
+        hash->table->capacity * 3)
+    {
+        if (-1 == scdHashGrow(hash))
+            return -1;
+        entry = scdHashFindSlot(hash->table, h, word, len, &found);
+    }
+
+    const char *copy = scdHashPoolAdd(hash, word, len);
+    if (!copy)
+        return -1;
+
+    entry->hash = h;
+    __atomic_store_n(&entry->word, copy, __ATOMIC_RELEASE);
+    ++hash->numWords;
+
+    return 0;
+}
+
+static int scdHashRemoveWord(SpellCheckerDataHandle data, const char *word,
+                             size_t len)
+{
+    ScdHash *hash = (ScdHash*) data;
+    int found;
+    ScdHashEntry *entry = scdHashFindSlot(hash->table, scdHashWord(word, len),
+                                          word, len, &found);
+    if (!found)
+        return 0;
+
+    __atomic_store_n(&entry->word, scdHashTombstone, __ATOMIC_RELEASE);
+    --hash->numWords;
+    ++hash->numTombstones;
+
+    return 0;
+}
+
+static int scdHashHasWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    ScdHash *hash = (ScdHash*) data;
+    ScdHashTable *table = __atomic_load_n(&hash->table, __ATOMIC_ACQUIRE);
+    int found;
+    scdHashFindSlot(table, scdHashWord(word, len), word, len, &found);
+    return found;
+}
+
+/*
+ * The number of words scdHashHasWords() hashes ahead.
+ */
+#define SCD_HASH_LOOKUP_BATCH 16
+
+/*
+ * Hash a batch of words and prefetch their slots first, then look them up: the
+ * slots are loaded in parallel instead of one cache miss after the other.
+ */
+static int scdHashHasWords(SpellCheckerDataHandle data, const char **words,
+                           const size_t *lens, size_t numWords,
+                           uint8_t *results)
+{
+    ScdHash *hash = (ScdHash*) data;
+    ScdHashTable *table = __atomic_load_n(&hash->table, __ATOMIC_ACQUIRE);
+    const size_t mask = table->capacity - 1;
+    uint64_t hashes[SCD_HASH_LOOKUP_BATCH];
+
+    for (size_t first = 0; first < numWords; first += SCD_HASH_LOOKUP_BATCH)
+    {
+        const size_t num = (numWords - first < SCD_HASH_LOOKUP_BATCH) ?
+            numWords - first : SCD_HASH_LOOKUP_BATCH;
+        for (size_t w = 0; w < num; ++w)
+        {
+            hashes[w] = scdHashWord(words[first + w], lens[first + w]);
+            __builtin_prefetch(&table->entries[hashes[w] & mask]);
+        }
+        for (size_t w = 0; w < num; ++w)
+        {
+            int found;
+            scdHashFindSlot(table, hashes[w], words[first + w],
+                            lens[first + w], &found);
+            results[first + w] = found;
+        }
+    }
+
+    return 0;
+}
+
+static int scdHashForEachWord(SpellCheckerDataHandle data, ScdWordCallback cb,
+                              void *userdata)
+{
+    const ScdHash *hash = (const ScdHash*) data;
+    for (size_t i = 0; i < hash->table->capacity; ++i)
+    {
+        const char *word = hash->table->entries[i].word;
+        if (word && (word != scdHashTombstone) &&
+            (-1 == cb(word, strlen(word), userdata)))
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Words have no shared structure in a hash set, so each word is walked from
+ * its first character, until cb skips the rest of it.
+ */
+static int scdHashForEachPrefix(SpellCheckerDataHandle data,
+                                ScdPrefixCallback cb, void *userdata)
+{
+    ScdHash *hash = (ScdHash*) data;
+    const ScdHashTable *table = __atomic_load_n(&hash->table, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < table->capacity; ++i)
+    {
+        const char *word = __atomic_load_n(&table->entries[i].word,
+                                           __ATOMIC_ACQUIRE);
+        if (!word || (word == scdHashTombstone))
+            continue;
+        const size_t len = strlen(word);
+        for (size_t j = 0; j < len; ++j)
+        {
+            const int ret = cb((unsigned char)word[j], j + 1, (j + 1 == len),
+                               userdata);
+            if (-1 == ret)
+                return -1;
+            if (0 == ret)
+                break;
+        }
+    }
+    return 0;
+}
+
+static void scdHashGetStats(SpellCheckerDataHandle data, ScdStats *stats)
+{
+    const ScdHash *hash = (const ScdHash*) data;
+    stats->numWords = hash->numWords;
+    stats->numNodes = 0;
+    stats->bytes = sizeof(ScdHash) + sizeof(ScdHashTable) +
+        hash->table->capacity * sizeof(ScdHashEntry) + hash->poolSize;
+}
+
+const ScdBackend scdHashBackend = {
+    "hash",
+    scdHashInit,
+    scdHashFinalize,
+    scdHashAddWord,
+    NULL,
+    scdHashRemoveWord,
+    NULL,
+    scdHashHasWord,
+    scdHashHasWords,
+    scdHashForEachWord,
+    scdHashForEachPrefix,
+    scdHashGetStats
+};
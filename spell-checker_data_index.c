@@ -0,0 +1,599 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spell-checker_data_index.h"
+#include "spell-checker_data_backend.h"
+#include "spell-checker_data_words.h"
+
+/*
+ * An entry maps the hash of a deletion to a word: the offset of the word in
+ * the word pool (see spell-checker_data_words.h), and its length (which rules
+ * out most candidates without looking at them). A hash of 0 marks an empty
+ * slot.
+ *
+ * A word is indexed under the hash of its (truncated) self as well, which is
+ * also how a word that is added twice is detected.
+ */
+typedef struct ScdIndexEntry
+{
+    uint64_t hash;
+    uint32_t word;
+    uint32_t len;
+} ScdIndexEntry;
+
+/*
+ * The table and its size, published together.
+ */
+typedef struct ScdIndexTable
+{
+    uint64_t capacity; /* always a power of 2 */
+    ScdIndexEntry entries[];
+} ScdIndexTable;
+
+struct ScdIndex
+{
+    /* NULL for a mapped, read-only, index */
+    SceEpoch *epoch;
+
+    unsigned int maxDistance;
+    size_t budget;
+
+    ScdIndexTable *table;
+    ScdWords *words;
+    size_t numEntries;
+};
+
+#define SCD_INDEX_INITIAL_CAPACITY 1024
+#define SCD_INDEX_INITIAL_WORDS_CAPACITY (16 * 1024)
+
+#define SCD_INDEX_IMAGE_MAGIC "SCDINDX"
+
+/*
+ * Image layout: the header, then the table and the word pool, as they are in
+ * memory.
+ */
+typedef struct ScdIndexImageHeader
+{
+    char magic[8];
+    uint32_t maxDistance;
+    uint32_t prefixLen;
+    uint64_t tableOffset;
+    uint64_t wordsOffset;
+    uint64_t size;
+} ScdIndexImageHeader;
+
+/*
+ * Callback used to iterate over the deletions of a string, by their hash.
+ */
+typedef int (*ScdIndexDeleteCallback)(uint64_t hash, void *userdata);
+
+static inline uint64_t scdIndexHash(const char *str, size_t len)
+{
+    const uint64_t hash = scdHashWord(str, len);
+    return hash ? hash : 1;
+}
+
+/*
+ * Call cb for each string obtained by deleting 1 to distance characters of
+ * str, at or after position start (so each set of positions is deleted once).
+ * Deleting different positions may lead to the same string (e.g. in "aab"),
+ * which is then reported more than once.
+ */
+static int scdIndexForEachDelete(const char *str, size_t len, size_t start,
+                                 unsigned int distance,
+                                 ScdIndexDeleteCallback cb, void *userdata)
+{
+    char deleted[SCD_INDEX_PREFIX_LEN];
+    for (size_t i = start; i < len; ++i)
+    {
+        memcpy(deleted, str, i);
+        memcpy(&deleted[i], &str[i + 1], len - i - 1);
+        if ((-1 == cb(scdIndexHash(deleted, len - 1), userdata)) ||
+            ((distance > 1) &&
+             (-1 == scdIndexForEachDelete(deleted, len - 1, i, distance - 1,
+                                          cb, userdata))))
+            return -1;
+    }
+    return 0;
+}
+
+static size_t scdIndexSize(size_t tableCapacity, size_t wordsCapacity)
+{
+    return sizeof(ScdIndex) +
+        sizeof(ScdIndexTable) + tableCapacity * sizeof(ScdIndexEntry) +
+        sizeof(ScdWords) + wordsCapacity;
+}
+
+static int scdIndexFitsBudget(const ScdIndex *index, size_t tableCapacity,
+                              size_t wordsCapacity)
+{
+    if (index->budget &&
+        (scdIndexSize(tableCapacity, wordsCapacity) > index->budget))
+    {
+        printf("Suggestion index exceeds its memory budget (%zu bytes)\n",
+               index->budget);
+        return 0;
+    }
+    return 1;
+}
+
+static ScdIndexTable *scdIndexNewTable(size_t capacity)
+{
+    ScdIndexTable *table = calloc(1, sizeof(ScdIndexTable) +
+                                  capacity * sizeof(ScdIndexEntry));
+    if (!table)
+    {
+        printf("Failed allocating memory for suggestion index\n");
+        return NULL;
+    }
+    table->capacity = capacity;
+    return table;
+}
+
+ScdIndex *scdIndexInit(SceEpoch *epoch, unsigned int maxDistance,
+                       size_t budget)
+{
+    ScdIndex *index = calloc(1, sizeof(ScdIndex));
+    if (!index)
+    {
+        printf("Failed allocating memory for suggestion index\n");
+        return NULL;
+    }
+
+    index->epoch = epoch;
+    index->maxDistance = (maxDistance > SCD_INDEX_MAX_DISTANCE) ?
+        SCD_INDEX_MAX_DISTANCE : maxDistance;
+    index->budget = budget;
+
+    if (!scdIndexFitsBudget(index, SCD_INDEX_INITIAL_CAPACITY,
+                            SCD_INDEX_INITIAL_WORDS_CAPACITY))
+    {
+        free(index);
+        return NULL;
+    }
+
+    index->table = scdIndexNewTable(SCD_INDEX_INITIAL_CAPACITY);
+    index->words = scdWordsInit(SCD_INDEX_INITIAL_WORDS_CAPACITY);
+    if (!index->table || !index->words)
+    {
+        printf("Failed allocating memory for suggestion index\n");
+        scdIndexFinalize(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+void scdIndexFinalize(ScdIndex *index)
+{
+    if (!index)
+        return;
+
+    if (index->epoch)
+    {
+        free(index->table);
+        free(index->words);
+    }
+    free(index);
+}
+
+unsigned int scdIndexMaxDistance(const ScdIndex *index)
+{
+    return index->maxDistance;
+}
+
+static int scdIndexGrowTable(ScdIndex *index)
+{
+    const ScdIndexTable *old = index->table;
+    const size_t capacity = old->capacity * 2;
+    if (!scdIndexFitsBudget(index, capacity, index->words->capacity))
+        return -1;
+
+    ScdIndexTable *table = scdIndexNewTable(capacity);
+    if (!table)
+        return -1;
+
+    for (size_t i = 0; i < old->capacity; ++i)
+    {
+        if (!old->entries[i].hash)
+            continue;
+        size_t j = old->entries[i].hash & (capacity - 1);
+        while (table->entries[j].hash)
+            j = (j + 1) & (capacity - 1);
+        table->entries[j] = old->entries[i];
+    }
+
+    __atomic_store_n(&index->table, table, __ATOMIC_RELEASE);
+    sceRetire(index->epoch, (void*)old, free);
+
+    return 0;
+}
+
+/*
+ * Add an entry, unless the word is already indexed under that hash (when
+ * different deletions lead to the same string).
+ */
+static int scdIndexInsert(ScdIndex *index, uint64_t hash, uint32_t word,
+                          uint32_t len)
+{
+    if (((index->numEntries + 1) * 4 > index->table->capacity * 3) &&
+        (-1 == scdIndexGrowTable(index)))
+        return -1;
+
+    ScdIndexTable *table = index->table;
+    const size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    while (table->entries[i].hash)
+    {
+        if ((table->entries[i].hash == hash) && (table->entries[i].word == word))
+            return 0;
+        i = (i + 1) & mask;
+    }
+
+    table->entries[i].word = word;
+    table->entries[i].len = len;
+    __atomic_store_n(&table->entries[i].hash, hash, __ATOMIC_RELEASE);
+    ++index->numEntries;
+
+    return 0;
+}
+
+/*
+ * Deletions of a word being added.
+ */
+typedef struct ScdIndexAdd
+{
+    ScdIndex *index;
+    uint32_t word;
+    uint32_t len;
+} ScdIndexAdd;
+
+static int scdIndexAddDelete(uint64_t hash, void *userdata)
+{
+    ScdIndexAdd *add = userdata;
+    return scdIndexInsert(add->index, hash, add->word, add->len);
+}
+
+/*
+ * @return 1 if the word is indexed (writer only).
+ */
+static int scdIndexHasWord(const ScdIndex *index, uint64_t hash,
+                           const char *word, size_t len)
+{
+    const ScdIndexTable *table = index->table;
+    const size_t mask = table->capacity - 1;
+    for (size_t i = hash & mask; table->entries[i].hash; i = (i + 1) & mask)
+    {
+        const ScdIndexEntry *entry = &table->entries[i];
+        if ((entry->hash != hash) || (entry->len != len))
+            continue;
+
+        const char *stored = &index->words->data[entry->word];
+        size_t j = 0;
+        while ((j < len) &&
+               ((unsigned char)stored[j] == scdNormalizeChar(word[j])))
+            ++j;
+        if (j == len)
+            return 1;
+    }
+    return 0;
+}
+
+int scdIndexAddWord(ScdIndex *index, const char *word, size_t len)
+{
+    if (!index->epoch)
+    {
+        printf("Cannot add words to a mapped suggestion index\n");
+        return -1;
+    }
+
+    char prefix[SCD_INDEX_PREFIX_LEN];
+    const size_t prefixLen =
+        (len > SCD_INDEX_PREFIX_LEN) ? SCD_INDEX_PREFIX_LEN : len;
+    for (size_t i = 0; i < prefixLen; ++i)
+        prefix[i] = scdNormalizeChar(word[i]);
+
+    const uint64_t hash = scdIndexHash(prefix, prefixLen);
+    if ((len <= UINT32_MAX) && scdIndexHasWord(index, hash, word, len))
+        return 0;
+
+    /* The pool takes whatever the table leaves of the budget */
+    const size_t maxCapacity = index->budget ?
+        index->budget - scdIndexSize(index->table->capacity, 0) : SIZE_MAX;
+    const int64_t offset = scdWordsAdd(&index->words, index->epoch, word, len,
+                                       maxCapacity);
+    if (-1 == offset)
+        return -1;
+
+    ScdIndexAdd add = { index, (uint32_t)offset, (uint32_t)len };
+    if ((-1 == scdIndexInsert(index, hash, add.word, add.len)) ||
+        (-1 == scdIndexForEachDelete(prefix, prefixLen, 0, index->maxDistance,
+                                     scdIndexAddDelete, &add)))
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Search state: the candidates already seen (a set of word offsets plus one,
+ * so 0 is empty), and the rows of the distance matrix.
+ */
+typedef struct ScdIndexSearch
+{
+    const ScdIndex *index;
+    const ScdIndexTable *table;
+    const char *word; /* normalized */
+    size_t len;
+    unsigned int maxDistance;
+
+    uint32_t *seen;
+    size_t seenCapacity;
+    size_t numSeen;
+
+    unsigned int *rows; /* 3 x (len + 1) */
+
+    ScdIndexCallback cb;
+    void *userdata;
+} ScdIndexSearch;
+
+/*
+ * Mark a candidate as seen.
+ * @return 1 if it was already seen, 0 if not, -1 on failure.
+ */
+static int scdIndexSeen(ScdIndexSearch *search, uint32_t word)
+{
+    if ((search->numSeen + 1) * 2 > search->seenCapacity)
+    {
+        const size_t capacity = search->seenCapacity * 2;
+        uint32_t *seen = calloc(capacity, sizeof(uint32_t));
+        if (!seen)
+        {
+            printf("Failed allocating memory for suggestions\n");
+            return -1;
+        }
+        for (size_t i = 0; i < search->seenCapacity; ++i)
+        {
+            if (!search->seen[i])
+                continue;
+            size_t j = (search->seen[i] * 0x9e3779b1u) & (capacity - 1);
+            while (seen[j])
+                j = (j + 1) & (capacity - 1);
+            seen[j] = search->seen[i];
+        }
+        free(search->seen);
+        search->seen = seen;
+        search->seenCapacity = capacity;
+    }
+
+    const uint32_t key = word + 1;
+    const size_t mask = search->seenCapacity - 1;
+    size_t i = (key * 0x9e3779b1u) & mask;
+    while (search->seen[i])
+    {
+        if (search->seen[i] == key)
+            return 1;
+        i = (i + 1) & mask;
+    }
+    search->seen[i] = key;
+    ++search->numSeen;
+    return 0;
+}
+
+/*
+ * The distance between the searched word and a candidate (optimal string
+ * alignment, as in scdSuggest()), or maxDistance + 1 if it is larger.
+ */
+static unsigned int scdIndexDistance(ScdIndexSearch *search,
+                                     const char *candidate, size_t len)
+{
+    const unsigned char *word = (const unsigned char*)search->word;
+    const size_t width = search->len + 1;
+    unsigned int *prev2 = search->rows;
+    unsigned int *prev = &search->rows[width];
+    unsigned int *row = &search->rows[2 * width];
+
+    for (size_t j = 0; j < width; ++j)
+        prev[j] = j;
+
+    for (size_t i = 1; i <= len; ++i)
+    {
+        const unsigned char chr = candidate[i - 1];
+        row[0] = i;
+        unsigned int best = row[0];
+        for (size_t j = 1; j < width; ++j)
+        {
+            unsigned int d = prev[j - 1] + (word[j - 1] != chr);
+            if (prev[j] + 1 < d)
+                d = prev[j] + 1;
+            if (row[j - 1] + 1 < d)
+                d = row[j - 1] + 1;
+            if ((i > 1) && (j > 1) && (word[j - 2] == chr) &&
+                (word[j - 1] == (unsigned char)candidate[i - 2]) &&
+                (prev2[j - 2] + 1 < d))
+                d = prev2[j - 2] + 1;
+            row[j] = d;
+            if (d < best)
+                best = d;
+        }
+        if (best > search->maxDistance)
+            return search->maxDistance + 1;
+
+        unsigned int *rotated = prev2;
+        prev2 = prev;
+        prev = row;
+        row = rotated;
+    }
+
+    return prev[width - 1];
+}
+
+static int scdIndexProbe(uint64_t hash, void *userdata)
+{
+    ScdIndexSearch *search = userdata;
+    const ScdIndexTable *table = search->table;
+    const size_t mask = table->capacity - 1;
+    uint64_t stored;
+
+    for (size_t i = hash & mask;
+         (stored = __atomic_load_n(&table->entries[i].hash, __ATOMIC_ACQUIRE));
+         i = (i + 1) & mask)
+    {
+        if (stored != hash)
+            continue;
+
+        const ScdIndexEntry *entry = &table->entries[i];
+        const size_t len = entry->len;
+        if ((len + search->maxDistance < search->len) ||
+            (search->len + search->maxDistance < len))
+            continue;
+
+        const int seen = scdIndexSeen(search, entry->word);
+        if (-1 == seen)
+            return -1;
+        if (seen)
+            continue;
+
+        const char *candidate =
+            scdWordsGet(&search->index->words, entry->word, len);
+        if (!candidate)
+            continue;
+
+        const unsigned int distance =
+            scdIndexDistance(search, candidate, len);
+        if ((distance <= search->maxDistance) &&
+            (-1 == search->cb(candidate, len, distance, search->userdata)))
+            return -1;
+    }
+
+    return 0;
+}
+
+int scdIndexSuggest(const ScdIndex *index, const char *word, size_t len,
+                    unsigned int maxDistance, ScdIndexCallback cb,
+                    void *userdata)
+{
+    ScdIndexSearch search;
+    search.index = index;
+    search.table = __atomic_load_n(&index->table, __ATOMIC_ACQUIRE);
+    search.len = len;
+    search.maxDistance = (maxDistance > index->maxDistance) ?
+        index->maxDistance : maxDistance;
+    search.seenCapacity = 64;
+    search.numSeen = 0;
+    search.seen = calloc(search.seenCapacity, sizeof(uint32_t));
+    search.rows = malloc(3 * (len + 1) * sizeof(unsigned int));
+    search.cb = cb;
+    search.userdata = userdata;
+
+    char *normalized = malloc(len + 1);
+    search.word = normalized;
+
+    int ret = -1;
+    if (!search.seen || !search.rows || !normalized)
+    {
+        printf("Failed allocating memory for suggestions\n");
+        goto out;
+    }
+    for (size_t i = 0; i < len; ++i)
+        normalized[i] = scdNormalizeChar(word[i]);
+
+    const size_t prefixLen =
+        (len > SCD_INDEX_PREFIX_LEN) ? SCD_INDEX_PREFIX_LEN : len;
+    if ((-1 == scdIndexProbe(scdIndexHash(normalized, prefixLen), &search)) ||
+        (-1 == scdIndexForEachDelete(normalized, prefixLen, 0,
+                                     search.maxDistance, scdIndexProbe,
+                                     &search)))
+        goto out;
+    ret = 0;
+
+out:
+    free(normalized);
+    free(search.rows);
+    free(search.seen);
+    return ret;
+}
+
+size_t scdIndexMemory(const ScdIndex *index)
+{
+    if (!index->epoch)
+        return sizeof(ScdIndex);
+    return scdIndexSize(index->table->capacity, index->words->capacity);
+}
+
+size_t scdIndexImageSize(const ScdIndex *index)
+{
+    return sizeof(ScdIndexImageHeader) +
+        sizeof(ScdIndexTable) + index->table->capacity * sizeof(ScdIndexEntry) +
+        sizeof(ScdWords) + index->words->size;
+}
+
+int scdIndexWriteImage(const ScdIndex *index, FILE *file)
+{
+    const ScdIndexTable *table = index->table;
+    ScdWords words = *index->words;
+    words.capacity = words.size;
+
+    ScdIndexImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCD_INDEX_IMAGE_MAGIC, sizeof(SCD_INDEX_IMAGE_MAGIC));
+    header.maxDistance = index->maxDistance;
+    header.prefixLen = SCD_INDEX_PREFIX_LEN;
+    header.tableOffset = sizeof(header);
+    header.wordsOffset = header.tableOffset + sizeof(ScdIndexTable) +
+        table->capacity * sizeof(ScdIndexEntry);
+    header.size = scdIndexImageSize(index);
+
+    if ((1 != fwrite(&header, sizeof(header), 1, file)) ||
+        (1 != fwrite(table, sizeof(ScdIndexTable), 1, file)) ||
+        (table->capacity != fwrite(table->entries, sizeof(ScdIndexEntry),
+                                   table->capacity, file)) ||
+        (1 != fwrite(&words, sizeof(ScdWords), 1, file)) ||
+        (words.size != fwrite(index->words->data, 1, words.size, file)))
+        return -1;
+
+    return 0;
+}
+
+ScdIndex *scdIndexOpenImage(const void *image, size_t size)
+{
+    const ScdIndexImageHeader *header = image;
+    if ((size < sizeof(*header) + sizeof(ScdIndexTable)) ||
+        memcmp(header->magic, SCD_INDEX_IMAGE_MAGIC,
+               sizeof(SCD_INDEX_IMAGE_MAGIC)) ||
+        (header->maxDistance > SCD_INDEX_MAX_DISTANCE) ||
+        (SCD_INDEX_PREFIX_LEN != header->prefixLen) ||
+        (size != header->size) ||
+        (sizeof(*header) != header->tableOffset))
+        return NULL;
+
+    const ScdIndexTable *table =
+        (const ScdIndexTable*)((const char*)image + header->tableOffset);
+    if (!table->capacity || (table->capacity & (table->capacity - 1)) ||
+        (table->capacity > (size - header->tableOffset) / sizeof(ScdIndexEntry)) ||
+        (header->wordsOffset != header->tableOffset + sizeof(ScdIndexTable) +
+         table->capacity * sizeof(ScdIndexEntry)) ||
+        (header->wordsOffset + sizeof(ScdWords) > size))
+        return NULL;
+
+    /* Subtracted, as an untrusted size could make the sum wrap around */
+    const ScdWords *words =
+        (const ScdWords*)((const char*)image + header->wordsOffset);
+    if (words->size != size - header->wordsOffset - sizeof(ScdWords))
+        return NULL;
+
+    ScdIndex *index = calloc(1, sizeof(ScdIndex));
+    if (!index)
+    {
+        printf("Failed allocating memory for suggestion index\n");
+        return NULL;
+    }
+
+    /* The image is only read, casting away const is safe */
+    index->maxDistance = header->maxDistance;
+    index->table = (ScdIndexTable*)table;
+    index->words = (ScdWords*)words;
+
+    return index;
+}
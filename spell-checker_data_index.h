@@ -0,0 +1,118 @@
+#ifndef __SPELL_CHECKER_DATA_INDEX_H
+#define __SPELL_CHECKER_DATA_INDEX_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "spell-checker_epoch.h"
+
+/**
+ * A deletion index, finding the words close to a given one with a few hash
+ * probes instead of a walk over the dictionary (the "symmetric delete"
+ * algorithm of SymSpell, see https://github.com/wolfgarbe/SymSpell).
+ *
+ * If two words are within distance N of each other, deleting at most N
+ * characters from each of them leads to a common string. The index maps every
+ * string obtained by deleting up to N characters from a word to that word.
+ * Looking up a word then only takes generating its own deletions, probing the
+ * index for each, and computing the actual distance of the few candidates
+ * found.
+ *
+ * The index is an optional companion of a data model (see scdSetIndex()),
+ * updated along with it, and read concurrently with it (under the same epoch).
+ * Like the hash backend, it is an open-addressing table whose entries are
+ * published with atomic stores, and that is replaced by a copy when it grows.
+ * Only the first SCD_INDEX_PREFIX_LEN characters of a word are deleted from,
+ * which bounds the number of entries per word, and the index stops growing
+ * once it reaches its memory budget.
+ */
+
+/*
+ * The maximal distance an index can be built for.
+ */
+#define SCD_INDEX_MAX_DISTANCE 3
+
+/*
+ * The number of leading characters of a word that deletions are made in.
+ */
+#define SCD_INDEX_PREFIX_LEN 7
+
+struct ScdIndex;
+typedef struct ScdIndex ScdIndex;
+
+/*
+ * Callback used to report the words found by scdIndexSuggest(). The word is
+ * normalized, and not null-terminated.
+ * @return 0 to continue, -1 to abort the search.
+ */
+typedef int (*ScdIndexCallback)(const char *word, size_t len,
+                                unsigned int distance, void *userdata);
+
+/**
+ * Create an empty index.
+ * @param epoch the epoch of the data model, used to retire the memory replaced
+ * while readers may still look at it.
+ * @param maxDistance the maximal distance of the words found, capped at
+ * SCD_INDEX_MAX_DISTANCE.
+ * @param budget the maximal number of bytes the index may use, 0 for no limit.
+ * @return the index, or NULL on failure.
+ */
+ScdIndex *scdIndexInit(SceEpoch *epoch, unsigned int maxDistance,
+                       size_t budget);
+
+/**
+ * Release the index. There must not be any readers left.
+ */
+void scdIndexFinalize(ScdIndex *index);
+
+/**
+ * Index a word (writer only). Adding a word twice has no effect.
+ * @return 0 on success, -1 on failure or if the word does not fit in the
+ * budget, in which case the index misses the word, and should not be used
+ * anymore.
+ */
+int scdIndexAddWord(ScdIndex *index, const char *word, size_t len);
+
+/**
+ * @return the maximal distance of the words the index finds.
+ */
+unsigned int scdIndexMaxDistance(const ScdIndex *index);
+
+/**
+ * Find the indexed words within the given distance of a word, in no
+ * particular order. Safe to call concurrently with the writer.
+ * @param maxDistance at most scdIndexMaxDistance().
+ * @return 0 on success, -1 on failure or if cb aborted the search.
+ */
+int scdIndexSuggest(const ScdIndex *index, const char *word, size_t len,
+                    unsigned int maxDistance, ScdIndexCallback cb,
+                    void *userdata);
+
+/**
+ * @return the memory held by the index, in bytes (writer only). A mapped index
+ * lives in its image, and holds none besides its handle.
+ */
+size_t scdIndexMemory(const ScdIndex *index);
+
+/**
+ * @return the size of the index once written with scdIndexWriteImage().
+ */
+size_t scdIndexImageSize(const ScdIndex *index);
+
+/**
+ * Write the index as a flat, pointer-free image (a section of a dictionary
+ * image file).
+ * @return 0 on success, -1 on failure.
+ */
+int scdIndexWriteImage(const ScdIndex *index, FILE *file);
+
+/**
+ * Use an image written by scdIndexWriteImage() in place, read-only. Only the
+ * layout is validated, the rest of the image is trusted.
+ * @param image the image, 8-bytes aligned. It must outlive the index.
+ * @param size the size of the image.
+ * @return the index, or NULL if the image is invalid.
+ */
+ScdIndex *scdIndexOpenImage(const void *image, size_t size);
+
+#endif
@@ -0,0 +1,673 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spell-checker_arena.h"
+#include "spell-checker_data_backend.h"
+
+/**
+ * A Trie implementation to hold the dictionary data.
+ *
+ * See https://en.wikipedia.org/wiki/Trie for a description of a Trie.
+ *
+ * Each node in the Trie holds a single character and a compact array of its
+ * children, sorted by character. Only children that are actually used are
+ * stored, so a node costs sizeof(ScdTrieNode) (16 bytes on 64-bit)
+ * inside its parent's array, and leaves allocate nothing at all.
+ *
+ * A node marks whether a word ends at it, so that the prefixes of a word are
+ * not words themselves: with "international" added, "inter" is a path of the
+ * Trie but not a word, until it is added too. The mark fits in the padding
+ * of the node, after its character. The paths themselves answer prefix
+ * queries (see scdHasPrefix()).
+ * The children array grows in powers of two (up to MAX_CHARS_PER_NODE).
+ *
+ * Lookups run concurrently with adds, without locking. A children array is
+ * never modified where readers may see it: a child is either appended past
+ * the number of children (which is then atomically incremented), or the array
+ * is copied with the child inserted, and the copy is atomically published in
+ * place of the original, which is retired (see spell-checker_epoch.h). Copies
+ * share the arrays of the grandchildren, so an insert copies a single array.
+ * Removing a word unmarks its node, and unlinks the nodes no other word goes
+ * through from their parent's array the same way.
+ *
+ * Looking up a child is a binary search over at most MAX_CHARS_PER_NODE
+ * entries (in practice a few dozen at the top of the Trie and one or two
+ * below), so a lookup is still O(word length).
+ *
+ * Visual representation of the Trie containing the words 'a', 'air' and 'and'
+ * (* marks the end of a word):
+ *
+ *                   (0)            <-- Root
+ *                    |
+ *                   [a*]           <-- 1 child, the end of 'a'
+ *                    |
+ *                 [i, n]           <-- 2 children, sorted
+ *                  |   |
+ *                [r*] [d*]         <-- 1 child each
+ *                  |   |
+ *                  -   -           <-- leaves, no children array
+ *
+ * The previous implementation allocated a 256-wide children array for every
+ * node (including leaves), about 4 KB per character on 64-bit. Measured on a
+ * synthetic dictionary of 50k words (9.5 characters per word on average, -O3,
+ * 1M lookups of random dictionary words):
+ *
+ *                     256-wide arrays     compact arrays
+ *   trie RSS          1177 MB             8.2 MB
+ *   load time         3.96 s              0.11 s
+ *   1M lookups        2.56 s              1.93 s
+ *   teardown          0.80 s              0.10 s
+ *
+ * Children arrays are allocated from an arena owned by the Trie (see
+ * spell-checker_arena.h), so arrays built one after the other sit next to each
+ * other, the arrays replaced by larger ones are reused, and the Trie is
+ * released by unmapping the arena rather than walking it. Measured on 1M random
+ * words added one at a time (-O3):
+ *
+ *                     malloc()            arena
+ *   trie RSS          148 MB              119 MB
+ *   load time         1.45 s              1.23 s
+ *   teardown          0.77 s              0.01 s
+ *
+ * The root node has its character element set to 0.
+ * Upon initialization, only the root node is created, with no children.
+ * Every time a word is added, a new node is inserted at its sorted position in
+ * the children array of its parent.
+ */
+
+/*
+ *Max ascii values (with extended characters)
+ */
+#define MAX_CHARS_PER_NODE 256
+
+/*
+ * Each data node holds a character and a sorted array of up to
+ * MAX_CHARS_PER_NODE children.
+ */
+typedef struct ScdTrieNode
+{
+    unsigned char chr;
+    unsigned char isWord; /* 1 if a word ends here */
+    struct ScdTrieChildren *children; /* NULL for a leaf */
+} ScdTrieNode;
+
+/*
+ * The children of a node. The count lives with the array, so a reader always
+ * gets the two from a single (atomic) pointer load.
+ */
+typedef struct ScdTrieChildren
+{
+    unsigned short numChildren;
+    unsigned short capacity;
+    ScdTrieNode child[];
+} ScdTrieChildren;
+
+typedef struct ScdTrie
+{
+    struct _SpellCheckerData base;
+    ScdTrieNode root;
+
+    /* All the children arrays */
+    ScaArena arena;
+
+    size_t numNodes; /* not counting the root */
+    size_t numWords;
+} ScdTrie;
+
+static inline size_t scdTrieChildrenSize(unsigned short capacity)
+{
+    return sizeof(ScdTrieChildren) + capacity * sizeof(ScdTrieNode);
+}
+
+/*
+ * Return a children array that readers cannot reach anymore to the arena.
+ */
+static void scdTrieFreeChildren(void *children, void *trie)
+{
+    scaFree(&((ScdTrie*) trie)->arena, children,
+            scdTrieChildrenSize(((ScdTrieChildren*) children)->capacity));
+}
+
+/*
+ * Initialize a node with the given character. The children array is only
+ * allocated once a child is inserted.
+ */
+static void scdTrieInitNode(unsigned char chr, ScdTrieNode *node)
+{
+    node->chr = chr;
+    node->isWord = 0;
+    node->children = NULL;
+}
+
+/*
+ * Mark the node a word just added ends at. Its path is already published, so
+ * once readers see the mark, they can reach the node.
+ */
+static void scdTrieMarkWord(ScdTrie *trie, ScdTrieNode *node)
+{
+    if (node->isWord)
+        return;
+    __atomic_store_n(&node->isWord, 1, __ATOMIC_RELEASE);
+    ++trie->numWords;
+}
+
+static inline int scdTrieIsWord(const ScdTrieNode *node)
+{
+    return __atomic_load_n(&node->isWord, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Atomically get the children of a node (and their count), as published by
+ * the writer.
+ */
+static inline const ScdTrieChildren *scdTrieChildren(const ScdTrieNode *node,
+                                                     unsigned short *num)
+{
+    const ScdTrieChildren *children =
+        __atomic_load_n(&node->children, __ATOMIC_ACQUIRE);
+    *num = children ?
+        __atomic_load_n(&children->numChildren, __ATOMIC_ACQUIRE) : 0;
+    return children;
+}
+
+/*
+ * Binary search for the child holding the given character.
+ * @return the index of the child if found, or -(insertion index + 1) if not.
+ */
+static inline int scdTrieFindChild(const ScdTrieChildren *children,
+                                   unsigned short num, unsigned char chr)
+{
+    int lo = 0;
+    int hi = (int)num - 1;
+    while (lo <= hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const unsigned char c = children->child[mid].chr;
+        if (c == chr)
+            return mid;
+        if (c < chr)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -(lo + 1);
+}
+
+/*
+ * Insert a new child holding the given character at the given (sorted)
+ * position. The child is appended in place if it goes last and there is room
+ * for it, otherwise the children array is replaced by a (larger if needed)
+ * copy.
+ * @return the new child, or NULL on allocation failure.
+ */
+static ScdTrieNode *scdTrieInsertChild(ScdTrie *trie, ScdTrieNode *node,
+                                       int pos, unsigned char chr)
+{
+    ScdTrieChildren *children = node->children;
+    const unsigned short num = children ? children->numChildren : 0;
+
+    if (children && (pos == num) && (num < children->capacity))
+    {
+        scdTrieInitNode(chr, &children->child[pos]);
+        __atomic_store_n(&children->numChildren, num + 1, __ATOMIC_RELEASE);
+        ++trie->numNodes;
+        return &children->child[pos];
+    }
+
+    const unsigned short capacity = !children ? 1 :
+        (num == children->capacity) ? num * 2 : children->capacity;
+    ScdTrieChildren *copy = scaAlloc(&trie->arena,
+                                     scdTrieChildrenSize(capacity));
+    if (!copy)
+    {
+        printf("Failed allocating memory for child array\n");
+        return NULL;
+    }
+    copy->numChildren = num + 1;
+    copy->capacity = capacity;
+    if (children)
+    {
+        memcpy(copy->child, children->child, pos * sizeof(ScdTrieNode));
+        memcpy(&copy->child[pos + 1], &children->child[pos],
+               (num - pos) * sizeof(ScdTrieNode));
+    }
+    scdTrieInitNode(chr, &copy->child[pos]);
+
+    __atomic_store_n(&node->children, copy, __ATOMIC_RELEASE);
+    if (children)
+        sceRetireWith(&trie->base.epoch, children, scdTrieFreeChildren, trie);
+
+    ++trie->numNodes;
+    return &copy->child[pos];
+}
+
+/*
+ * Remove the child at the given position, which must be a leaf. The children
+ * array is replaced by a copy without it (or dropped with its last child), as
+ * readers may be searching it.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int scdTrieRemoveChild(ScdTrie *trie, ScdTrieNode *node, int pos)
+{
+    ScdTrieChildren *children = node->children;
+    const unsigned short num = children->numChildren;
+
+    ScdTrieChildren *copy = NULL;
+    if (num > 1)
+    {
+        copy = scaAlloc(&trie->arena, scdTrieChildrenSize(num - 1));
+        if (!copy)
+        {
+            printf("Failed allocating memory for child array\n");
+            return -1;
+        }
+        copy->numChildren = num - 1;
+        copy->capacity = num - 1;
+        memcpy(copy->child, children->child, pos * sizeof(ScdTrieNode));
+        memcpy(&copy->child[pos], &children->child[pos + 1],
+               (num - pos - 1) * sizeof(ScdTrieNode));
+    }
+
+    __atomic_store_n(&node->children, copy, __ATOMIC_RELEASE);
+    sceRetireWith(&trie->base.epoch, children, scdTrieFreeChildren, trie);
+
+    --trie->numNodes;
+    return 0;
+}
+
+static SpellCheckerDataHandle scdTrieInit(void)
+{
+    ScdTrie *trie = malloc(sizeof(ScdTrie));
+    if (!trie)
+    {
+        printf("Failed allocating memory for trie\n");
+        return NULL;
+    }
+
+    scdTrieInitNode(0, &trie->root);
+    scaInit(&trie->arena);
+    trie->numNodes = 0;
+    trie->numWords = 0;
+
+    return &trie->base;
+}
+
+static void scdTrieFinalize(SpellCheckerDataHandle data)
+{
+    ScdTrie *trie = (ScdTrie*) data;
+    scaFinalize(&trie->arena);
+    free(trie);
+}
+
+static int scdTrieAddWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    ScdTrie *trie = (ScdTrie*) data;
+    ScdTrieNode *node = &trie->root;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned char c = scdNormalizeChar(word[i]);
+        const unsigned short num = node->children ?
+            node->children->numChildren : 0;
+        const int pos = scdTrieFindChild(node->children, num, c);
+        if (pos >= 0)
+        {
+            node = &node->children->child[pos];
+        }
+        else
+        {
+            node = scdTrieInsertChild(trie, node, -pos - 1, c);
+            if (!node)
+                return -1;
+        }
+    }
+
+    scdTrieMarkWord(trie, node);
+    return 0;
+}
+
+static int scdTrieHasWord(SpellCheckerDataHandle data, const char *word,
+                          size_t len)
+{
+    const ScdTrieNode *node = &((ScdTrie*) data)->root;
+    size_t i = 0;
+    while (i < len)
+    {
+        unsigned short num;
+        const ScdTrieChildren *children = scdTrieChildren(node, &num);
+        const int pos =
+            scdTrieFindChild(children, num, scdNormalizeChar(word[i]));
+        if (pos < 0)
+            return 0;
+        else
+            node = &children->child[pos];
+        ++i;
+    }
+
+    return scdTrieIsWord(node);
+}
+
+/*
+ * Unmark the node of the word, and remove the nodes that no other word goes
+ * through: the branch below the deepest node of the path that is the root, a
+ * word, or the parent of another branch. The branch is a chain of single
+ * children, unlinked at once, and its children arrays are retired.
+ */
+static int scdTrieRemoveWord(SpellCheckerDataHandle data, const char *word,
+                             size_t len)
+{
+    ScdTrie *trie = (ScdTrie*) data;
+    ScdTrieNode *node = &trie->root;
+    ScdTrieNode *cut = node;
+    int cutPos = 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned short num = node->children ?
+            node->children->numChildren : 0;
+        const int pos = scdTrieFindChild(node->children, num,
+                                         scdNormalizeChar(word[i]));
+        if (pos < 0)
+            return 0;
+
+        if ((node == &trie->root) || node->isWord || (num > 1))
+        {
+            cut = node;
+            cutPos = pos;
+        }
+        node = &node->children->child[pos];
+    }
+
+    if (!node->isWord)
+        return 0;
+    __atomic_store_n(&node->isWord, 0, __ATOMIC_RELEASE);
+    --trie->numWords;
+
+    /* Still the prefix of other words */
+    if (node->children || (node == &trie->root))
+        return 0;
+
+    /* The retired array stays valid until the next reclaim */
+    const ScdTrieNode *branch = &cut->children->child[cutPos];
+    if (-1 == scdTrieRemoveChild(trie, cut, cutPos))
+        return -1;
+
+    while (branch->children)
+    {
+        ScdTrieChildren *children = branch->children;
+        branch = &children->child[0];
+        sceRetireWith(&trie->base.epoch, children, scdTrieFreeChildren, trie);
+        --trie->numNodes;
+    }
+
+    return 0;
+}
+
+/*
+ * The number of words scdTrieHasWords() walks at once.
+ */
+#define SCD_TRIE_LOOKUP_BATCH 16
+
+/*
+ * Walk several words down the trie in lockstep, one level per word in turn:
+ * once a word moved to a child, the child's children array is prefetched, and
+ * the other words take their step while it is loaded. A lone lookup instead
+ * waits for a cache miss at almost every level of a large trie. A slot that is
+ * done with its word takes the next one, so short words do not leave slots
+ * idle.
+ */
+static int scdTrieHasWords(SpellCheckerDataHandle data, const char **words,
+                           const size_t *lens, size_t numWords,
+                           uint8_t *results)
+{
+    const ScdTrieNode *root = &((ScdTrie*) data)->root;
+    const ScdTrieNode *nodes[SCD_TRIE_LOOKUP_BATCH];
+    size_t slotWords[SCD_TRIE_LOOKUP_BATCH];
+    size_t depths[SCD_TRIE_LOOKUP_BATCH];
+
+    size_t next = 0;
+    size_t numActive = 0;
+    for (size_t s = 0; s < SCD_TRIE_LOOKUP_BATCH; ++s)
+    {
+        nodes[s] = (next < numWords) ? root : NULL;
+        slotWords[s] = next;
+        depths[s] = 0;
+        if (nodes[s])
+        {
+            ++next;
+            ++numActive;
+        }
+    }
+
+    while (numActive)
+    {
+        for (size_t s = 0; s < SCD_TRIE_LOOKUP_BATCH; ++s)
+        {
+            const ScdTrieNode *node = nodes[s];
+            if (!node)
+                continue;
+
+            const size_t w = slotWords[s];
+            const size_t i = depths[s];
+            int result = -1; /* not known yet */
+            if (i == lens[w])
+            {
+                result = scdTrieIsWord(node);
+            }
+            else
+            {
+                unsigned short num;
+                const ScdTrieChildren *children = scdTrieChildren(node, &num);
+                const int pos = scdTrieFindChild(children, num,
+                                                 scdNormalizeChar(words[w][i]));
+                if (pos < 0)
+                {
+                    result = 0;
+                }
+                else
+                {
+                    node = &children->child[pos];
+                    __builtin_prefetch(
+                        __atomic_load_n(&node->children, __ATOMIC_RELAXED));
+                    nodes[s] = node;
+                    depths[s] = i + 1;
+                }
+            }
+
+            if (-1 != result)
+            {
+                results[w] = result;
+                if (next < numWords)
+                {
+                    nodes[s] = root;
+                    slotWords[s] = next++;
+                    depths[s] = 0;
+                }
+                else
+                {
+                    nodes[s] = NULL;
+                    --numActive;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add a batch of words, starting each word from the longest prefix it shares
+ * with the previous one instead of from the root. For sorted input, this
+ * builds the Trie in a single pass over the characters, and new children are
+ * always appended at the end of the children arrays.
+ *
+ * path[i] is the node for the first i characters of the previous word. Only
+ * the children array of path[common] is modified when adding a word, which
+ * can only replace path[common + 1] and deeper nodes, which are replaced
+ * anyway.
+ */
+static int scdTrieAddWords(SpellCheckerDataHandle data, const char **words,
+                           const size_t *lens, size_t numWords)
+{
+    ScdTrie *trie = (ScdTrie*) data;
+    ScdTrieNode **path = NULL;
+    size_t capacity = 0;
+    size_t depth = 0;
+    int ret = 0;
+
+    for (size_t w = 0; w < numWords; ++w)
+    {
+        const char *word = words[w];
+        const size_t len = lens[w];
+
+        if (len + 1 > capacity)
+        {
+            const size_t capacity2 = (len + 1 > 2 * capacity) ?
+                len + 1 : 2 * capacity;
+            ScdTrieNode **path2 = realloc(path, capacity2 * sizeof(*path));
+            if (!path2)
+            {
+                printf("Failed allocating memory for trie path\n");
+                ret = -1;
+                break;
+            }
+            path = path2;
+            capacity = capacity2;
+        }
+        path[0] = &trie->root;
+
+        size_t i = 0;
+        while ((i < depth) && (i < len) &&
+               (path[i + 1]->chr == scdNormalizeChar(word[i])))
+            ++i;
+
+        ScdTrieNode *node = path[i];
+        for (; i < len; ++i)
+        {
+            const unsigned char c = scdNormalizeChar(word[i]);
+            const unsigned short num = node->children ?
+                node->children->numChildren : 0;
+            const int pos = scdTrieFindChild(node->children, num, c);
+            node = (pos >= 0) ? &node->children->child[pos] :
+                scdTrieInsertChild(trie, node, -pos - 1, c);
+            if (!node)
+            {
+                ret = -1;
+                break;
+            }
+            path[i + 1] = node;
+        }
+        if (-1 == ret)
+            break;
+        scdTrieMarkWord(trie, node);
+        depth = len;
+    }
+
+    free(path);
+    return ret;
+}
+
+/*
+ * Iteration state: the path from the root to the current node.
+ */
+typedef struct ScdTrieWalk
+{
+    char *word;
+    size_t capacity;
+    ScdWordCallback cb;
+    void *userdata;
+} ScdTrieWalk;
+
+/*
+ * Call the callback for each word below the given node, in sorted order.
+ */
+static int scdTrieWalk(const ScdTrieNode *node, size_t depth, ScdTrieWalk *walk)
+{
+    if (depth == walk->capacity)
+    {
+        const size_t capacity = walk->capacity ? walk->capacity * 2 : 32;
+        char *word = realloc(walk->word, capacity);
+        if (!word)
+        {
+            printf("Failed allocating memory for word\n");
+            return -1;
+        }
+        walk->word = word;
+        walk->capacity = capacity;
+    }
+
+    const ScdTrieChildren *children = node->children;
+    const unsigned short num = children ? children->numChildren : 0;
+    for (unsigned short i = 0; i < num; ++i)
+    {
+        walk->word[depth] = children->child[i].chr;
+        if ((children->child[i].isWord &&
+             (-1 == walk->cb(walk->word, depth + 1, walk->userdata))) ||
+            (-1 == scdTrieWalk(&children->child[i], depth + 1, walk)))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int scdTrieForEachWord(SpellCheckerDataHandle data, ScdWordCallback cb,
+                              void *userdata)
+{
+    ScdTrieWalk walk = { NULL, 0, cb, userdata };
+    const int ret = scdTrieWalk(&((ScdTrie*) data)->root, 0, &walk);
+    free(walk.word);
+    return ret;
+}
+
+/*
+ * Walk the prefixes below the given node, in sorted order.
+ */
+static int scdTrieWalkPrefixes(const ScdTrieNode *node, size_t depth,
+                               ScdPrefixCallback cb, void *userdata)
+{
+    unsigned short num;
+    const ScdTrieChildren *children = scdTrieChildren(node, &num);
+    for (unsigned short i = 0; i < num; ++i)
+    {
+        const int ret = cb(children->child[i].chr, depth + 1,
+                           scdTrieIsWord(&children->child[i]), userdata);
+        if ((-1 == ret) ||
+            ((1 == ret) && (-1 == scdTrieWalkPrefixes(&children->child[i],
+                                                      depth + 1, cb,
+                                                      userdata))))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int scdTrieForEachPrefix(SpellCheckerDataHandle data,
+                                ScdPrefixCallback cb, void *userdata)
+{
+    return scdTrieWalkPrefixes(&((ScdTrie*) data)->root, 0, cb, userdata);
+}
+
+static void scdTrieGetStats(SpellCheckerDataHandle data, ScdStats *stats)
+{
+    const ScdTrie *trie = (const ScdTrie*) data;
+    stats->numWords = trie->numWords;
+    stats->numNodes = trie->numNodes;
+    stats->bytes = sizeof(ScdTrie) + trie->arena.size;
+}
+
+const ScdBackend scdTrieBackend = {
+    "trie",
+    scdTrieInit,
+    scdTrieFinalize,
+    scdTrieAddWord,
+    scdTrieAddWords,
+    scdTrieRemoveWord,
+    NULL,
+    scdTrieHasWord,
+    scdTrieHasWords,
+    scdTrieForEachWord,
+    scdTrieForEachPrefix,
+    scdTrieGetStats
+};
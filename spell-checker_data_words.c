@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spell-checker_data_words.h"
+#include "spell-checker_data_backend.h"
+
+ScdWords *scdWordsInit(size_t capacity)
+{
+    ScdWords *words = malloc(sizeof(ScdWords) + capacity);
+    if (!words)
+    {
+        printf("Failed allocating memory for word pool\n");
+        return NULL;
+    }
+
+    words->size = 0;
+    words->capacity = capacity;
+    return words;
+}
+
+int64_t scdWordsAdd(ScdWords **words, SceEpoch *epoch, const char *word,
+                    size_t len, size_t maxCapacity)
+{
+    ScdWords *pool = *words;
+    const size_t size = pool->size + len + 1;
+    if (size > UINT32_MAX)
+    {
+        printf("Word pool is full\n");
+        return -1;
+    }
+
+    if (size > pool->capacity)
+    {
+        const size_t capacity = (size > 2 * pool->capacity) ?
+            size : 2 * pool->capacity;
+        if (capacity > maxCapacity)
+        {
+            printf("Word pool exceeds its memory budget\n");
+            return -1;
+        }
+
+        ScdWords *copy = malloc(sizeof(ScdWords) + capacity);
+        if (!copy)
+        {
+            printf("Failed allocating memory for word pool\n");
+            return -1;
+        }
+        memcpy(copy, pool, sizeof(ScdWords) + pool->size);
+        copy->capacity = capacity;
+
+        __atomic_store_n(words, copy, __ATOMIC_RELEASE);
+        sceRetire(epoch, pool, free);
+        pool = copy;
+    }
+
+    const size_t offset = pool->size;
+    for (size_t i = 0; i < len; ++i)
+        pool->data[offset + i] = scdNormalizeChar(word[i]);
+    pool->data[offset + len] = '\0';
+    __atomic_store_n(&pool->size, size, __ATOMIC_RELEASE);
+
+    return offset;
+}
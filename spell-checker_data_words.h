@@ -0,0 +1,70 @@
+#ifndef __SPELL_CHECKER_DATA_WORDS_H
+#define __SPELL_CHECKER_DATA_WORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spell-checker_epoch.h"
+
+/**
+ * A word pool: words, normalized and null-terminated, back to back, referred
+ * to by their 32-bit offset. Used by the tables the front-end keeps along with
+ * the words of any backend (the suggestion index and the word frequencies).
+ *
+ * A single writer appends words while readers look them up. The pool is
+ * replaced by a larger copy when full (and retired), so the offset of a word
+ * never changes: a reader that found an offset in a table entry loads the pool
+ * after the entry, and the pool it gets holds the word.
+ *
+ * The layout is fixed-size and pointer-free, so a pool can be written to an
+ * image and used in place once mapped.
+ */
+typedef struct ScdWords
+{
+    uint64_t size;
+    uint64_t capacity;
+    char data[];
+} ScdWords;
+
+/**
+ * Create an empty pool.
+ * @param capacity the initial capacity, in bytes.
+ * @return the pool (released with free()), or NULL on failure.
+ */
+ScdWords *scdWordsInit(size_t capacity);
+
+/**
+ * Copy the normalized word to the pool (writer only).
+ * @param words the pool, replaced with a larger copy when full. The pool
+ * replaced is retired.
+ * @param epoch the epoch of the data model the readers of the pool are in.
+ * @param word the word, not necessarily null-terminated.
+ * @param len the length of word.
+ * @param maxCapacity the capacity the pool may not grow past.
+ * @return the offset of the word, or -1 on failure (or if the pool would grow
+ * past maxCapacity).
+ */
+int64_t scdWordsAdd(ScdWords **words, SceEpoch *epoch, const char *word,
+                    size_t len, size_t maxCapacity);
+
+/**
+ * Get a word of the pool, from its offset. Safe to call concurrently with the
+ * writer, once the offset was loaded (with acquire semantics).
+ * @param words the pool.
+ * @param offset the offset of the word.
+ * @param len the length of the word, or of the word it is compared with.
+ * @return the word, or NULL if the pool does not hold len bytes at offset (no
+ * word of that length is there).
+ */
+static inline const char *scdWordsGet(ScdWords *const *words, uint32_t offset,
+                                      size_t len)
+{
+    /* Loaded after the offset, so the pool holds the word */
+    const ScdWords *pool = __atomic_load_n(words, __ATOMIC_ACQUIRE);
+    if ((uint64_t)offset + len >=
+        __atomic_load_n(&pool->size, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &pool->data[offset];
+}
+
+#endif
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include "spell-checker_epoch.h"
+
+/*
+ * A retired piece of memory, waiting to be freed.
+ */
+typedef struct SceRetired
+{
+    void *ptr;
+    void (*freeFunc)(void *ptr);
+    void (*freeFuncWith)(void *ptr, void *ctx); /* if freeFunc is NULL */
+    void *ctx;
+    struct SceRetired *next;
+} SceRetired;
+
+static void sceFreeList(SceRetired *list)
+{
+    while (list)
+    {
+        SceRetired *next = list->next;
+        if (list->freeFunc)
+            list->freeFunc(list->ptr);
+        else
+            list->freeFuncWith(list->ptr, list->ctx);
+        free(list);
+        list = next;
+    }
+}
+
+void sceInit(SceEpoch *epoch)
+{
+    epoch->epoch = 0;
+    epoch->readers[0] = 0;
+    epoch->readers[1] = 0;
+    epoch->retired = NULL;
+    epoch->expiring = NULL;
+}
+
+void sceFinalize(SceEpoch *epoch)
+{
+    sceFreeList(epoch->expiring);
+    sceFreeList(epoch->retired);
+    epoch->expiring = NULL;
+    epoch->retired = NULL;
+}
+
+unsigned int sceReadLock(SceEpoch *epoch)
+{
+    for (;;)
+    {
+        const unsigned int token =
+            __atomic_load_n(&epoch->epoch, __ATOMIC_SEQ_CST) & 1;
+        __atomic_add_fetch(&epoch->readers[token], 1, __ATOMIC_SEQ_CST);
+
+        /*
+         * If the epoch was advanced in between, the writer may have already
+         * checked this counter: retry with the new one.
+         */
+        if (token == (__atomic_load_n(&epoch->epoch, __ATOMIC_SEQ_CST) & 1))
+            return token;
+        __atomic_sub_fetch(&epoch->readers[token], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void sceReadUnlock(SceEpoch *epoch, unsigned int token)
+{
+    __atomic_sub_fetch(&epoch->readers[token], 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * The epoch is only advanced once the readers of the previous one are done,
+ * so the readers left are those of the current epoch, and those of the
+ * previous one. Once the latter are done, the memory retired before the epoch
+ * was last advanced cannot be reached anymore.
+ */
+void sceReclaim(SceEpoch *epoch)
+{
+    const unsigned long current = epoch->epoch;
+    if (__atomic_load_n(&epoch->readers[(current + 1) & 1], __ATOMIC_SEQ_CST))
+        return;
+
+    sceFreeList(epoch->expiring);
+    epoch->expiring = NULL;
+
+    if (epoch->retired)
+    {
+        epoch->expiring = epoch->retired;
+        epoch->retired = NULL;
+        __atomic_store_n(&epoch->epoch, current + 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/*
+ * Wait until everything retired so far cannot be reached anymore, and free it.
+ */
+static void sceSynchronize(SceEpoch *epoch)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        const unsigned long current = epoch->epoch;
+        while (__atomic_load_n(&epoch->readers[(current + 1) & 1],
+                               __ATOMIC_SEQ_CST))
+            sched_yield();
+        __atomic_store_n(&epoch->epoch, current + 1, __ATOMIC_SEQ_CST);
+    }
+
+    sceFinalize(epoch);
+}
+
+/*
+ * Queue a piece of memory to be freed once no reader can reach it anymore.
+ */
+static int scePush(SceEpoch *epoch, void *ptr, void (*freeFunc)(void *ptr),
+                   void (*freeFuncWith)(void *ptr, void *ctx), void *ctx)
+{
+    SceRetired *retired = malloc(sizeof(SceRetired));
+    if (!retired)
+    {
+        printf("Failed allocating memory for retired memory\n");
+        sceSynchronize(epoch);
+        if (freeFunc)
+            freeFunc(ptr);
+        else
+            freeFuncWith(ptr, ctx);
+        return -1;
+    }
+
+    retired->ptr = ptr;
+    retired->freeFunc = freeFunc;
+    retired->freeFuncWith = freeFuncWith;
+    retired->ctx = ctx;
+    retired->next = epoch->retired;
+    epoch->retired = retired;
+
+    return 0;
+}
+
+int sceRetire(SceEpoch *epoch, void *ptr, void (*freeFunc)(void *ptr))
+{
+    return scePush(epoch, ptr, freeFunc, NULL, NULL);
+}
+
+int sceRetireWith(SceEpoch *epoch, void *ptr,
+                  void (*freeFunc)(void *ptr, void *ctx), void *ctx)
+{
+    return scePush(epoch, ptr, NULL, freeFunc, ctx);
+}
@@ -0,0 +1,80 @@
+#ifndef __SPELL_CHECKER_EPOCH_H
+#define __SPELL_CHECKER_EPOCH_H
+
+/**
+ * Epoch-based memory reclamation, letting a single writer update a data
+ * structure while any number of readers look it up without taking a lock.
+ *
+ * The writer never modifies memory a reader may be looking at: it builds a
+ * new version (of a node, a table, ...), publishes it with an atomic pointer
+ * store, and retires the old version with sceRetire(). Retired memory is only
+ * freed once every reader that may still hold a pointer to it is done.
+ *
+ * Readers announce themselves in one of two counters, selected by the parity
+ * of the global epoch when they start. The writer advances the epoch, after
+ * which new readers use the other counter; once the counter of the previous
+ * epoch drops to zero, nothing retired before the epoch was advanced can be
+ * reached anymore. The writer never waits for readers: sceReclaim() frees what
+ * it can and returns, and the rest is freed by a later call.
+ */
+
+struct SceRetired;
+
+typedef struct SceEpoch
+{
+    unsigned long epoch;
+    unsigned long readers[2];
+
+    /* Retired since the epoch was last advanced */
+    struct SceRetired *retired;
+
+    /* Retired before the epoch was last advanced, freed once the readers of
+       the previous epoch are done */
+    struct SceRetired *expiring;
+} SceEpoch;
+
+/**
+ * Initialize the epoch.
+ */
+void sceInit(SceEpoch *epoch);
+
+/**
+ * Free everything still retired. There must not be any readers left.
+ */
+void sceFinalize(SceEpoch *epoch);
+
+/**
+ * Enter a read-side critical section. Memory reachable from the data structure
+ * at this point stays valid until sceReadUnlock() is called.
+ * @return a token to pass to sceReadUnlock().
+ */
+unsigned int sceReadLock(SceEpoch *epoch);
+
+/**
+ * Leave a read-side critical section.
+ * @param token the value returned by the matching sceReadLock().
+ */
+void sceReadUnlock(SceEpoch *epoch, unsigned int token);
+
+/**
+ * Retire memory that was unlinked from the data structure (writer only). It is
+ * freed with freeFunc once no reader can reach it anymore.
+ * @return 0 on success, -1 if the memory could not be queued, in which case it
+ * was freed after waiting for the current readers to be done.
+ */
+int sceRetire(SceEpoch *epoch, void *ptr, void (*freeFunc)(void *ptr));
+
+/**
+ * Same as sceRetire(), for memory that is freed with the help of a context
+ * (e.g. the allocator it came from).
+ */
+int sceRetireWith(SceEpoch *epoch, void *ptr,
+                  void (*freeFunc)(void *ptr, void *ctx), void *ctx);
+
+/**
+ * Free the retired memory that no reader can reach anymore (writer only).
+ * Never blocks.
+ */
+void sceReclaim(SceEpoch *epoch);
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "spell-checker_pool.h"
+
+/*
+ * Each worker has its own queue, under its own mutex, so workers running
+ * tasks do not contend on a single lock. A task submitted by a worker goes to
+ * its own queue (it likely works on the same data, which is still in its
+ * cache), the others are spread over the queues in turn. A worker runs the
+ * tasks of its queue in FIFO order, and once it is empty, steals the oldest
+ * task of the other queues.
+ *
+ * Workers only sleep when no queue has any task: numTasks counts the tasks
+ * queued, and submitters only take the pool's mutex to wake up a sleeping
+ * worker.
+ */
+typedef struct ScpWorker
+{
+    pthread_mutex_t mutex;
+    ScpTask *head; /* peeked at without the mutex by the other workers */
+    ScpTask *tail;
+
+    SpellCheckerPoolHandle pool;
+    unsigned int index;
+    pthread_t thread;
+} ScpWorker;
+
+struct _SpellCheckerPool
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    size_t numTasks;
+    unsigned int numSleeping;
+    unsigned int nextWorker; /* for the tasks not submitted by a worker */
+
+    int isRunning;
+
+    unsigned int numThreads;
+    ScpWorker workers[];
+};
+
+/*
+ * The worker the calling thread is, NULL if none. A single key for all the
+ * pools, as there can only be so many keys.
+ */
+static pthread_key_t scpWorkerKey;
+static pthread_once_t scpWorkerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void scpCreateWorkerKey(void)
+{
+    if (0 != pthread_key_create(&scpWorkerKey, NULL))
+        printf("Failed creating the worker key\n");
+}
+
+static void scpPush(ScpWorker *worker, ScpTask *task)
+{
+    task->next = NULL;
+
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->tail)
+        worker->tail->next = task;
+    else
+        __atomic_store_n(&worker->head, task, __ATOMIC_RELAXED);
+    worker->tail = task;
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+static ScpTask *scpPop(ScpWorker *worker)
+{
+    /* Most queues are empty most of the time, don't lock those */
+    if (!__atomic_load_n(&worker->head, __ATOMIC_RELAXED))
+        return NULL;
+
+    pthread_mutex_lock(&worker->mutex);
+    ScpTask *task = worker->head;
+    if (task)
+    {
+        __atomic_store_n(&worker->head, task->next, __ATOMIC_RELAXED);
+        if (!task->next)
+            worker->tail = NULL;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    return task;
+}
+
+/*
+ * Take the next task of the worker's queue, or steal one from the others.
+ */
+static ScpTask *scpNextTask(ScpWorker *worker)
+{
+    SpellCheckerPoolHandle pool = worker->pool;
+    for (unsigned int i = 0; i < pool->numThreads; ++i)
+    {
+        ScpTask *task =
+            scpPop(&pool->workers[(worker->index + i) % pool->numThreads]);
+        if (task)
+        {
+            __atomic_sub_fetch(&pool->numTasks, 1, __ATOMIC_SEQ_CST);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void * scpWorkerMain(void *arg)
+{
+    ScpWorker *worker = (ScpWorker*) arg;
+    SpellCheckerPoolHandle pool = worker->pool;
+
+    pthread_setspecific(scpWorkerKey, worker);
+
+    for (;;)
+    {
+        ScpTask *task = scpNextTask(worker);
+        if (task)
+        {
+            task->func(task);
+            continue;
+        }
+
+        /* A task submitted meanwhile is either seen here, or wakes us up */
+        pthread_mutex_lock(&pool->mutex);
+        __atomic_add_fetch(&pool->numSleeping, 1, __ATOMIC_SEQ_CST);
+        while (!__atomic_load_n(&pool->numTasks, __ATOMIC_SEQ_CST) &&
+               pool->isRunning)
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        __atomic_sub_fetch(&pool->numSleeping, 1, __ATOMIC_SEQ_CST);
+        const int isDone = !pool->isRunning &&
+            !__atomic_load_n(&pool->numTasks, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (isDone)
+            break;
+    }
+
+    return NULL;
+}
+
+SpellCheckerPoolHandle scpInit(unsigned int numThreads)
+{
+    if (!numThreads)
+    {
+        printf("A pool needs at least one thread\n");
+        return NULL;
+    }
+
+    pthread_once(&scpWorkerKeyOnce, scpCreateWorkerKey);
+
+    SpellCheckerPoolHandle pool = malloc(sizeof(struct _SpellCheckerPool) +
+                                         numThreads * sizeof(ScpWorker));
+    if (!pool)
+    {
+        printf("Failed allocating memory for SpellCheckerPoolHandle\n");
+        return NULL;
+    }
+
+    pool->numTasks = 0;
+    pool->numSleeping = 0;
+    pool->nextWorker = 0;
+    pool->isRunning = 1;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    /* Tasks can be queued for all the workers before they all started */
+    pool->numThreads = numThreads;
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        ScpWorker *worker = &pool->workers[i];
+        pthread_mutex_init(&worker->mutex, NULL);
+        worker->head = NULL;
+        worker->tail = NULL;
+        worker->pool = pool;
+        worker->index = i;
+    }
+
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        if (0 != pthread_create(&pool->workers[i].thread, NULL, scpWorkerMain,
+                                &pool->workers[i]))
+        {
+            printf("Failed creating worker thread\n");
+            pool->numThreads = i;
+            scpFinalize(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void scpFinalize(SpellCheckerPoolHandle pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->isRunning = 0;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (unsigned int i = 0; i < pool->numThreads; ++i)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].mutex);
+    }
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+unsigned int scpNumThreads(SpellCheckerPoolHandle pool)
+{
+    return pool->numThreads;
+}
+
+void scpSubmit(SpellCheckerPoolHandle pool, ScpTask *task)
+{
+    ScpWorker *worker = pthread_getspecific(scpWorkerKey);
+    if (!worker || (worker->pool != pool))
+    {
+        const unsigned int next =
+            __atomic_fetch_add(&pool->nextWorker, 1, __ATOMIC_RELAXED);
+        worker = &pool->workers[next % pool->numThreads];
+    }
+    scpPush(worker, task);
+
+    /* Pairs with the sleeping workers (see scpWorkerMain()) */
+    __atomic_add_fetch(&pool->numTasks, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->numSleeping, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __SPELL_CHECKER_POOL_H
+#define __SPELL_CHECKER_POOL_H
+
+/**
+ * A fixed-size pool of worker threads. Each worker runs the tasks of its own
+ * queue in FIFO order, and steals from the other queues once its own is empty,
+ * so tasks start roughly in the order they were submitted. A task submitted
+ * from a worker is queued for that worker.
+ *
+ * Tasks are intrusive: the caller embeds an ScpTask in its own structure, so
+ * submitting a task does not allocate. The pool does not track completion,
+ * the task's function is expected to signal it in whatever way its submitter
+ * waits on.
+ */
+
+struct ScpTask;
+typedef void (*ScpTaskFunc)(struct ScpTask *task);
+
+typedef struct ScpTask
+{
+    ScpTaskFunc func;
+    struct ScpTask *next;
+} ScpTask;
+
+struct _SpellCheckerPool;
+typedef struct _SpellCheckerPool *SpellCheckerPoolHandle;
+
+/**
+ * Initialize the pool.
+ * @param numThreads the number of worker threads to create.
+ * @return a handle to the pool, or NULL on failure.
+ */
+SpellCheckerPoolHandle scpInit(unsigned int numThreads);
+
+/**
+ * Finalize the pool: run the tasks still queued, then stop the worker
+ * threads.
+ */
+void scpFinalize(SpellCheckerPoolHandle pool);
+
+/**
+ * @return the number of worker threads in the pool.
+ */
+unsigned int scpNumThreads(SpellCheckerPoolHandle pool);
+
+/**
+ * Queue a task to be run by one of the worker threads.
+ * @param pool the pool to use.
+ * @param task the task. It must stay valid until its function is called.
+ */
+void scpSubmit(SpellCheckerPoolHandle pool, ScpTask *task);
+
+#endif
@@ -1,10 +1,24 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "spell-checker_runner.h"
 #include "spell-checker_data.h"
+#include "spell-checker_data_cache.h"
+#include "spell-checker_epoch.h"
+#include "spell-checker_pool.h"
+#include "spell-checker_tokenizer.h"
 
 /**
  * This runner implements a simple message-queue for a simpler handling of async
@@ -14,269 +28,2157 @@
  * (of tasks). Once a new message is on the queue, a condition is used to signal
  * about the new task, making the runner wake up and handle it in its own
  * context.
+ *
+ * Large texts can be spell-checked in parallel (see scrSetParallelism()): the
+ * text is split into chunks on word boundaries, the chunks are checked by a
+ * pool of worker threads, and the runner's thread reports the misspellings of
+ * each chunk, in order, as soon as the chunk is done. Adds are never processed
+ * during a check, so the workers only ever read the data model.
+ *
+ * The queue is a fixed-size ring, so posting a message does not lock (see
+ * ScrSlot), and a burst of posts cannot grow it without bounds: once it is
+ * full, posting blocks, fails or drops the message, depending on the runner's
+ * policy. The mutex is only taken to sleep and to wake up (the runner when the
+ * queue runs empty, producers when it is full). The arguments of most messages
+ * (a word to add, a short text) are copied into the slot itself, so posting
+ * them does not allocate either.
+ *
+ * The runner's thread is the only writer of the data model, and processes a
+ * message without holding any lock, so posting never waits for a running task
+ * (unless the queue is full). Lookups (scrHasWord()) are made directly from
+ * the caller's thread, concurrently with the runner, without locking. Words
+ * that are added become visible to them once the runner is done with the
+ * message adding them and has committed it, which it does whenever its queue
+ * runs empty (and before each spell-check). The memory the writer replaces is
+ * reclaimed after each message.
+ *
+ * Instead of its own thread, a runner can run on an executor, a pool of worker
+ * threads shared by many runners (see scrInit()): posting a message to an
+ * idle runner queues the runner as a task of the pool, and the worker that
+ * takes it processes up to SCR_MSGS_PER_RUN messages, then queues the runner
+ * again if it has more, so the runners sharing the pool take turns. A runner
+ * is queued at most once, so only one worker at a time processes its
+ * messages, in order, exactly as its own thread would.
+ *
+ * The whole data model can be replaced by the one of another runner (see
+ * scrSwap()), which was built on that runner's thread, without blocking the
+ * lookups: the runner publishes the new data model with a single pointer
+ * store, and retires the previous one, as it does with nodes. Readers load the
+ * pointer inside a read-side critical section of the runner's own epoch, so
+ * the previous data model is finalized once the lookups started before are
+ * done.
+ *
+ * A spell-check posted with scrStartSpellCheck() is tracked by a job: the
+ * runner moves it from pending to running to done (or cancelled), and the
+ * callers waiting on it are woken up once all its callbacks have returned.
+ * A job is reference counted, by its caller and by the runner, so either can
+ * be done with it first.
  */
 
 typedef enum ScrMsgType { SCR_MSG_ADD,
+                          SCR_MSG_ADD_FREQUENCY,
+                          SCR_MSG_ADD_WORDS,
+                          SCR_MSG_REMOVE,
+                          SCR_MSG_SWAP,
                           SCR_MSG_SPELL_CHECK,
+                          SCR_MSG_COMPILE,
+                          SCR_MSG_SET_PARALLELISM,
                           SCR_MSG_FINALIZE } ScrMsgType;
 
 /*
- * The message queue is a linked-list of messages.
+ * The message queue is a bounded ring of slots, allocated once with the runner
+ * (Dmitry Vyukov's bounded MPMC queue, with the runner as the only consumer).
+ * A slot's sequence tells who owns it: it is free for the producer posting at
+ * position pos when it equals pos, and holds the message for the runner to
+ * read at position pos when it equals pos + 1. Producers claim a position by
+ * advancing enqueuePos with a CAS, so posting never takes a lock unless the
+ * runner is asleep (to wake it up) or the queue is full (to wait for room).
+ *
+ * The arg of a message is copied into its slot if it fits in
+ * SCR_SLOT_PAYLOAD bytes (a slot then takes a cache line), and into a heap
+ * block otherwise.
+ */
+#define SCR_SLOT_PAYLOAD 48
+
+typedef struct ScrSlot
+{
+    size_t sequence;
+    ScrMsgType type;
+    int isInline; /* the arg is in payload.bytes, not at payload.arg */
+    union
+    {
+        void *arg;
+        char bytes[SCR_SLOT_PAYLOAD];
+    } payload;
+} ScrSlot;
+
+/*
+ * A message being posted. Its arg is made of a header (a struct), followed by
+ * data (a word, a text) and a null character, if any.
  */
 typedef struct ScrMsg
 {
     ScrMsgType type;
-    void *arg;
-    struct ScrMsg *next;
+    const void *header;
+    size_t headerSize;
+    const char *data; /* NULL if none */
+    size_t dataSize;
 } ScrMsg;
 
 /*
  * The spell-check message has a more complicated arg element, so hold it in a
- * struct.
+ * struct, followed by a copy of the text (unless it is checked in place).
  */
 typedef struct ScrSpellCheckArg
 {
+    size_t len;
+
+    /*
+     * The caller's text when checked in place (read-only, see
+     * scrCheckFile()), NULL for the copy, until the runner points it there
+     */
     char *text;
+
+    /* Either callback (spellCheck()) or spanCallback (with a job) is set */
     SpellCheckerCallback callback;
+    SpellCheckerSpanCallback spanCallback;
+    SpellCheckerJobHandle job;
+
+    char copy[];
 } ScrSpellCheckArg;
 
-struct _SpellCheckerRunner
+struct _SpellCheckerJob
 {
-    pthread_t thread;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
 
-    ScrMsg *csrMsgHead;
-    ScrMsg *csrMsgTail;
+    SpellCheckerJobStatus status;
 
-    SpellCheckerDataHandle data;
+    /* Set once the runner (or a cancel, before the runner) took the job */
+    int isClaimed;
+    int isCancelRequested;
 
-    int isRunning;
+    int refCount;
+
+    SpellCheckerJobCallback onComplete;
+    void *userdata;
 };
 
-static ScrMsg* createScrMsg(ScrMsgType type, void *arg)
+/*
+ * Number of words checked between two looks at the job's cancel flag.
+ */
+#define SCR_WORDS_PER_CANCEL_CHECK 256
+
+/*
+ * Number of words looked up by scrCheckSpan() before leaving the read-side
+ * critical section, so memory retired by the runner meanwhile can be freed.
+ */
+#define SCR_SPAN_WORDS_PER_READ_LOCK 4096
+
+/*
+ * Number of messages a worker of an executor processes for a runner before
+ * letting the other runners run.
+ */
+#define SCR_MSGS_PER_RUN 64
+
+/*
+ * A text is only split if each chunk gets at least this many bytes.
+ */
+#define SCR_MIN_CHUNK_SIZE (64 * 1024)
+
+/*
+ * Number of chunks per worker thread, so that workers that are done early can
+ * pick up more chunks.
+ */
+#define SCR_CHUNKS_PER_THREAD 4
+
+typedef struct ScrMisspelling
 {
-    ScrMsg *msg = malloc(sizeof(ScrMsg));
-    if (msg)
-    {
-        msg->type = type;
-        msg->arg = arg;
-        msg->next = NULL;
-    }
-    else
-    {
-        printf("Failed allocating memory for ScrMsg\n");
-    }
+    size_t offset;
+    size_t len;
+} ScrMisspelling;
 
-    return msg;
-}
+/*
+ * A parallel spell-check: the chunks of text, and the condition used by the
+ * workers to signal the runner that a chunk is done.
+ */
+typedef struct ScrParallelCheck
+{
+    SpellCheckerRunnerHandle runner;
+    const char *text;
+    SpellCheckerJobHandle job;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} ScrParallelCheck;
 
-static int scrDoSpellCheck(SpellCheckerDataHandle data, void *arg)
+typedef struct ScrChunk
 {
-    ScrSpellCheckArg *msg = (ScrSpellCheckArg*) arg;
+    ScpTask task;
+    ScrParallelCheck *check;
+    size_t begin;
+    size_t end;
+    ScrMisspelling *misspellings;
+    size_t numMisspellings;
+    size_t capacity;
+    int failed;
+    int done;
+} ScrChunk;
 
-    char *text = msg->text;
+/*
+ * The add-words message carries a copy of the caller's buffer of words.
+ */
+typedef struct ScrAddWordsArg
+{
+    size_t len;
+    char buf[];
+} ScrAddWordsArg;
 
-    char *word = strtok(text, " ,.-/';:()[]{}\n\"");
-    while (word)
-    {
-        if (!scdHasWord(data, word))
-            msg->callback(word);
+typedef struct ScrAddFrequencyArg
+{
+    unsigned int frequency;
+    char word[];
+} ScrAddFrequencyArg;
 
-        word = strtok(NULL, " ,.-/';:()[]{}\n\"");
-    }
+/*
+ * The compile message is synchronous: its arg is a pointer to the stack of the
+ * caller, which waits for done to be set.
+ */
+typedef struct ScrCompileArg
+{
+    const char *path;
+    int result;
+    int done;
+} ScrCompileArg;
 
-    free(msg->text);
+/*
+ * The swap message is synchronous as well (see scrSwap()).
+ */
+typedef struct ScrSwapArg
+{
+    SpellCheckerDataHandle data;
+    int done;
+} ScrSwapArg;
 
-    return 0;
-}
+/*
+ * A read-side critical section over the runner's data model: a token of the
+ * runner's epoch, which keeps the data model from being finalized by a swap,
+ * and one of the data model's, which keeps its memory from being reclaimed.
+ */
+typedef struct ScrReadToken
+{
+    unsigned int swap;
+    unsigned int data;
+} ScrReadToken;
 
-static void * thread_runner(void *arg)
+/*
+ * The state of a thread checking words with a runner: its lookup cache and its
+ * counters, created on the first check the thread makes, and freed when it
+ * exits. The runner keeps a list of them to sum their counters. Only the
+ * thread updates its counters (with relaxed atomic stores, once per text), so
+ * counting does not share any cache line between threads.
+ */
+typedef struct ScrThread
 {
-    SpellCheckerRunnerHandle runner = (SpellCheckerRunnerHandle) arg;
-    int handled = 1;
-    while (handled && runner->isRunning)
-    {
-        pthread_mutex_lock(&runner->mutex);
+    ScdCache *cache; /* NULL if caches are disabled */
+    uint64_t numTokens;
+    uint64_t numMisspellings;
 
-        while (!runner->csrMsgHead)
-            pthread_cond_wait(&runner->cond, &runner->mutex);
-        switch(runner->csrMsgHead->type)
-        {
-        case SCR_MSG_ADD:
-            scdAddWord(runner->data, (const char*)runner->csrMsgHead->arg);
-            free(runner->csrMsgHead->arg);
-            break;
-        case SCR_MSG_SPELL_CHECK:
-            scrDoSpellCheck(runner->data, runner->csrMsgHead->arg);
-            free(runner->csrMsgHead->arg);
-            break;
-        case SCR_MSG_FINALIZE:
-            runner->isRunning = 0;
-            break;
-        default:
-            printf("Internal error: unrecognized message type (%d)!\n",
-                   runner->csrMsgHead->type);
-            handled = 0;
-        }
+    /* NULL once detached from the runner, see scrDetachThread() */
+    SpellCheckerRunnerHandle runner;
+    struct ScrThread *prev; /* in the runner's list, under scrThreadsMutex */
+    struct ScrThread *next;
 
-        if (handled)
-        {
-            ScrMsg *next = runner->csrMsgHead->next;
-            free(runner->csrMsgHead);
-            runner->csrMsgHead = next;
-        }
+    struct ScrThread *nextInMap; /* in its thread's map, only used by it */
+} ScrThread;
 
-        pthread_mutex_unlock(&runner->mutex);
-    }
+/*
+ * The states of a thread, one per runner it checked words with, hashed by
+ * runner. Owned by the thread: a runner that is released only detaches its
+ * states, which the thread frees once it comes across them.
+ */
+typedef struct ScrThreadMap
+{
+    size_t numBuckets; /* always a power of 2 */
+    size_t size;
+    ScrThread **buckets;
+} ScrThreadMap;
 
-    return NULL;
+#define SCR_THREAD_MAP_INITIAL_BUCKETS 8
+
+struct _SpellCheckerRunner
+{
+    /* The task running the runner on its executor, see scrRun() */
+    ScpTask task;
+
+    /* The executor the runner runs on, NULL if it has its own thread */
+    SpellCheckerPoolHandle executor;
+    int isScheduled; /* the task is queued or running */
+    int isStopped;   /* the task is done with the finalize message */
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* a message was posted while isSleeping */
+    pthread_cond_t notFullCond; /* a slot was freed while numBlocked */
+    pthread_cond_t doneCond;    /* a synchronous message is done */
+
+    int isSleeping;
+    int numBlocked;
+
+    SpellCheckerQueuePolicy policy;
+    size_t mask; /* the number of slots, minus 1 */
+    size_t enqueuePos;
+    size_t dequeuePos; /* only written by the runner's thread */
+    ScrSlot *slots;
+
+    /*
+     * Replaced by the runner's thread on a swap (with an atomic store), and
+     * loaded by the readers inside a read-side critical section of epoch
+     */
+    SpellCheckerDataHandle data;
+    SceEpoch epoch;
+
+    /* Worker threads for parallel spell-checks, NULL if disabled */
+    SpellCheckerPoolHandle pool;
+
+    /* Per-thread state, with caches of cacheSize bytes each (0 if none) */
+    size_t cacheSize;
+    /* Under scrThreadsMutex, as the counters of the states detached */
+    ScrThread *threads;
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    uint64_t numTokens;
+    uint64_t numMisspellings;
+
+    /*
+     * Written by the runner's thread only, read with relaxed atomic loads by
+     * scrGetStats()
+     */
+    uint64_t numMessages;
+    uint64_t busyNs;
+    size_t maxQueueDepth;
+    ScdStats dataStats;
+
+    int isRunning;
+};
+
+static inline size_t scrMsgSize(const ScrMsg *msg)
+{
+    return msg->headerSize + (msg->data ? msg->dataSize + 1 : 0);
 }
 
-static void csrPushMsg(SpellCheckerRunnerHandle runner, ScrMsgType type,
-                       void *arg)
+/*
+ * Copy the arg of a message to dst, which has room for scrMsgSize() bytes.
+ */
+static void scrMsgCopy(const ScrMsg *msg, char *dst)
 {
-    pthread_mutex_lock(&runner->mutex);
-    if (!runner->csrMsgHead)
+    if (msg->headerSize)
+        memcpy(dst, msg->header, msg->headerSize);
+    if (msg->data)
     {
-        runner->csrMsgTail = runner->csrMsgHead = createScrMsg(type, arg);
+        if (msg->dataSize)
+            memcpy(dst + msg->headerSize, msg->data, msg->dataSize);
+        dst[msg->headerSize + msg->dataSize] = '\0';
     }
-    else
+}
+
+/*
+ * Post a message if there is room for it in the queue, without blocking.
+ * @param block a copy of the arg of the message, or NULL to copy it into the
+ * slot.
+ * @return 0 on success, -1 if the queue is full.
+ */
+static int scrTryEnqueue(SpellCheckerRunnerHandle runner, const ScrMsg *msg,
+                         void *block)
+{
+    size_t pos = __atomic_load_n(&runner->enqueuePos, __ATOMIC_RELAXED);
+    for (;;)
     {
-        if (!runner->csrMsgTail->next)
+        ScrSlot *slot = &runner->slots[pos & runner->mask];
+        const size_t sequence =
+            __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (0 == diff)
+        {
+            /* On failure, pos is updated to the current position */
+            if (__atomic_compare_exchange_n(&runner->enqueuePos, &pos, pos + 1,
+                                            1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+            {
+                slot->type = msg->type;
+                slot->isInline = !block;
+                if (block)
+                    slot->payload.arg = block;
+                else
+                    scrMsgCopy(msg, slot->payload.bytes);
+                __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        }
+        else if (diff < 0)
         {
-            runner->csrMsgTail->next = createScrMsg(type, arg);
-            runner->csrMsgTail = runner->csrMsgTail->next;
+            /* The runner did not read the message of the previous lap yet */
+            return -1;
         }
         else
         {
-            printf("Something's wrong...\n");
+            pos = __atomic_load_n(&runner->enqueuePos, __ATOMIC_RELAXED);
         }
     }
-    pthread_cond_broadcast(&runner->cond);
-    pthread_mutex_unlock(&runner->mutex);
 }
 
-SpellCheckerRunnerHandle scrInit(void)
+/*
+ * Take the next message from the queue (runner's thread only). The slot is
+ * copied, so it can be reused right away.
+ * @param msg set to the message. Its arg is in msg->payload.bytes or pointed
+ * to by msg->payload.arg, see scrMsgArg().
+ * @return 0 on success, -1 if the queue is empty.
+ */
+static int scrTryDequeue(SpellCheckerRunnerHandle runner, ScrSlot *msg)
 {
-    SpellCheckerRunnerHandle runner =
-        malloc(sizeof(struct _SpellCheckerRunner));
-    if (!runner)
-    {
-        printf("Failed allocating memory for SpellCheckerRunnerHandle\n");
-        return NULL;
-    }
+    const size_t pos = runner->dequeuePos;
+    ScrSlot *slot = &runner->slots[pos & runner->mask];
+    if (pos + 1 != __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE))
+        return -1;
 
-    runner->data = scdInit();
-    if (!runner->data)
-    {
-        printf("Failed initializing data model\n");
-        free (runner);
-        return NULL;
-    }
+    /* The messages waiting, this one included */
+    const size_t depth =
+        __atomic_load_n(&runner->enqueuePos, __ATOMIC_RELAXED) - pos;
+    if (depth > runner->maxQueueDepth)
+        __atomic_store_n(&runner->maxQueueDepth, depth, __ATOMIC_RELAXED);
 
-    runner->isRunning = 1;
+    msg->type = slot->type;
+    msg->isInline = slot->isInline;
+    memcpy(&msg->payload, &slot->payload, sizeof(msg->payload));
+    __atomic_store_n(&slot->sequence, pos + runner->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&runner->dequeuePos, pos + 1, __ATOMIC_RELAXED);
 
-    pthread_mutex_init(&runner->mutex, NULL);
-    pthread_cond_init(&runner->cond, NULL);
-    pthread_create(&runner->thread, NULL, thread_runner, runner);
+    return 0;
+}
 
-    runner->csrMsgHead = NULL;
-    runner->csrMsgTail = NULL;
+static inline uint64_t scrNowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
 
-    return runner;
+/*
+ * The runner the calling thread is processing the messages of, NULL if none:
+ * its own thread, or the worker of its executor running it.
+ */
+static pthread_key_t scrRunnerKey;
+static pthread_once_t scrRunnerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void scrCreateRunnerKey(void)
+{
+    if (0 != pthread_key_create(&scrRunnerKey, NULL))
+        printf("Failed creating the runner key\n");
 }
 
-int scrFinalize(SpellCheckerRunnerHandle runner)
+/*
+ * @return whether the calling thread is the one processing the runner's
+ * messages (i.e. a callback).
+ */
+static int scrOnRunnerThread(SpellCheckerRunnerHandle runner)
 {
-    if (!runner)
+    return runner == pthread_getspecific(scrRunnerKey);
+}
+
+/*
+ * Account for the time the runner's thread spent working since start, and
+ * refresh the size of the data model, which the work may have changed.
+ */
+static void scrUpdateStats(SpellCheckerRunnerHandle runner, uint64_t start)
+{
+    ScdStats stats;
+    if (0 == scdGetStats(runner->data, &stats))
     {
-        printf("NULL runner pointer\n");
-        return -1;
+        __atomic_store_n(&runner->dataStats.numWords, stats.numWords,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&runner->dataStats.numNodes, stats.numNodes,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&runner->dataStats.bytes, stats.bytes,
+                         __ATOMIC_RELAXED);
     }
+    __atomic_store_n(&runner->busyNs, runner->busyNs + scrNowNs() - start,
+                     __ATOMIC_RELAXED);
+}
 
-    if (!runner->isRunning)
+/*
+ * The queue ran empty: publish the words added so far to the readers.
+ */
+static void scrIdle(SpellCheckerRunnerHandle runner)
+{
+    const uint64_t start = scrNowNs();
+    scdCommit(runner->data);
+    scdReclaim(runner->data);
+    sceReclaim(&runner->epoch);
+    scrUpdateStats(runner, start);
+}
+
+/*
+ * Wake up the producers waiting for room (see csrPushMsg()), after a message
+ * was taken from the queue.
+ */
+static void scrNotifyNotFull(SpellCheckerRunnerHandle runner)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&runner->numBlocked, __ATOMIC_RELAXED))
     {
-        printf("Nothing to see here... Carry on.\n");
-        return 0;
+        pthread_mutex_lock(&runner->mutex);
+        pthread_cond_broadcast(&runner->notFullCond);
+        pthread_mutex_unlock(&runner->mutex);
     }
+}
 
-    csrPushMsg(runner, SCR_MSG_FINALIZE, NULL);
-
-    pthread_join(runner->thread, NULL);
+/*
+ * Wait for the next message (runner's own thread). Before going to sleep, the
+ * runner publishes the words added so far to the readers, and flags itself as
+ * sleeping, so the producers know they have to wake it up.
+ */
+static void scrWaitMsg(SpellCheckerRunnerHandle runner, ScrSlot *msg)
+{
+    if (-1 == scrTryDequeue(runner, msg))
+    {
+        scrIdle(runner);
 
-    scdFinalize(runner->data);
+        pthread_mutex_lock(&runner->mutex);
+        __atomic_store_n(&runner->isSleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while (-1 == scrTryDequeue(runner, msg))
+            pthread_cond_wait(&runner->cond, &runner->mutex);
+        __atomic_store_n(&runner->isSleeping, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&runner->mutex);
+    }
 
-    free(runner);
+    scrNotifyNotFull(runner);
+}
 
-    return 0;
+static int scrIsCancelRequested(SpellCheckerJobHandle job)
+{
+    return job && __atomic_load_n(&job->isCancelRequested, __ATOMIC_RELAXED);
 }
 
-int scrAddWord(SpellCheckerRunnerHandle runner, const char *word)
+/*
+ * Report a misspelled word to the caller.
+ */
+static void scrReport(ScrSpellCheckArg *msg, size_t offset, size_t len)
 {
-    if (!runner || !word)
+    if (msg->callback)
     {
-        printf("Illegal argument(s) passed to scrAddWord\n");
-        return -1;
+        /*
+         * The word is followed by a delimiter (or the end of the text), which
+         * may be the first byte of a UTF-8 character, still to be decoded
+         */
+        const char delimiter = msg->text[offset + len];
+        msg->text[offset + len] = '\0';
+        msg->callback(&msg->text[offset]);
+        msg->text[offset + len] = delimiter;
     }
-
-    if (!runner->isRunning)
+    else
     {
-        printf("Runner is not running. Free and call init again to get a valid"
-               "one\n");
-        return 0;
+        msg->spanCallback(&msg->text[offset], len, offset, msg->job->userdata);
     }
+}
+
+/*
+ * The map of states of the calling thread, NULL if it has none yet. A single
+ * key for all the runners, as there can only be so many keys.
+ */
+static pthread_key_t scrThreadKey;
+static pthread_once_t scrThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+/*
+ * Guards the lists of states of all the runners, and what the states are
+ * attached to: a thread may exit, and free its states, while the runner of one
+ * of them is being released.
+ */
+static pthread_mutex_t scrThreadsMutex = PTHREAD_MUTEX_INITIALIZER;
 
-    char *arg = malloc(strlen(word)+1);
-    if (!arg)
+/*
+ * Add the counters of a state to its runner's, and unlink it from the runner
+ * (with scrThreadsMutex held). The state stays in its thread's map, until the
+ * thread frees it.
+ */
+static void scrDetachThread(ScrThread *thread)
+{
+    SpellCheckerRunnerHandle runner = thread->runner;
+    if (thread->cache)
     {
-        printf("Failed allocating memory for word\n");
-        return -1;
+        uint64_t hits;
+        uint64_t misses;
+        scdCacheGetStats(thread->cache, &hits, &misses);
+        runner->cacheHits += hits;
+        runner->cacheMisses += misses;
+        scdCacheFinalize(thread->cache);
+        thread->cache = NULL;
     }
+    runner->numTokens += thread->numTokens;
+    runner->numMisspellings += thread->numMisspellings;
 
-    strcpy(arg, word);
-
-    csrPushMsg(runner, SCR_MSG_ADD, arg);
+    if (thread->prev)
+        thread->prev->next = thread->next;
+    else
+        runner->threads = thread->next;
+    if (thread->next)
+        thread->next->prev = thread->prev;
 
-    return 0;
+    /* Last, the thread may free the state once it sees it detached */
+    __atomic_store_n(&thread->runner, NULL, __ATOMIC_RELEASE);
 }
 
-int scrRunSpellCheck(SpellCheckerRunnerHandle runner, const char *text,
-                     SpellCheckerCallback callback)
+/*
+ * Called when a thread that checked words exits.
+ */
+static void scrThreadDestructor(void *arg)
 {
-    if (!runner || !text || !callback)
-    {
-        printf("Illegal argument(s) passed to scrRunSpellCheck\n");
-        return -1;
-    }
+    ScrThreadMap *map = arg;
 
-    if (!runner->isRunning)
+    pthread_mutex_lock(&scrThreadsMutex);
+    for (size_t i = 0; i < map->numBuckets; ++i)
     {
-        printf("Runner is not running. Free and call init again to get a valid"
-               "one\n");
-        return 0;
+        ScrThread *thread = map->buckets[i];
+        while (thread)
+        {
+            ScrThread *next = thread->nextInMap;
+            if (thread->runner)
+                scrDetachThread(thread);
+            free(thread);
+            thread = next;
+        }
     }
+    pthread_mutex_unlock(&scrThreadsMutex);
+
+    free(map->buckets);
+    free(map);
+}
+
+static void scrCreateThreadKey(void)
+{
+    if (0 != pthread_key_create(&scrThreadKey, scrThreadDestructor))
+        printf("Failed creating the thread state key\n");
+}
 
-    char *copiedText = malloc(strlen(text)+1);
-    if (!copiedText)
+static inline size_t scrThreadBucket(const ScrThreadMap *map,
+                                     SpellCheckerRunnerHandle runner)
+{
+    const uint64_t hash =
+        (uint64_t)(uintptr_t)runner * 0x9e3779b97f4a7c15ULL;
+    return (size_t)(hash >> 32) & (map->numBuckets - 1);
+}
+
+static ScrThreadMap *scrNewThreadMap(void)
+{
+    ScrThreadMap *map = malloc(sizeof(ScrThreadMap));
+    if (!map)
+        return NULL;
+
+    map->numBuckets = SCR_THREAD_MAP_INITIAL_BUCKETS;
+    map->size = 0;
+    map->buckets = calloc(map->numBuckets, sizeof(ScrThread*));
+    if (!map->buckets)
     {
-        printf("Failed allocating memory for text\n");
-        return -1;
+        free(map);
+        return NULL;
     }
+    return map;
+}
 
-    strcpy(copiedText, text);
+/*
+ * Move the states of the map to twice as many buckets, freeing the detached
+ * ones on the way. On failure, the map is left as is.
+ */
+static void scrGrowThreadMap(ScrThreadMap *map)
+{
+    const size_t numBuckets = map->numBuckets * 2;
+    ScrThread **buckets = calloc(numBuckets, sizeof(ScrThread*));
+    if (!buckets)
+        return;
 
-    ScrSpellCheckArg *msgArg = malloc(sizeof(ScrSpellCheckArg));
-    if (!msgArg)
+    ScrThreadMap grown = { numBuckets, 0, buckets };
+    for (size_t i = 0; i < map->numBuckets; ++i)
     {
-        printf("Failed allocating memory for spell-check message\n");
-        free(copiedText);
-        return -1;
+        ScrThread *thread = map->buckets[i];
+        while (thread)
+        {
+            ScrThread *next = thread->nextInMap;
+            SpellCheckerRunnerHandle runner =
+                __atomic_load_n(&thread->runner, __ATOMIC_ACQUIRE);
+            if (runner)
+            {
+                const size_t bucket = scrThreadBucket(&grown, runner);
+                thread->nextInMap = buckets[bucket];
+                buckets[bucket] = thread;
+                ++grown.size;
+            }
+            else
+            {
+                free(thread);
+            }
+            thread = next;
+        }
     }
 
-    msgArg->text = copiedText;
-    msgArg->callback = callback;
-    csrPushMsg(runner, SCR_MSG_SPELL_CHECK, msgArg);
+    free(map->buckets);
+    *map = grown;
+}
+
+/*
+ * @return the calling thread's state, NULL on failure (checks then skip the
+ * cache, and are not counted).
+ */
+static ScrThread *scrGetThread(SpellCheckerRunnerHandle runner)
+{
+    ScrThreadMap *map = pthread_getspecific(scrThreadKey);
+    if (map)
+    {
+        /* Free the detached states on the way */
+        ScrThread **link = &map->buckets[scrThreadBucket(map, runner)];
+        while (*link)
+        {
+            ScrThread *thread = *link;
+            SpellCheckerRunnerHandle owner =
+                __atomic_load_n(&thread->runner, __ATOMIC_ACQUIRE);
+            if (owner == runner)
+                return thread;
 
-    return 0;
+            if (owner)
+            {
+                link = &thread->nextInMap;
+                continue;
+            }
+            *link = thread->nextInMap;
+            free(thread);
+            --map->size;
+        }
+    }
+    else
+    {
+        map = scrNewThreadMap();
+        if (!map)
+            return NULL;
+        if (0 != pthread_setspecific(scrThreadKey, map))
+        {
+            free(map->buckets);
+            free(map);
+            return NULL;
+        }
+    }
+
+    ScrThread *thread = calloc(1, sizeof(ScrThread));
+    if (!thread)
+        return NULL;
+    if (runner->cacheSize)
+    {
+        thread->cache = scdCacheInit(runner->cacheSize);
+        if (!thread->cache)
+        {
+            free(thread);
+            return NULL;
+        }
+    }
+    thread->runner = runner;
+
+    pthread_mutex_lock(&scrThreadsMutex);
+    thread->next = runner->threads;
+    if (thread->next)
+        thread->next->prev = thread;
+    runner->threads = thread;
+    pthread_mutex_unlock(&scrThreadsMutex);
+
+    if (map->size >= 2 * map->numBuckets)
+        scrGrowThreadMap(map);
+    const size_t bucket = scrThreadBucket(map, runner);
+    thread->nextInMap = map->buckets[bucket];
+    map->buckets[bucket] = thread;
+    ++map->size;
+
+    return thread;
+}
+
+/*
+ * Add to the counters of the calling thread.
+ */
+static inline void scrCount(ScrThread *thread, size_t numTokens,
+                            size_t numMisspellings)
+{
+    if (!thread)
+        return;
+    __atomic_store_n(&thread->numTokens, thread->numTokens + numTokens,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&thread->numMisspellings,
+                     thread->numMisspellings + numMisspellings,
+                     __ATOMIC_RELAXED);
+}
+
+/*
+ * Find the next word of text, per the rules of the data model it is checked
+ * against (see scdIsUtf8()).
+ */
+static inline size_t scrNextWord(int isUtf8, const char *text, size_t len,
+                                 size_t *pos, size_t *start)
+{
+    return isUtf8 ? sctNextWordUtf8(text, len, pos, start) :
+        sctNextWord(text, len, pos, start);
+}
+
+static inline int scrLookup(SpellCheckerDataHandle data,
+                            const ScrThread *thread, const char *word,
+                            size_t len)
+{
+    return (thread && thread->cache) ?
+        scdCacheHasWord(thread->cache, data, word, len) :
+        scdHasWordLen(data, word, len);
+}
+
+/*
+ * Enter a read-side critical section over the runner's data model, from any
+ * thread.
+ * @return the data model, valid until scrReadUnlock() is called.
+ */
+static SpellCheckerDataHandle scrReadLock(SpellCheckerRunnerHandle runner,
+                                          ScrReadToken *token)
+{
+    token->swap = sceReadLock(&runner->epoch);
+    SpellCheckerDataHandle data =
+        __atomic_load_n(&runner->data, __ATOMIC_ACQUIRE);
+    token->data = scdReadLock(data);
+    return data;
+}
+
+static inline void scrReadUnlock(SpellCheckerRunnerHandle runner,
+                                 SpellCheckerDataHandle data,
+                                 const ScrReadToken *token)
+{
+    scdReadUnlock(data, token->data);
+    sceReadUnlock(&runner->epoch, token->swap);
+}
+
+static void scrFreeData(void *ptr)
+{
+    scdFinalize(ptr);
+}
+
+/*
+ * Check the words in text[begin..end), reporting the misspelled ones as they
+ * are found.
+ * @return 0 on success, -1 if the job was cancelled.
+ */
+static int scrCheckRange(SpellCheckerRunnerHandle runner,
+                         ScrSpellCheckArg *msg, size_t begin, size_t end)
+{
+    ScrThread *thread = scrGetThread(runner);
+    size_t pos = begin;
+    size_t start;
+    size_t len;
+    size_t numWords = 0;
+    size_t numMisspellings = 0;
+    int ret = 0;
+    const int isUtf8 = scdIsUtf8(runner->data);
+    while ((len = scrNextWord(isUtf8, msg->text, end, &pos, &start)))
+    {
+        if (0 == scrLookup(runner->data, thread, &msg->text[start], len))
+        {
+            scrReport(msg, start, len);
+            ++numMisspellings;
+        }
+
+        if ((0 == (++numWords % SCR_WORDS_PER_CANCEL_CHECK)) &&
+            scrIsCancelRequested(msg->job))
+        {
+            ret = -1;
+            break;
+        }
+    }
+    scrCount(thread, numWords, numMisspellings);
+    return ret;
+}
+
+/*
+ * Worker thread task: check a chunk, and keep the misspellings to be reported
+ * by the runner.
+ */
+static void scrCheckChunk(ScpTask *task)
+{
+    ScrChunk *chunk = (ScrChunk*) task;
+    ScrParallelCheck *check = chunk->check;
+    ScrThread *thread = scrGetThread(check->runner);
+
+    size_t pos = chunk->begin;
+    size_t start;
+    size_t len;
+    size_t numWords = 0;
+    const int isUtf8 = scdIsUtf8(check->runner->data);
+    while ((len = scrNextWord(isUtf8, check->text, chunk->end, &pos, &start)))
+    {
+        /* Leave the misspellings found so far, they are not reported anyway */
+        if ((0 == (++numWords % SCR_WORDS_PER_CANCEL_CHECK)) &&
+            scrIsCancelRequested(check->job))
+            break;
+
+        if (0 != scrLookup(check->runner->data, thread, &check->text[start],
+                           len))
+            continue;
+
+        if (chunk->numMisspellings == chunk->capacity)
+        {
+            const size_t capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+            ScrMisspelling *misspellings =
+                realloc(chunk->misspellings, capacity * sizeof(ScrMisspelling));
+            if (!misspellings)
+            {
+                /* The runner will check this chunk by itself */
+                chunk->failed = 1;
+                break;
+            }
+            chunk->misspellings = misspellings;
+            chunk->capacity = capacity;
+        }
+        chunk->misspellings[chunk->numMisspellings].offset = start;
+        chunk->misspellings[chunk->numMisspellings].len = len;
+        ++chunk->numMisspellings;
+    }
+
+    /* A failed chunk is counted when the runner checks it again */
+    if (!chunk->failed)
+        scrCount(thread, numWords, chunk->numMisspellings);
+
+    pthread_mutex_lock(&check->mutex);
+    chunk->done = 1;
+    pthread_cond_broadcast(&check->cond);
+    pthread_mutex_unlock(&check->mutex);
+}
+
+/*
+ * Split the text into chunks, have the pool check them, and report the
+ * misspellings in order.
+ * @return 0 on success (or if the job was cancelled, see isCancelled), -1 if
+ * the check could not be started (and nothing was reported).
+ */
+static int scrDoParallelSpellCheck(SpellCheckerRunnerHandle runner,
+                                   ScrSpellCheckArg *msg, int *isCancelled)
+{
+    const size_t maxChunks =
+        scpNumThreads(runner->pool) * SCR_CHUNKS_PER_THREAD;
+    size_t numChunks = msg->len / SCR_MIN_CHUNK_SIZE;
+    if (numChunks > maxChunks)
+        numChunks = maxChunks;
+    if (numChunks < 2)
+        return -1;
+
+    ScrChunk *chunks = calloc(numChunks, sizeof(ScrChunk));
+    if (!chunks)
+        return -1;
+
+    ScrParallelCheck check;
+    check.runner = runner;
+    check.text = msg->text;
+    check.job = msg->job;
+    pthread_mutex_init(&check.mutex, NULL);
+    pthread_cond_init(&check.cond, NULL);
+
+    /*
+     * Each chunk ends right after a delimiter, so the runner can terminate the
+     * words of a chunk that is done while the next chunk is being checked.
+     * The delimiter is an ASCII one, so chunks of UTF-8 text do not split a
+     * character either.
+     */
+    size_t begin = 0;
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+        size_t end = msg->len;
+        if (i + 1 < numChunks)
+        {
+            end = msg->len / numChunks * (i + 1);
+            if (end < begin)
+                end = begin;
+            while ((end < msg->len) && sctIsWordChar(msg->text[end - 1]))
+                ++end;
+        }
+
+        chunks[i].task.func = scrCheckChunk;
+        chunks[i].check = &check;
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        scpSubmit(runner->pool, &chunks[i].task);
+
+        begin = end;
+    }
+
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+        pthread_mutex_lock(&check.mutex);
+        while (!chunks[i].done)
+            pthread_cond_wait(&check.cond, &check.mutex);
+        pthread_mutex_unlock(&check.mutex);
+
+        /* All the chunks must be done before returning, even if cancelled */
+        if (!*isCancelled && scrIsCancelRequested(msg->job))
+            *isCancelled = 1;
+
+        if (*isCancelled)
+        {
+            /* Nothing more is reported */
+        }
+        else if (chunks[i].failed)
+        {
+            if (-1 == scrCheckRange(runner, msg, chunks[i].begin,
+                                    chunks[i].end))
+                *isCancelled = 1;
+        }
+        else
+        {
+            for (size_t j = 0; j < chunks[i].numMisspellings; ++j)
+                scrReport(msg, chunks[i].misspellings[j].offset,
+                          chunks[i].misspellings[j].len);
+        }
+        free(chunks[i].misspellings);
+    }
+
+    pthread_cond_destroy(&check.cond);
+    pthread_mutex_destroy(&check.mutex);
+    free(chunks);
+
+    return 0;
+}
+
+/*
+ * Drop a reference to a job, destroying it with the last one.
+ */
+void scrJobRelease(SpellCheckerJobHandle job)
+{
+    if (!job)
+        return;
+
+    if (0 != __atomic_sub_fetch(&job->refCount, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    pthread_cond_destroy(&job->cond);
+    pthread_mutex_destroy(&job->mutex);
+    free(job);
+}
+
+/*
+ * Claim a job that was not claimed yet (by the runner, to run it, or by a
+ * cancel, to drop it).
+ * @return 1 if the job was claimed, 0 if it already was.
+ */
+static int scrJobClaim(SpellCheckerJobHandle job, SpellCheckerJobStatus status)
+{
+    pthread_mutex_lock(&job->mutex);
+    const int isClaimed = job->isClaimed;
+    if (!isClaimed)
+    {
+        job->isClaimed = 1;
+        job->status = status;
+    }
+    pthread_mutex_unlock(&job->mutex);
+    return !isClaimed;
+}
+
+/*
+ * Complete a claimed job: the completion callback is called before waiters
+ * are woken up, so they may release what it uses.
+ */
+static void scrJobComplete(SpellCheckerJobHandle job,
+                           SpellCheckerJobStatus status)
+{
+    if (job->onComplete)
+        job->onComplete(job, status, job->userdata);
+
+    pthread_mutex_lock(&job->mutex);
+    job->status = status;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->mutex);
+}
+
+static int scrDoSpellCheck(SpellCheckerRunnerHandle runner, void *arg)
+{
+    ScrSpellCheckArg *msg = (ScrSpellCheckArg*) arg;
+    int isCancelled = 0;
+
+    /* A job cancelled before it started has already been completed */
+    if (msg->job && !scrJobClaim(msg->job, SPELL_CHECKER_JOB_RUNNING))
+    {
+        scrJobRelease(msg->job);
+        return 0;
+    }
+
+    if (!msg->text)
+        msg->text = msg->copy;
+
+    scdCommit(runner->data);
+
+    if (!runner->pool ||
+        (-1 == scrDoParallelSpellCheck(runner, msg, &isCancelled)))
+        isCancelled = (-1 == scrCheckRange(runner, msg, 0, msg->len));
+
+    if (msg->job)
+    {
+        scrJobComplete(msg->job, isCancelled ? SPELL_CHECKER_JOB_CANCELLED :
+                       SPELL_CHECKER_JOB_DONE);
+        scrJobRelease(msg->job);
+    }
+
+    return 0;
+}
+
+/*
+ * Process a message, from the runner's thread or the worker running it.
+ * @return 0 on success, -1 if the message is not recognized.
+ */
+static int scrHandleMsg(SpellCheckerRunnerHandle runner, ScrSlot *msg)
+{
+    const uint64_t start = scrNowNs();
+    void *msgArg = msg->isInline ? msg->payload.bytes : msg->payload.arg;
+    int handled = 1;
+
+    switch(msg->type)
+    {
+    case SCR_MSG_ADD:
+        scdAddWord(runner->data, (const char*)msgArg);
+        break;
+    case SCR_MSG_ADD_FREQUENCY:
+    {
+        ScrAddFrequencyArg *addFrequencyArg = msgArg;
+        scdAddWordWithFrequency(runner->data, addFrequencyArg->word,
+                                addFrequencyArg->frequency);
+        break;
+    }
+    case SCR_MSG_ADD_WORDS:
+    {
+        ScrAddWordsArg *addWordsArg = msgArg;
+        scdAddWords(runner->data, addWordsArg->buf, addWordsArg->len);
+        break;
+    }
+    case SCR_MSG_REMOVE:
+        scdRemoveWord(runner->data, (const char*)msgArg);
+        break;
+    case SCR_MSG_SWAP:
+    {
+        ScrSwapArg *swapArg;
+        memcpy(&swapArg, msgArg, sizeof(swapArg));
+
+        /* The readers still using the previous data model keep it alive */
+        SpellCheckerDataHandle previous = runner->data;
+        scdContinueGeneration(swapArg->data, previous);
+        __atomic_store_n(&runner->data, swapArg->data, __ATOMIC_RELEASE);
+        sceRetire(&runner->epoch, previous, scrFreeData);
+
+        pthread_mutex_lock(&runner->mutex);
+        swapArg->done = 1;
+        pthread_cond_broadcast(&runner->doneCond);
+        pthread_mutex_unlock(&runner->mutex);
+        break;
+    }
+    case SCR_MSG_SPELL_CHECK:
+        scrDoSpellCheck(runner, msgArg);
+        break;
+    case SCR_MSG_COMPILE:
+    {
+        ScrCompileArg *compileArg;
+        memcpy(&compileArg, msgArg, sizeof(compileArg));
+        const int result = scdCompile(runner->data, compileArg->path);
+        pthread_mutex_lock(&runner->mutex);
+        compileArg->result = result;
+        compileArg->done = 1;
+        pthread_cond_broadcast(&runner->doneCond);
+        pthread_mutex_unlock(&runner->mutex);
+        break;
+    }
+    case SCR_MSG_SET_PARALLELISM:
+    {
+        unsigned int numThreads;
+        memcpy(&numThreads, msgArg, sizeof(numThreads));
+        scpFinalize(runner->pool);
+        runner->pool = (numThreads > 1) ? scpInit(numThreads) : NULL;
+        break;
+    }
+    case SCR_MSG_FINALIZE:
+        runner->isRunning = 0;
+        break;
+    default:
+        printf("Internal error: unrecognized message type (%d)!\n",
+               msg->type);
+        handled = 0;
+    }
+
+    if (!msg->isInline)
+        free(msgArg);
+    scdReclaim(runner->data);
+    sceReclaim(&runner->epoch);
+
+    __atomic_store_n(&runner->numMessages, runner->numMessages + 1,
+                     __ATOMIC_RELAXED);
+    scrUpdateStats(runner, start);
+
+    return handled ? 0 : -1;
+}
+
+static void * thread_runner(void *arg)
+{
+    SpellCheckerRunnerHandle runner = (SpellCheckerRunnerHandle) arg;
+    pthread_setspecific(scrRunnerKey, runner);
+
+    int handled = 1;
+    while (handled && runner->isRunning)
+    {
+        ScrSlot msg;
+        scrWaitMsg(runner, &msg);
+        handled = (0 == scrHandleMsg(runner, &msg));
+    }
+
+    return NULL;
+}
+
+/*
+ * @return whether a message is waiting in the queue (runner only).
+ */
+static int scrHasMsg(SpellCheckerRunnerHandle runner)
+{
+    const size_t pos = runner->dequeuePos;
+    const ScrSlot *slot = &runner->slots[pos & runner->mask];
+    return pos + 1 == __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Queue the runner on its executor, unless it already is.
+ */
+static void scrSchedule(SpellCheckerRunnerHandle runner)
+{
+    int isScheduled = 0;
+    if (__atomic_compare_exchange_n(&runner->isScheduled, &isScheduled, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        scpSubmit(runner->executor, &runner->task);
+}
+
+/*
+ * Executor task: process the next messages of the runner.
+ */
+static void scrRun(ScpTask *task)
+{
+    SpellCheckerRunnerHandle runner = (SpellCheckerRunnerHandle) task;
+    pthread_setspecific(scrRunnerKey, runner);
+
+    ScrSlot msg;
+    int hasMsg = 1;
+    for (unsigned int i = 0; runner->isRunning && (i < SCR_MSGS_PER_RUN); ++i)
+    {
+        hasMsg = (0 == scrTryDequeue(runner, &msg));
+        if (!hasMsg)
+            break;
+        scrNotifyNotFull(runner);
+        scrHandleMsg(runner, &msg);
+    }
+    pthread_setspecific(scrRunnerKey, NULL);
+
+    if (!runner->isRunning)
+    {
+        /* Never queued again, scrStop() frees the runner once woken up */
+        pthread_mutex_lock(&runner->mutex);
+        runner->isStopped = 1;
+        pthread_cond_broadcast(&runner->doneCond);
+        pthread_mutex_unlock(&runner->mutex);
+        return;
+    }
+
+    /* Let the other runners run first */
+    if (hasMsg)
+    {
+        scpSubmit(runner->executor, &runner->task);
+        return;
+    }
+
+    /* A message posted meanwhile is either seen here, or schedules us again */
+    scrIdle(runner);
+    __atomic_store_n(&runner->isScheduled, 0, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (scrHasMsg(runner))
+        scrSchedule(runner);
+}
+
+/*
+ * Post a message, following the given policy if the queue is full. The runner
+ * itself (i.e. a callback) never waits for room, as only it can make some.
+ * The arg of the message is copied, into the slot if it fits.
+ * @return 0 if the message was posted, 1 if it was dropped, -1 on failure.
+ */
+static int csrPushMsg(SpellCheckerRunnerHandle runner, const ScrMsg *msg,
+                      SpellCheckerQueuePolicy policy)
+{
+    void *block = NULL;
+    if (scrMsgSize(msg) > SCR_SLOT_PAYLOAD)
+    {
+        block = malloc(scrMsgSize(msg));
+        if (!block)
+        {
+            printf("Failed allocating memory for message\n");
+            return -1;
+        }
+        scrMsgCopy(msg, block);
+    }
+
+    if (-1 == scrTryEnqueue(runner, msg, block))
+    {
+        if ((SPELL_CHECKER_QUEUE_DROP == policy) ||
+            (SPELL_CHECKER_QUEUE_FAIL == policy) ||
+            scrOnRunnerThread(runner))
+        {
+            free(block);
+            return (SPELL_CHECKER_QUEUE_DROP == policy) ? 1 : -1;
+        }
+
+        pthread_mutex_lock(&runner->mutex);
+        __atomic_add_fetch(&runner->numBlocked, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while (-1 == scrTryEnqueue(runner, msg, block))
+            pthread_cond_wait(&runner->notFullCond, &runner->mutex);
+        __atomic_sub_fetch(&runner->numBlocked, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&runner->mutex);
+    }
+
+    /* Wake up the runner if it went to sleep (see scrWaitMsg() and scrRun()) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (runner->executor)
+        scrSchedule(runner);
+    else if (__atomic_load_n(&runner->isSleeping, __ATOMIC_RELAXED))
+    {
+        pthread_mutex_lock(&runner->mutex);
+        pthread_cond_signal(&runner->cond);
+        pthread_mutex_unlock(&runner->mutex);
+    }
+
+    return 0;
+}
+
+static unsigned int scrNumCpus(void)
+{
+    const long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (numCpus > 0) ? (unsigned int)numCpus : 1;
+}
+
+SpellCheckerPoolHandle scrExecutorInit(unsigned int numThreads)
+{
+    return scpInit(numThreads ? numThreads : scrNumCpus());
+}
+
+void scrExecutorFinalize(SpellCheckerPoolHandle executor)
+{
+    scpFinalize(executor);
+}
+
+SpellCheckerRunnerHandle scrInit(SpellCheckerDataHandle data,
+                                 size_t queueDepth,
+                                 SpellCheckerQueuePolicy policy,
+                                 size_t cacheSize,
+                                 SpellCheckerPoolHandle executor)
+{
+    if (!data)
+    {
+        printf("NULL data model pointer\n");
+        return NULL;
+    }
+
+    pthread_once(&scrRunnerKeyOnce, scrCreateRunnerKey);
+    pthread_once(&scrThreadKeyOnce, scrCreateThreadKey);
+
+    if (0 == queueDepth)
+        queueDepth = SCR_DEFAULT_QUEUE_DEPTH;
+    if (queueDepth > SCR_MAX_QUEUE_DEPTH)
+        queueDepth = SCR_MAX_QUEUE_DEPTH;
+    size_t numSlots = 2;
+    while (numSlots < queueDepth)
+        numSlots *= 2;
+
+    SpellCheckerRunnerHandle runner =
+        malloc(sizeof(struct _SpellCheckerRunner));
+    if (!runner)
+    {
+        printf("Failed allocating memory for SpellCheckerRunnerHandle\n");
+        return NULL;
+    }
+
+    runner->slots = malloc(numSlots * sizeof(ScrSlot));
+    if (!runner->slots)
+    {
+        printf("Failed allocating memory for the message queue\n");
+        free(runner);
+        return NULL;
+    }
+    for (size_t i = 0; i < numSlots; ++i)
+        runner->slots[i].sequence = i;
+    runner->mask = numSlots - 1;
+    runner->enqueuePos = 0;
+    runner->dequeuePos = 0;
+    runner->policy = policy;
+    runner->task.func = scrRun;
+    runner->executor = executor;
+    runner->isScheduled = 0;
+    runner->isStopped = 0;
+    runner->isSleeping = 0;
+    runner->numBlocked = 0;
+
+    runner->data = data;
+    sceInit(&runner->epoch);
+    runner->pool = NULL;
+
+    runner->cacheSize = cacheSize;
+    runner->threads = NULL;
+    runner->cacheHits = 0;
+    runner->cacheMisses = 0;
+    runner->numTokens = 0;
+    runner->numMisspellings = 0;
+    runner->numMessages = 0;
+    runner->busyNs = 0;
+    runner->maxQueueDepth = 0;
+    memset(&runner->dataStats, 0, sizeof(runner->dataStats));
+
+    runner->isRunning = 1;
+
+    pthread_mutex_init(&runner->mutex, NULL);
+    pthread_cond_init(&runner->cond, NULL);
+    pthread_cond_init(&runner->notFullCond, NULL);
+    pthread_cond_init(&runner->doneCond, NULL);
+    if (!executor)
+        pthread_create(&runner->thread, NULL, thread_runner, runner);
+
+    return runner;
+}
+
+/*
+ * Stop the runner's thread, once it processed the messages posted so far.
+ * @return 0 on success, -1 if called from the runner's thread.
+ */
+static int scrStop(SpellCheckerRunnerHandle runner)
+{
+    const ScrMsg msg = { SCR_MSG_FINALIZE, NULL, 0, NULL, 0 };
+    if (scrOnRunnerThread(runner) ||
+        (-1 == csrPushMsg(runner, &msg, SPELL_CHECKER_QUEUE_BLOCK)))
+    {
+        printf("Cannot finalize the runner from its own thread\n");
+        return -1;
+    }
+
+    if (runner->executor)
+    {
+        pthread_mutex_lock(&runner->mutex);
+        while (!runner->isStopped)
+            pthread_cond_wait(&runner->doneCond, &runner->mutex);
+        pthread_mutex_unlock(&runner->mutex);
+    }
+    else
+    {
+        pthread_join(runner->thread, NULL);
+    }
+    return 0;
+}
+
+/*
+ * Free a stopped runner, but its (current) data model.
+ */
+static void scrRelease(SpellCheckerRunnerHandle runner)
+{
+    scpFinalize(runner->pool);
+
+    /* The data models replaced by swaps */
+    sceFinalize(&runner->epoch);
+
+    /* The state of the threads that are still alive, they free it */
+    pthread_mutex_lock(&scrThreadsMutex);
+    while (runner->threads)
+        scrDetachThread(runner->threads);
+    pthread_mutex_unlock(&scrThreadsMutex);
+
+    pthread_cond_destroy(&runner->doneCond);
+    pthread_cond_destroy(&runner->notFullCond);
+    pthread_cond_destroy(&runner->cond);
+    pthread_mutex_destroy(&runner->mutex);
+    free(runner->slots);
+    free(runner);
+}
+
+int scrFinalize(SpellCheckerRunnerHandle runner)
+{
+    if (!runner)
+    {
+        printf("NULL runner pointer\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Nothing to see here... Carry on.\n");
+        return 0;
+    }
+
+    if (-1 == scrStop(runner))
+        return -1;
+
+    scdFinalize(runner->data);
+    scrRelease(runner);
+
+    return 0;
+}
+
+int scrAddWord(SpellCheckerRunnerHandle runner, const char *word)
+{
+    if (!runner || !word)
+    {
+        printf("Illegal argument(s) passed to scrAddWord\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return 0;
+    }
+
+    const ScrMsg msg = { SCR_MSG_ADD, NULL, 0, word, strlen(word) };
+    const int ret = csrPushMsg(runner, &msg, runner->policy);
+
+    return (-1 == ret) ? -1 : 0;
+}
+
+int scrAddWordWithFrequency(SpellCheckerRunnerHandle runner, const char *word,
+                            unsigned int frequency)
+{
+    if (!runner || !word)
+    {
+        printf("Illegal argument(s) passed to scrAddWordWithFrequency\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return 0;
+    }
+
+    ScrAddFrequencyArg arg;
+    arg.frequency = frequency;
+
+    const ScrMsg msg = { SCR_MSG_ADD_FREQUENCY, &arg,
+                         offsetof(ScrAddFrequencyArg, word), word,
+                         strlen(word) };
+    const int ret = csrPushMsg(runner, &msg, runner->policy);
+
+    return (-1 == ret) ? -1 : 0;
+}
+
+int scrAddWords(SpellCheckerRunnerHandle runner, const char *buf, size_t len)
+{
+    if (!runner || (!buf && len))
+    {
+        printf("Illegal argument(s) passed to scrAddWords\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return 0;
+    }
+
+    ScrAddWordsArg arg;
+    arg.len = len;
+
+    const ScrMsg msg = { SCR_MSG_ADD_WORDS, &arg, offsetof(ScrAddWordsArg, buf),
+                         buf, len };
+    const int ret = csrPushMsg(runner, &msg, runner->policy);
+
+    return (-1 == ret) ? -1 : 0;
+}
+
+int scrRemoveWord(SpellCheckerRunnerHandle runner, const char *word)
+{
+    if (!runner || !word)
+    {
+        printf("Illegal argument(s) passed to scrRemoveWord\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return 0;
+    }
+
+    const ScrMsg msg = { SCR_MSG_REMOVE, NULL, 0, word, strlen(word) };
+    const int ret = csrPushMsg(runner, &msg, runner->policy);
+
+    return (-1 == ret) ? -1 : 0;
+}
+
+int scrSwap(SpellCheckerRunnerHandle runner, SpellCheckerRunnerHandle from)
+{
+    if (!runner || !from || (runner == from))
+    {
+        printf("Illegal argument(s) passed to scrSwap\n");
+        return -1;
+    }
+
+    if (!runner->isRunning || !from->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return -1;
+    }
+
+    if (scrOnRunnerThread(runner) || scrOnRunnerThread(from))
+    {
+        printf("Cannot swap data models from a runner's thread\n");
+        return -1;
+    }
+
+    /* The new data model gets all the words posted to it so far */
+    scrStop(from);
+    SpellCheckerDataHandle data = from->data;
+    scrRelease(from);
+
+    ScrSwapArg arg = { data, 0 };
+    ScrSwapArg *argPtr = &arg;
+    const ScrMsg msg = { SCR_MSG_SWAP, &argPtr, sizeof(argPtr), NULL, 0 };
+    if ((-1 == scdCommit(data)) ||
+        (-1 == csrPushMsg(runner, &msg, SPELL_CHECKER_QUEUE_BLOCK)))
+    {
+        printf("Failed swapping data models\n");
+        scdFinalize(data);
+        return 1;
+    }
+
+    pthread_mutex_lock(&runner->mutex);
+    while (!arg.done)
+        pthread_cond_wait(&runner->doneCond, &runner->mutex);
+    pthread_mutex_unlock(&runner->mutex);
+
+    return 0;
+}
+
+/*
+ * Post a spell-check of a copy of the text, or of the text itself if inPlace
+ * (only with a span callback, which does not write to the text).
+ * @return 0 on success, 1 if it was dropped, -1 on failure.
+ */
+static int scrPostSpellCheck(SpellCheckerRunnerHandle runner, const char *text,
+                             size_t len, int inPlace,
+                             SpellCheckerCallback callback,
+                             SpellCheckerSpanCallback spanCallback,
+                             SpellCheckerJobHandle job)
+{
+    ScrSpellCheckArg arg;
+    arg.len = len;
+    arg.text = inPlace ? (char*)text : NULL;
+    arg.callback = callback;
+    arg.spanCallback = spanCallback;
+    arg.job = job;
+
+    /* The null character keeps room for terminating the last word */
+    const ScrMsg msg = { SCR_MSG_SPELL_CHECK, &arg,
+                         offsetof(ScrSpellCheckArg, copy),
+                         inPlace ? NULL : (len ? text : ""),
+                         inPlace ? 0 : len };
+    return csrPushMsg(runner, &msg, runner->policy);
+}
+
+int scrRunSpellCheck(SpellCheckerRunnerHandle runner, const char *text,
+                     SpellCheckerCallback callback)
+{
+    if (!runner || !text || !callback)
+    {
+        printf("Illegal argument(s) passed to scrRunSpellCheck\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return 0;
+    }
+
+    if (-1 == scrPostSpellCheck(runner, text, strlen(text), 0, callback, NULL,
+                                NULL))
+        return -1;
+
+    return 0;
+}
+
+/*
+ * Post a spell-check tracked by a job, see scrStartSpellCheck() (and
+ * scrPostSpellCheck() for inPlace).
+ */
+static SpellCheckerJobHandle scrStartJob(SpellCheckerRunnerHandle runner,
+                                         const char *text, size_t len,
+                                         int inPlace,
+                                         SpellCheckerSpanCallback callback,
+                                         SpellCheckerJobCallback onComplete,
+                                         void *userdata)
+{
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return NULL;
+    }
+
+    SpellCheckerJobHandle job = malloc(sizeof(struct _SpellCheckerJob));
+    if (!job)
+    {
+        printf("Failed allocating memory for SpellCheckerJobHandle\n");
+        return NULL;
+    }
+
+    pthread_mutex_init(&job->mutex, NULL);
+    pthread_cond_init(&job->cond, NULL);
+    job->status = SPELL_CHECKER_JOB_PENDING;
+    job->isClaimed = 0;
+    job->isCancelRequested = 0;
+    job->refCount = 2; /* The caller's and the runner's */
+    job->onComplete = onComplete;
+    job->userdata = userdata;
+
+    const int ret = scrPostSpellCheck(runner, text, len, inPlace, NULL,
+                                      callback, job);
+    if (-1 == ret)
+    {
+        pthread_cond_destroy(&job->cond);
+        pthread_mutex_destroy(&job->mutex);
+        free(job);
+        return NULL;
+    }
+    else if (1 == ret)
+    {
+        /* Dropped: cancel it right away, in place of the runner */
+        scrJobClaim(job, SPELL_CHECKER_JOB_CANCELLED);
+        scrJobComplete(job, SPELL_CHECKER_JOB_CANCELLED);
+        scrJobRelease(job);
+    }
+
+    return job;
+}
+
+SpellCheckerJobHandle scrStartSpellCheck(SpellCheckerRunnerHandle runner,
+                                         const char *text, size_t len,
+                                         SpellCheckerSpanCallback callback,
+                                         SpellCheckerJobCallback onComplete,
+                                         void *userdata)
+{
+    if (!runner || (!text && len) || !callback)
+    {
+        printf("Illegal argument(s) passed to scrStartSpellCheck\n");
+        return NULL;
+    }
+
+    return scrStartJob(runner, text, len, 0, callback, onComplete, userdata);
+}
+
+int scrCheckFile(SpellCheckerRunnerHandle runner, const char *path,
+                 SpellCheckerSpanCallback callback, void *userdata)
+{
+    if (!runner || !path || !callback)
+    {
+        printf("Illegal argument(s) passed to scrCheckFile\n");
+        return -1;
+    }
+
+    if (scrOnRunnerThread(runner))
+    {
+        printf("Cannot check a file from the runner's thread\n");
+        return -1;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (-1 == fd)
+    {
+        printf("Failed opening file to check (%s)\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st))
+    {
+        printf("Failed finding the size of file to check (%s)\n", path);
+        close(fd);
+        return -1;
+    }
+
+    /* An empty file cannot be mapped, and has nothing to check anyway */
+    const size_t size = st.st_size;
+    if (0 == size)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == text)
+    {
+        printf("Failed mapping file to check (%s)\n", path);
+        return -1;
+    }
+    posix_madvise(text, size, POSIX_MADV_SEQUENTIAL);
+
+    /* The mapping must outlive the job, so wait for it even if cancelled */
+    int ret = -1;
+    SpellCheckerJobHandle job =
+        scrStartJob(runner, text, size, 1, callback, NULL, userdata);
+    if (job)
+    {
+        if ((0 == scrJobWait(job, -1)) &&
+            (SPELL_CHECKER_JOB_DONE == scrJobGetStatus(job)))
+            ret = 0;
+        scrJobRelease(job);
+    }
+
+    munmap(text, size);
+    return ret;
+}
+
+SpellCheckerJobStatus scrJobGetStatus(SpellCheckerJobHandle job)
+{
+    pthread_mutex_lock(&job->mutex);
+    const SpellCheckerJobStatus status = job->status;
+    pthread_mutex_unlock(&job->mutex);
+    return status;
+}
+
+static int scrJobIsFinished(SpellCheckerJobStatus status)
+{
+    return (SPELL_CHECKER_JOB_DONE == status) ||
+        (SPELL_CHECKER_JOB_CANCELLED == status);
+}
+
+int scrJobWait(SpellCheckerJobHandle job, long timeoutMs)
+{
+    if (!job)
+    {
+        printf("Illegal argument(s) passed to scrJobWait\n");
+        return -1;
+    }
+
+    struct timespec deadline;
+    if (timeoutMs >= 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMs / 1000;
+        deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    int ret = 0;
+    pthread_mutex_lock(&job->mutex);
+    while (!scrJobIsFinished(job->status) && (0 == ret))
+    {
+        if (timeoutMs < 0)
+            pthread_cond_wait(&job->cond, &job->mutex);
+        else if (ETIMEDOUT == pthread_cond_timedwait(&job->cond, &job->mutex,
+                                                     &deadline))
+            ret = -1;
+    }
+    if (scrJobIsFinished(job->status))
+        ret = 0;
+    pthread_mutex_unlock(&job->mutex);
+
+    return ret;
+}
+
+int scrJobCancel(SpellCheckerJobHandle job)
+{
+    if (!job)
+    {
+        printf("Illegal argument(s) passed to scrJobCancel\n");
+        return -1;
+    }
+
+    __atomic_store_n(&job->isCancelRequested, 1, __ATOMIC_RELAXED);
+
+    /* If the runner did not get to the job yet, it will just drop it */
+    if (scrJobClaim(job, SPELL_CHECKER_JOB_RUNNING))
+        scrJobComplete(job, SPELL_CHECKER_JOB_CANCELLED);
+
+    return 0;
+}
+
+int scrCheckSpan(SpellCheckerRunnerHandle runner, const char *text, size_t len,
+                 SpellCheckerSpanCallback callback, void *userdata)
+{
+    if (!runner || (!text && len) || !callback)
+    {
+        printf("Illegal argument(s) passed to scrCheckSpan\n");
+        return -1;
+    }
+
+    /* The whole text is checked against the same data model */
+    ScrThread *thread = scrGetThread(runner);
+    ScrReadToken token;
+    SpellCheckerDataHandle data = scrReadLock(runner, &token);
+    size_t pos = 0;
+    size_t start;
+    size_t wordLen;
+    size_t numWords = 0;
+    size_t numMisspellings = 0;
+    const int isUtf8 = scdIsUtf8(data);
+    while ((wordLen = scrNextWord(isUtf8, text, len, &pos, &start)))
+    {
+        if (0 == scrLookup(data, thread, &text[start], wordLen))
+        {
+            callback(&text[start], wordLen, start, userdata);
+            ++numMisspellings;
+        }
+
+        /* Let the runner reclaim memory during long texts */
+        if (0 == (++numWords % SCR_SPAN_WORDS_PER_READ_LOCK))
+        {
+            scdReadUnlock(data, token.data);
+            token.data = scdReadLock(data);
+        }
+    }
+    scrReadUnlock(runner, data, &token);
+    scrCount(thread, numWords, numMisspellings);
+
+    return 0;
+}
+
+int scrHasWord(SpellCheckerRunnerHandle runner, const char *word)
+{
+    if (!runner || !word)
+    {
+        printf("Illegal argument(s) passed to scrHasWord\n");
+        return -1;
+    }
+
+    /* Lookups are not counted, only the cache needs the thread's state */
+    const ScrThread *thread = runner->cacheSize ? scrGetThread(runner) : NULL;
+    ScrReadToken token;
+    SpellCheckerDataHandle data = scrReadLock(runner, &token);
+    const int ret = scrLookup(data, thread, word, strlen(word));
+    scrReadUnlock(runner, data, &token);
+
+    return ret;
+}
+
+int scrHasWords(SpellCheckerRunnerHandle runner, const char **words,
+                const size_t *lens, size_t numWords, uint8_t *results)
+{
+    if (!runner || ((!words || !lens || !results) && numWords))
+    {
+        printf("Illegal argument(s) passed to scrHasWords\n");
+        return -1;
+    }
+
+    /* Let the runner reclaim memory during long batches */
+    int ret = 0;
+    for (size_t first = 0; (0 == ret) && (first < numWords);
+         first += SCR_SPAN_WORDS_PER_READ_LOCK)
+    {
+        const size_t num = (numWords - first < SCR_SPAN_WORDS_PER_READ_LOCK) ?
+            numWords - first : SCR_SPAN_WORDS_PER_READ_LOCK;
+        ScrReadToken token;
+        SpellCheckerDataHandle data = scrReadLock(runner, &token);
+        ret = scdHasWords(data, &words[first], &lens[first], num,
+                          &results[first]);
+        scrReadUnlock(runner, data, &token);
+    }
+
+    return ret;
+}
+
+SpellCheckerDataHandle scrGetData(SpellCheckerRunnerHandle runner)
+{
+    if (!runner)
+    {
+        printf("NULL runner pointer\n");
+        return NULL;
+    }
+
+    return __atomic_load_n(&runner->data, __ATOMIC_ACQUIRE);
+}
+
+int scrGetCacheStats(SpellCheckerRunnerHandle runner, uint64_t *hits,
+                     uint64_t *misses)
+{
+    if (!runner || !hits || !misses)
+    {
+        printf("Illegal argument(s) passed to scrGetCacheStats\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&scrThreadsMutex);
+    *hits = runner->cacheHits;
+    *misses = runner->cacheMisses;
+    for (const ScrThread *thread = runner->threads; thread;
+         thread = thread->next)
+    {
+        if (!thread->cache)
+            continue;
+        uint64_t cacheHits;
+        uint64_t cacheMisses;
+        scdCacheGetStats(thread->cache, &cacheHits, &cacheMisses);
+        *hits += cacheHits;
+        *misses += cacheMisses;
+    }
+    pthread_mutex_unlock(&scrThreadsMutex);
+
+    return 0;
+}
+
+int scrGetStats(SpellCheckerRunnerHandle runner, ScrStats *stats)
+{
+    if (!runner || !stats)
+    {
+        printf("Illegal argument(s) passed to scrGetStats\n");
+        return -1;
+    }
+
+    stats->numWords =
+        __atomic_load_n(&runner->dataStats.numWords, __ATOMIC_RELAXED);
+    stats->numNodes =
+        __atomic_load_n(&runner->dataStats.numNodes, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&runner->dataStats.bytes, __ATOMIC_RELAXED);
+
+    /* The runner only catches up with the producers, never overtakes them */
+    const size_t dequeuePos =
+        __atomic_load_n(&runner->dequeuePos, __ATOMIC_RELAXED);
+    stats->queueDepth =
+        __atomic_load_n(&runner->enqueuePos, __ATOMIC_RELAXED) - dequeuePos;
+    stats->maxQueueDepth =
+        __atomic_load_n(&runner->maxQueueDepth, __ATOMIC_RELAXED);
+    stats->numMessages =
+        __atomic_load_n(&runner->numMessages, __ATOMIC_RELAXED);
+    stats->busyNs = __atomic_load_n(&runner->busyNs, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&scrThreadsMutex);
+    stats->numTokens = runner->numTokens;
+    stats->numMisspellings = runner->numMisspellings;
+    for (const ScrThread *thread = runner->threads; thread;
+         thread = thread->next)
+    {
+        stats->numTokens +=
+            __atomic_load_n(&thread->numTokens, __ATOMIC_RELAXED);
+        stats->numMisspellings +=
+            __atomic_load_n(&thread->numMisspellings, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&scrThreadsMutex);
+
+    return 0;
+}
+
+int scrSuggest(SpellCheckerRunnerHandle runner, const char *word,
+               unsigned int maxDistance, size_t maxResults, char **out)
+{
+    if (!runner || !word || (!out && maxResults))
+    {
+        printf("Illegal argument(s) passed to scrSuggest\n");
+        return -1;
+    }
+
+    ScrReadToken token;
+    SpellCheckerDataHandle data = scrReadLock(runner, &token);
+    const int ret = scdSuggest(data, word, maxDistance, maxResults, out);
+    scrReadUnlock(runner, data, &token);
+
+    return ret;
+}
+
+int scrHasPrefix(SpellCheckerRunnerHandle runner, const char *prefix)
+{
+    if (!runner || !prefix)
+    {
+        printf("Illegal argument(s) passed to scrHasPrefix\n");
+        return -1;
+    }
+
+    ScrReadToken token;
+    SpellCheckerDataHandle data = scrReadLock(runner, &token);
+    const int ret = scdHasPrefix(data, prefix);
+    scrReadUnlock(runner, data, &token);
+
+    return ret;
+}
+
+int scrComplete(SpellCheckerRunnerHandle runner, const char *prefix,
+                size_t maxResults, char **out)
+{
+    if (!runner || !prefix || (!out && maxResults))
+    {
+        printf("Illegal argument(s) passed to scrComplete\n");
+        return -1;
+    }
+
+    ScrReadToken token;
+    SpellCheckerDataHandle data = scrReadLock(runner, &token);
+    const int ret = scdComplete(data, prefix, maxResults, out);
+    scrReadUnlock(runner, data, &token);
+
+    return ret;
+}
+
+int scrSetParallelism(SpellCheckerRunnerHandle runner, unsigned int numThreads)
+{
+    if (!runner)
+    {
+        printf("Illegal argument(s) passed to scrSetParallelism\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return -1;
+    }
+
+    if (0 == numThreads)
+        numThreads = scrNumCpus();
+    if (numThreads > SCR_MAX_PARALLELISM)
+        numThreads = SCR_MAX_PARALLELISM;
+
+    const ScrMsg msg = { SCR_MSG_SET_PARALLELISM, &numThreads,
+                         sizeof(numThreads), NULL, 0 };
+    return csrPushMsg(runner, &msg, SPELL_CHECKER_QUEUE_BLOCK);
+}
+
+int scrCompile(SpellCheckerRunnerHandle runner, const char *path)
+{
+    if (!runner || !path)
+    {
+        printf("Illegal argument(s) passed to scrCompile\n");
+        return -1;
+    }
+
+    if (!runner->isRunning)
+    {
+        printf("Runner is not running. Free and call init again to get a valid"
+               "one\n");
+        return -1;
+    }
+
+    if (scrOnRunnerThread(runner))
+    {
+        printf("Cannot compile the dictionary from the runner's thread\n");
+        return -1;
+    }
+
+    ScrCompileArg arg = { path, -1, 0 };
+    ScrCompileArg *argPtr = &arg;
+    const ScrMsg msg = { SCR_MSG_COMPILE, &argPtr, sizeof(argPtr), NULL, 0 };
+    if (-1 == csrPushMsg(runner, &msg, SPELL_CHECKER_QUEUE_BLOCK))
+        return -1;
+
+    pthread_mutex_lock(&runner->mutex);
+    while (!arg.done)
+        pthread_cond_wait(&runner->doneCond, &runner->mutex);
+    pthread_mutex_unlock(&runner->mutex);
+
+    return arg.result;
 }
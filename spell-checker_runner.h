@@ -1,7 +1,11 @@
 #ifndef __SPELL_CHECKER_RUNNER_H
 #define __SPELL_CHECKER_RUNNER_H
 
+#include <stdint.h>
+
 #include "spell-checker.h"
+#include "spell-checker_data.h"
+#include "spell-checker_pool.h"
 
 /**
  * An asynchronous runner for posting spell-checking operations.
@@ -12,14 +16,50 @@
 struct _SpellCheckerRunner;
 typedef struct _SpellCheckerRunner *SpellCheckerRunnerHandle;
 
+/*
+ * The default and maximal number of messages waiting in the runner's queue.
+ */
+#define SCR_DEFAULT_QUEUE_DEPTH 1024
+#define SCR_MAX_QUEUE_DEPTH (1 << 20)
+
+/**
+ * Create an executor: a pool of worker threads that any number of runners can
+ * run on, instead of having a thread each (see scrInit()).
+ * @param numThreads the number of threads, 0 for one per online CPU.
+ * @return the executor, or NULL on failure.
+ */
+SpellCheckerPoolHandle scrExecutorInit(unsigned int numThreads);
+
+/**
+ * Finalize an executor. The runners using it must be finalized first.
+ */
+void scrExecutorFinalize(SpellCheckerPoolHandle executor);
+
 /**
  * Initialize the runner.
- * This creates a thread that is waiting for commands.
+ * This creates a thread that is waiting for commands, unless the runner runs
+ * on an executor, in which case the messages posted to the runner are
+ * processed (still one at a time, in order) by the executor's threads.
+ * @param data the data model to operate on. The runner takes ownership of it,
+ * and finalizes it in scrFinalize().
+ * @param queueDepth the number of messages the queue holds, rounded up to a
+ * power of two (and capped at SCR_MAX_QUEUE_DEPTH), or 0 for
+ * SCR_DEFAULT_QUEUE_DEPTH.
+ * @param policy what adding words or posting a spell-check does when the queue
+ * is full. The other operations always wait for room.
+ * @param cacheSize the size in bytes of the lookup cache of each thread making
+ * lookups (see spell-checker_data_cache.h), 0 for none.
+ * @param executor the executor to run on (see scrExecutorInit()), NULL for a
+ * thread of its own.
  */
-SpellCheckerRunnerHandle scrInit(void);
+SpellCheckerRunnerHandle scrInit(SpellCheckerDataHandle data,
+                                 size_t queueDepth,
+                                 SpellCheckerQueuePolicy policy,
+                                 size_t cacheSize,
+                                 SpellCheckerPoolHandle executor);
 
 /**
- * Finalize the runner.
+ * Finalize the runner, along with the lookup caches of all the threads.
  * @param runner destroy the given runner. This object should not be used again
  * after calling this function.
  * @return 0 on success, -1 on failure
@@ -30,18 +70,274 @@ int scrFinalize(SpellCheckerRunnerHandle runner);
  * Add a word to the dictionary.
  * @param runner the runner to use.
  * @param word the word to add.
- * @return 0 on success, -1 on failure
+ * @return 0 on success (including when dropped because the queue is full),
+ * -1 on failure
  */
 int scrAddWord(SpellCheckerRunnerHandle runner, const char *word);
 
+/**
+ * Add a word to the dictionary, along with its frequency.
+ * @param runner the runner to use.
+ * @param word the word to add.
+ * @param frequency the frequency of the word (see scdAddWordWithFrequency()).
+ * @return 0 on success (including when dropped because the queue is full),
+ * -1 on failure
+ */
+int scrAddWordWithFrequency(SpellCheckerRunnerHandle runner, const char *word,
+                            unsigned int frequency);
+
+/**
+ * Add a batch of newline-separated words to the dictionary, as a single
+ * operation.
+ * @param runner the runner to use.
+ * @param buf the words.
+ * @param len the size of buf, in bytes.
+ * @return 0 on success (including when dropped because the queue is full),
+ * -1 on failure
+ */
+int scrAddWords(SpellCheckerRunnerHandle runner, const char *buf, size_t len);
+
+/**
+ * Remove a word from the dictionary (see scdRemoveWord()).
+ * @param runner the runner to use.
+ * @param word the word to remove.
+ * @return 0 on success (including when dropped because the queue is full),
+ * -1 on failure
+ */
+int scrRemoveWord(SpellCheckerRunnerHandle runner, const char *word);
+
+/**
+ * Replace the data model of a runner with the one of another runner, at once.
+ * The other runner is stopped once it processed the messages posted to it, and
+ * its data model is published to the readers of this one with a single
+ * pointer store, once this runner processed the messages posted before. The
+ * lookups and checks that started before keep using the previous data model,
+ * which is finalized once they are all done. Must not be called from the
+ * thread of either runner (i.e. from a callback).
+ * @param runner the runner whose data model is replaced.
+ * @param from the runner providing the new data model. It is finalized unless
+ * -1 is returned, and should not be used again.
+ * @return 0 on success, -1 on failure (in which case both runners are left
+ * untouched), 1 if the new data model could not be swapped in once from was
+ * stopped (in which case from is finalized, and runner left untouched).
+ */
+int scrSwap(SpellCheckerRunnerHandle runner, SpellCheckerRunnerHandle from);
+
+/**
+ * @return the data model of the runner, which stays valid as long as the
+ * runner and no swap replaces it (see scrSwap()).
+ */
+SpellCheckerDataHandle scrGetData(SpellCheckerRunnerHandle runner);
+
 /**
  * Run a spell-check on the given text.
  * @param runner the runner to use.
  * @param text the text to check for errors.
  * @param callback the callback to use for notifying about invalid words.
- * @return 0 on success, -1 on failure
+ * @return 0 on success (including when dropped because the queue is full),
+ * -1 on failure
  */
 int scrRunSpellCheck(SpellCheckerRunnerHandle runner, const char *text,
                      SpellCheckerCallback callback);
 
+/**
+ * Run a spell-check on a copy of the given text, tracked by a job.
+ * @param runner the runner to use.
+ * @param text the text to check for errors, not necessarily null-terminated.
+ * @param len the size of the text.
+ * @param callback the callback to use for notifying about invalid words.
+ * @param onComplete called once the job is done or cancelled, may be NULL.
+ * @param userdata passed to the callbacks.
+ * @return the job, to be released with scrJobRelease(), or NULL on failure. A
+ * job dropped because the queue is full is returned already cancelled.
+ */
+SpellCheckerJobHandle scrStartSpellCheck(SpellCheckerRunnerHandle runner,
+                                         const char *text, size_t len,
+                                         SpellCheckerSpanCallback callback,
+                                         SpellCheckerJobCallback onComplete,
+                                         void *userdata);
+
+/**
+ * @return the current status of the job.
+ */
+SpellCheckerJobStatus scrJobGetStatus(SpellCheckerJobHandle job);
+
+/**
+ * Spell-check a file, in place: the file is mapped read-only, and its words
+ * are reported from the mapping, without copying it. Like a job, the check
+ * runs on the runner's thread (in parallel if enabled, see
+ * scrSetParallelism()), once the previously posted operations are done, but
+ * this function waits for it to be done. Must not be called from the runner's
+ * thread (i.e. from a callback).
+ * @param runner the runner to use.
+ * @param path the file to check.
+ * @param callback the callback to use for notifying about invalid words, with
+ * their offset in the file.
+ * @param userdata passed to the callback.
+ * @return 0 once the whole file was checked, -1 on failure (including when
+ * dropped because the queue is full).
+ */
+int scrCheckFile(SpellCheckerRunnerHandle runner, const char *path,
+                 SpellCheckerSpanCallback callback, void *userdata);
+
+/**
+ * Wait for a job to be done or cancelled.
+ * @param job the job to wait for.
+ * @param timeoutMs the maximal time to wait, in milliseconds, or a negative
+ * value to wait for as long as it takes.
+ * @return 0 if the job is done or cancelled, -1 on timeout or failure.
+ */
+int scrJobWait(SpellCheckerJobHandle job, long timeoutMs);
+
+/**
+ * Cancel a job. A job that did not start yet is cancelled immediately, a
+ * running one stops reporting misspellings shortly after.
+ * @param job the job to cancel.
+ * @return 0 on success, -1 on failure
+ */
+int scrJobCancel(SpellCheckerJobHandle job);
+
+/**
+ * Release the caller's reference to a job. The job still runs to completion.
+ * @param job the job to release, may be NULL.
+ */
+void scrJobRelease(SpellCheckerJobHandle job);
+
+/**
+ * Spell-check the given text from the caller's thread, without copying nor
+ * modifying it. Like scrHasWord(), it does not wait for the runner nor blocks
+ * it.
+ * @param runner the runner to use.
+ * @param text the text to check for errors, not necessarily null-terminated.
+ * @param len the size of the text.
+ * @param callback the callback to use for notifying about invalid words, called
+ * from the caller's thread before this function returns.
+ * @param userdata passed to the callback.
+ * @return 0 on success, -1 on failure
+ */
+int scrCheckSpan(SpellCheckerRunnerHandle runner, const char *text, size_t len,
+                 SpellCheckerSpanCallback callback, void *userdata);
+
+/**
+ * Check whether a word is in the dictionary, from the caller's thread. Does not
+ * wait for the runner (nor for the messages still in its queue), and never
+ * blocks it: any number of threads can look up words concurrently, and
+ * concurrently with the runner adding words.
+ * @param runner the runner to use.
+ * @param word the word to look up.
+ * @return 1 if the word is in the dictionary, 0 if not, -1 on failure.
+ */
+int scrHasWord(SpellCheckerRunnerHandle runner, const char *word);
+
+/**
+ * Same as scrHasWord(), for a batch of words, which are looked up together
+ * (see scdHasWords()). The lookup caches are not used.
+ * @param runner the runner to use.
+ * @param words the words to look up, not necessarily null-terminated.
+ * @param lens the lengths of the words.
+ * @param numWords the number of words.
+ * @param results set to 1 for each word in the dictionary, 0 for the others.
+ * @return 0 on success, -1 on failure.
+ */
+int scrHasWords(SpellCheckerRunnerHandle runner, const char **words,
+                const size_t *lens, size_t numWords, uint8_t *results);
+
+/**
+ * Find the words of the dictionary closest to the given one, from the caller's
+ * thread. Like scrHasWord(), does not wait for the runner nor blocks it.
+ * @param runner the runner to use.
+ * @param word the word to find suggestions for.
+ * @param maxDistance the maximal edit distance of a suggestion.
+ * @param maxResults the maximal number of suggestions.
+ * @param out filled with the suggestions, to be released with free().
+ * @return the number of suggestions, or -1 on failure.
+ */
+int scrSuggest(SpellCheckerRunnerHandle runner, const char *word,
+               unsigned int maxDistance, size_t maxResults, char **out);
+
+/**
+ * Check if any word of the dictionary starts with the given prefix, from the
+ * caller's thread. Like scrHasWord(), does not wait for the runner nor blocks
+ * it.
+ * @param runner the runner to use.
+ * @param prefix the prefix to look for.
+ * @return 1 if a word starts with the prefix, 0 if none does, -1 on failure.
+ */
+int scrHasPrefix(SpellCheckerRunnerHandle runner, const char *prefix);
+
+/**
+ * Find the first words of the dictionary, in alphabetical order, that start
+ * with the given prefix, from the caller's thread (see scrHasPrefix()).
+ * @param runner the runner to use.
+ * @param prefix the prefix of the words.
+ * @param maxResults the maximal number of words.
+ * @param out filled with the words, to be released with free().
+ * @return the number of words, or -1 on failure.
+ */
+int scrComplete(SpellCheckerRunnerHandle runner, const char *prefix,
+                size_t maxResults, char **out);
+
+/**
+ * Get the counters of the lookup caches, summed over all the threads.
+ * @param runner the runner to use.
+ * @param hits set to the number of lookups answered by a cache.
+ * @param misses set to the number of lookups made in the dictionary.
+ * @return 0 on success, -1 on failure
+ */
+int scrGetCacheStats(SpellCheckerRunnerHandle runner, uint64_t *hits,
+                     uint64_t *misses);
+
+/*
+ * The counters of a runner, see scrGetStats().
+ */
+typedef struct ScrStats
+{
+    /* The size of the data model, as of the last message processed */
+    size_t numWords;
+    size_t numNodes;
+    size_t bytes;
+
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    uint64_t numMessages;
+    uint64_t numTokens;
+    uint64_t numMisspellings;
+    uint64_t busyNs;
+} ScrStats;
+
+/**
+ * Get the counters of the runner. They are kept by the threads that update
+ * them, and summed on read, so each counter is consistent on its own, but
+ * they may not all be from the same instant.
+ * @param runner the runner to use.
+ * @param stats set to the counters.
+ * @return 0 on success, -1 on failure
+ */
+int scrGetStats(SpellCheckerRunnerHandle runner, ScrStats *stats);
+
+/*
+ * The maximal number of worker threads for a parallel spell-check.
+ */
+#define SCR_MAX_PARALLELISM 256
+
+/**
+ * Set the number of threads used to spell-check large texts. Takes effect
+ * for the spell-checks posted after this call.
+ * @param runner the runner to use.
+ * @param numThreads 1 to check on the runner's thread only (the default), 0 to
+ * use one thread per online CPU. Capped at SCR_MAX_PARALLELISM.
+ * @return 0 on success, -1 on failure
+ */
+int scrSetParallelism(SpellCheckerRunnerHandle runner, unsigned int numThreads);
+
+/**
+ * Compile the dictionary into an image file, once all the previously posted
+ * operations are done. Unlike the other operations, this one is synchronous.
+ * Must not be called from the runner's thread (i.e. from a callback).
+ * @param runner the runner to use.
+ * @param path the file to write the image to.
+ * @return 0 on success, -1 on failure
+ */
+int scrCompile(SpellCheckerRunnerHandle runner, const char *path);
+
 #endif
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spell-checker_stream.h"
+#include "spell-checker_data.h"
+#include "spell-checker_tokenizer.h"
+#include "spell-checker_unicode.h"
+
+struct _SpellCheckerStream
+{
+    SpellCheckerRunnerHandle runner;
+    SpellCheckerSpanCallback callback;
+    void *userdata;
+
+    /* The offset of the next chunk from the start of the stream */
+    size_t pos;
+
+    /* The offset of the chunk being checked, added to the reported ones */
+    size_t base;
+
+    /*
+     * The word the previous chunk ended in the middle of: its first wordLen
+     * bytes (at most SCS_MAX_WORD_LEN), and its length so far.
+     */
+    size_t wordOffset;
+    size_t wordLen;
+    size_t wordTotalLen;
+    char word[SCS_MAX_WORD_LEN];
+};
+
+static void scsReport(const char *word, size_t length, size_t offset,
+                      void *userdata)
+{
+    SpellCheckerStreamHandle stream = userdata;
+    stream->callback(word, length, stream->base + offset, stream->userdata);
+}
+
+/*
+ * Check the given text, whose offset in the stream is base.
+ */
+static int scsCheck(SpellCheckerStreamHandle stream, const char *text,
+                    size_t len, size_t base)
+{
+    stream->base = base;
+    return scrCheckSpan(stream->runner, text, len, scsReport, stream);
+}
+
+/*
+ * Check the carried word, now that it is complete.
+ */
+static int scsFlushWord(SpellCheckerStreamHandle stream)
+{
+    if (!stream->wordTotalLen)
+        return 0;
+
+    int ret = 0;
+    if (stream->wordTotalLen > stream->wordLen)
+        stream->callback(stream->word, stream->wordLen, stream->wordOffset,
+                         stream->userdata);
+    else
+        ret = scsCheck(stream, stream->word, stream->wordLen,
+                       stream->wordOffset);
+
+    stream->wordLen = 0;
+    stream->wordTotalLen = 0;
+    return ret;
+}
+
+/*
+ * Carry text (made of word characters only, or of a sequence the chunk cuts)
+ * over to the next chunk.
+ */
+static void scsCarry(SpellCheckerStreamHandle stream, const char *text,
+                     size_t len, size_t offset)
+{
+    if (!stream->wordTotalLen)
+        stream->wordOffset = offset;
+    stream->wordTotalLen += len;
+
+    const size_t room = SCS_MAX_WORD_LEN - stream->wordLen;
+    const size_t copied = (len < room) ? len : room;
+    memcpy(&stream->word[stream->wordLen], text, copied);
+    stream->wordLen += copied;
+}
+
+/*
+ * @return the length of the word characters text starts with, per the rules
+ * of the data model (see scdIsUtf8()).
+ */
+static size_t scsWordPrefix(int isUtf8, const char *text, size_t len)
+{
+    size_t end = 0;
+    if (!isUtf8)
+    {
+        while ((end < len) && sctIsWordChar(text[end]))
+            ++end;
+        return end;
+    }
+
+    /* A sequence the chunk cuts is made of invalid bytes, word characters */
+    while (end < len)
+    {
+        uint32_t cp;
+        const size_t charLen = scuDecode(&text[end], len - end, &cp);
+        if (!scuIsWordChar(cp))
+            break;
+        end += charLen;
+    }
+    return end;
+}
+
+/*
+ * @return the offset of the word characters text[begin..len) ends with (len if
+ * none), per the rules of the data model (see scdIsUtf8()).
+ */
+static size_t scsWordSuffix(int isUtf8, const char *text, size_t begin,
+                            size_t len)
+{
+    size_t end = len;
+    if (!isUtf8)
+    {
+        while ((end > begin) && sctIsWordChar(text[end - 1]))
+            --end;
+        return end;
+    }
+
+    while (end > begin)
+    {
+        /*
+         * The last character starts at the closest lead byte, at most 3 bytes
+         * back. Decoded from there, the text splits the same way as when
+         * decoded from its start: unless the sequence ends right at end, the
+         * last byte is an invalid one, a character of its own (like the last
+         * bytes of a sequence the chunk cuts, which are then carried).
+         */
+        size_t start = end - 1;
+        while ((start > begin) && (end - start < 4) &&
+               (0x80 == ((unsigned char)text[start] & 0xC0)))
+            --start;
+
+        uint32_t cp;
+        if (start + scuDecode(&text[start], end - start, &cp) != end)
+        {
+            start = end - 1;
+            cp = SCU_INVALID;
+        }
+        if (!scuIsWordChar(cp))
+            break;
+        end = start;
+    }
+    return end;
+}
+
+SpellCheckerStreamHandle scsInit(SpellCheckerRunnerHandle runner,
+                                 SpellCheckerSpanCallback callback,
+                                 void *userdata)
+{
+    if (!runner || !callback)
+    {
+        printf("Illegal argument(s) passed to scsInit\n");
+        return NULL;
+    }
+
+    SpellCheckerStreamHandle stream =
+        malloc(sizeof(struct _SpellCheckerStream));
+    if (!stream)
+    {
+        printf("Failed allocating memory for SpellCheckerStreamHandle\n");
+        return NULL;
+    }
+
+    stream->runner = runner;
+    stream->callback = callback;
+    stream->userdata = userdata;
+    stream->pos = 0;
+    stream->base = 0;
+    stream->wordOffset = 0;
+    stream->wordLen = 0;
+    stream->wordTotalLen = 0;
+
+    return stream;
+}
+
+int scsFeed(SpellCheckerStreamHandle stream, const char *chunk, size_t len)
+{
+    if (!stream || (!chunk && len))
+    {
+        printf("Illegal argument(s) passed to scsFeed\n");
+        return -1;
+    }
+
+    /* The end of the carried word, if any */
+    const int isUtf8 = scdIsUtf8(scrGetData(stream->runner));
+    size_t begin = 0;
+    if (stream->wordTotalLen)
+    {
+        begin = scsWordPrefix(isUtf8, chunk, len);
+        scsCarry(stream, chunk, begin, stream->pos);
+        if ((begin < len) && (-1 == scsFlushWord(stream)))
+            return -1;
+    }
+
+    /* The word the chunk ends with may go on in the next one */
+    const size_t end = scsWordSuffix(isUtf8, chunk, begin, len);
+
+    int ret = 0;
+    if (end > begin)
+        ret = scsCheck(stream, &chunk[begin], end - begin, stream->pos + begin);
+    if (end < len)
+        scsCarry(stream, &chunk[end], len - end, stream->pos + end);
+
+    stream->pos += len;
+    return ret;
+}
+
+int scsFinalize(SpellCheckerStreamHandle stream)
+{
+    if (!stream)
+    {
+        printf("Illegal argument(s) passed to scsFinalize\n");
+        return -1;
+    }
+
+    const int ret = scsFlushWord(stream);
+    free(stream);
+    return ret;
+}
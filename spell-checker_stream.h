@@ -0,0 +1,58 @@
+#ifndef __SPELL_CHECKER_STREAM_H
+#define __SPELL_CHECKER_STREAM_H
+
+#include <stddef.h>
+
+#include "spell-checker.h"
+#include "spell-checker_runner.h"
+
+/**
+ * A spell-check of a text given in chunks, of any size, as it is read.
+ *
+ * The chunks are checked synchronously, from the caller's thread (see
+ * scrCheckSpan()), and are not copied: only the word a chunk ends in the
+ * middle of is, to be completed by the next chunk. That copy has a fixed size,
+ * so a stream checks any amount of text in constant memory.
+ *
+ * A stream is not thread-safe, but any number of streams can be checked at
+ * once.
+ */
+
+/*
+ * The longest word a stream carries over from a chunk to the next. A longer
+ * word is reported as misspelled, truncated to its first SCS_MAX_WORD_LEN
+ * bytes.
+ */
+#define SCS_MAX_WORD_LEN 4096
+
+/**
+ * Start a stream.
+ * @param runner the runner whose dictionary the words are looked up in.
+ * @param callback called for each misspelled word, with its offset from the
+ * start of the stream.
+ * @param userdata passed as is to the callback.
+ * @return a handle to the stream, or NULL on failure.
+ */
+SpellCheckerStreamHandle scsInit(SpellCheckerRunnerHandle runner,
+                                 SpellCheckerSpanCallback callback,
+                                 void *userdata);
+
+/**
+ * Check the next chunk of the text. The misspelled words it completes are
+ * reported before this function returns, except for the one it ends with,
+ * which the next chunk may continue.
+ * @param stream the stream to use.
+ * @param chunk the chunk, it does not have to be null-terminated.
+ * @param len the size of the chunk, in bytes.
+ * @return 0 on success, -1 on failure.
+ */
+int scsFeed(SpellCheckerStreamHandle stream, const char *chunk, size_t len);
+
+/**
+ * Check the last word of the text, and release the stream.
+ * @param stream the stream to use. The handle becomes invalid.
+ * @return 0 on success, -1 on failure.
+ */
+int scsFinalize(SpellCheckerStreamHandle stream);
+
+#endif
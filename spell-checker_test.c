@@ -1,12 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "spell-checker.h"
 
 #define DICTIONARY_FILE "dictionary.txt"
 #define TEST_FILE "trie.txt"
+#define IMAGE_FILE "dictionary.img"
+#define PARALLEL_TEST_FILE "parallel.txt"
+#define PARALLEL_TEST_SIZE (4 * 1024 * 1024)
+#define PARALLEL_TEST_THREADS 4
+#define LOOKUP_TEST_THREADS 4
+#define LOOKUP_TEST_BATCHES 50
+#define LOOKUP_TEST_BATCH_SIZE 100
+#define LOOKUP_CACHE_SIZE (64 * 1024)
 
 static long getFileSize(FILE *file)
 {
@@ -25,7 +38,25 @@ static long getFileSize(FILE *file)
     return fsize;
 }
 
-static SpellCheckerDictionaryHandle loadDictionary(const char *dictFileName)
+/*
+ * Words are added asynchronously: wait until the given word is visible to
+ * lookups (and with it, every word added before it).
+ */
+static int waitForWord(SpellCheckerDictionaryHandle dict, const char *word)
+{
+    const struct timespec pollInterval = { 0, 10 * 1000 * 1000 };
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (1 == spellCheckerHasWord(dict, word))
+            return 0;
+        nanosleep(&pollInterval, NULL);
+    }
+    printf("Added word '%s' is not visible\n", word);
+    return -1;
+}
+
+static SpellCheckerDictionaryHandle loadDictionary(
+    const char *dictFileName, const SpellCheckerOptions *options)
 {
     FILE *dictFile = fopen(dictFileName, "r");
     if (!dictFile)
@@ -42,7 +73,8 @@ static SpellCheckerDictionaryHandle loadDictionary(const char *dictFileName)
         return NULL;
     }
 
-    SpellCheckerDictionaryHandle dict = createSpellCheckerDictionary();
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(options);
     if (!dict)
     {
         printf("Failed creating dictionary\n");
@@ -52,47 +84,65 @@ static SpellCheckerDictionaryHandle loadDictionary(const char *dictFileName)
 
     printf("Loading words to dictionary...\n");
 
-    char * line = NULL;
-    size_t len = 0;
-    ssize_t read;
-    ssize_t totalRead = 0;
-    size_t numWords = 0;
-    while ((read = getline(&line, &len, dictFile)) != -1)
+    char *words = malloc(fsize + 1);
+    if (!words)
     {
-        if (SIZE_MAX == numWords)
-        {
-            printf("\nReached maximum size. Will not add more words\n");
-            break;
-        }
-        line[read-1] = '\0';
-        if (-1 == spellCheckerAddWord(dict, line))
-        {
-            printf("\nFailed adding word to spell checker. Bailing...\n");
-            closeSpellCheckerDictionary(dict);
-            fclose(dictFile);
-            return NULL;
-        }
-        totalRead += read;
-        ++numWords;
+        printf("Failed malloc-ing memory\n");
+        closeSpellCheckerDictionary(dict);
+        fclose(dictFile);
+        return NULL;
+    }
+    const size_t bread = fread(words, 1, fsize, dictFile);
+    fclose(dictFile);
+    if (bread != (size_t)fsize)
+    {
+        printf("Failed reading from file (%zu/%ld bytes read)\n", bread, fsize);
+        free(words);
+        closeSpellCheckerDictionary(dict);
+        return NULL;
+    }
 
-        if (0 == (totalRead % 10000))
-        {
-            printf("%d%%\r", totalRead*100/fsize);
-            fflush(stdout);
-        }
+    if (-1 == spellCheckerAddWords(dict, words, fsize))
+    {
+        printf("Failed adding words to spell checker. Bailing...\n");
+        free(words);
+        closeSpellCheckerDictionary(dict);
+        return NULL;
     }
 
-    free(line);
-    fclose(dictFile);
+    size_t numWords = 0;
+    for (long i = 0; i < fsize; ++i)
+    {
+        if ('\n' == words[i])
+            ++numWords;
+    }
 
-    printf("100%\n%zu words added to dictionary\n", numWords);
+    /* Wait for the whole batch to be processed, using its last word */
+    long end = fsize;
+    while ((end > 0) && (('\n' == words[end - 1]) || ('\r' == words[end - 1])))
+        --end;
+    words[end] = '\0';
+    long start = end;
+    while ((start > 0) && ('\n' != words[start - 1]))
+        --start;
+    const int ret = (start < end) ? waitForWord(dict, &words[start]) : 0;
+    free(words);
+    if (-1 == ret)
+    {
+        closeSpellCheckerDictionary(dict);
+        return NULL;
+    }
+
+    printf("%zu words added to dictionary\n", numWords);
 
     return dict;
 }
 
-void callback(const char *word)
+void callback(const char *word, size_t length, size_t offset, void *userdata)
 {
-    printf("Got a misspelled word: %s\n", word);
+    (void)offset;
+    (void)userdata;
+    printf("Got a misspelled word: %.*s\n", (int)length, word);
 }
 
 static int testSpellChecker(SpellCheckerDictionaryHandle dict)
@@ -121,40 +171,1473 @@ static int testSpellChecker(SpellCheckerDictionaryHandle dict)
     }
     const size_t bread = fread(strToTest, 1, fsize, file);
     fclose(file);
-    if (bread != fsize)
+    if (bread != (size_t)fsize)
     {
-        printf("Failed reading from file (%zu/%zu bytes read)\n", bread, fsize);
+        printf("Failed reading from file (%zu/%ld bytes read)\n", bread, fsize);
         free(strToTest);
         return -1;
     }
     strToTest[fsize] = '\0';
-    spellCheck(dict, strToTest, callback);
-    sleep(5);
+    const int ret = spellCheckSpan(dict, strToTest, fsize, callback, NULL);
     free(strToTest);
+    return ret;
+}
+
+static size_t numMisspellings;
+static uint64_t misspellingsDigest;
+
+/*
+ * Digest the misspelled words in the order they are reported, so that both
+ * the words and their order are compared.
+ */
+static void digestWord(const char *word, size_t length)
+{
+    ++numMisspellings;
+    for (size_t i = 0; i < length; ++i)
+        misspellingsDigest = (misspellingsDigest ^ (unsigned char)word[i]) *
+            1099511628211ULL;
+    misspellingsDigest = (misspellingsDigest ^ '\n') * 1099511628211ULL;
+}
+
+static void digestCallback(const char *word)
+{
+    digestWord(word, strlen(word));
+}
+
+static void digestSpanCallback(const char *word, size_t length, size_t offset,
+                               void *userdata)
+{
+    /* The word must point into the text */
+    if (word == (const char*)userdata + offset)
+        digestWord(word, length);
+}
+
+/*
+ * For streams, the word may have been copied, if it spans chunks.
+ */
+static void digestStreamCallback(const char *word, size_t length,
+                                 size_t offset, void *userdata)
+{
+    if (!memcmp(word, (const char*)userdata + offset, length))
+        digestWord(word, length);
+}
+
+/*
+ * Feed the text to a stream in chunks of various sizes, some of them smaller
+ * than a word.
+ */
+static int streamText(SpellCheckerDictionaryHandle dict, const char *text,
+                      size_t len)
+{
+    static const size_t chunkSizes[] = { 1, 7, 3, 4096, 13, 65536, 2 };
+    SpellCheckerStreamHandle stream =
+        spellCheckBegin(dict, digestStreamCallback, (void*)text);
+    if (!stream)
+        return -1;
+
+    int ret = 0;
+    size_t pos = 0;
+    for (size_t i = 0; (0 == ret) && (pos < len); ++i)
+    {
+        size_t chunkSize = chunkSizes[i % (sizeof(chunkSizes) /
+                                           sizeof(chunkSizes[0]))];
+        if (chunkSize > len - pos)
+            chunkSize = len - pos;
+        ret = spellCheckFeed(stream, &text[pos], chunkSize);
+        pos += chunkSize;
+    }
+
+    if (-1 == spellCheckEnd(stream))
+        ret = -1;
+    return ret;
+}
+
+/*
+ * For asynchronous jobs, the word points into a copy of the text.
+ */
+static void digestJobCallback(const char *word, size_t length, size_t offset,
+                              void *userdata)
+{
+    (void)offset;
+    (void)userdata;
+    digestWord(word, length);
+}
+
+static void ignoreCallback(const char *word, size_t length, size_t offset,
+                           void *userdata)
+{
+    (void)word;
+    (void)length;
+    (void)offset;
+    (void)userdata;
+}
+
+static void countSpanCallback(const char *word, size_t length, size_t offset,
+                              void *userdata)
+{
+    (void)word;
+    (void)length;
+    (void)offset;
+    ++*(int*)userdata;
+}
+
+static int numCompletions;
+static SpellCheckerJobStatus completionStatus;
+
+static void onJobComplete(SpellCheckerJobHandle job,
+                          SpellCheckerJobStatus status, void *userdata)
+{
+    (void)job;
+    (void)userdata;
+    ++numCompletions;
+    completionStatus = status;
+}
+
+/*
+ * Wait for all the operations posted so far, they are run in order.
+ */
+static int waitForQueue(SpellCheckerDictionaryHandle dict)
+{
+    SpellCheckerJobHandle job =
+        spellCheckAsync(dict, "", 0, ignoreCallback, NULL, NULL);
+    if (!job)
+        return -1;
+    const int ret = spellCheckerJobWait(job, -1);
+    spellCheckerJobRelease(job);
+    return ret;
+}
+
+/*
+ * Cancel a job that is queued behind a long one.
+ */
+static int testCancelJob(SpellCheckerDictionaryHandle dict, const char *text,
+                         size_t len)
+{
+    numCompletions = 0;
+    SpellCheckerJobHandle running =
+        spellCheckAsync(dict, text, len, ignoreCallback, NULL, NULL);
+    SpellCheckerJobHandle pending =
+        spellCheckAsync(dict, text, len, ignoreCallback, onJobComplete, NULL);
+    if (!running || !pending)
+    {
+        printf("Failed starting spell-check jobs\n");
+        spellCheckerJobRelease(running);
+        spellCheckerJobRelease(pending);
+        return -1;
+    }
+
+    int ret = 0;
+    spellCheckerJobCancel(pending);
+    if ((0 != spellCheckerJobWait(pending, 0)) ||
+        (SPELL_CHECKER_JOB_CANCELLED != spellCheckerJobGetStatus(pending)) ||
+        (1 != numCompletions) ||
+        (SPELL_CHECKER_JOB_CANCELLED != completionStatus))
+    {
+        printf("Pending job was not cancelled\n");
+        ret = -1;
+    }
+
+    spellCheckerJobCancel(running);
+    if (0 != spellCheckerJobWait(running, -1))
+    {
+        printf("Failed waiting for cancelled job\n");
+        ret = -1;
+    }
+
+    spellCheckerJobRelease(running);
+    spellCheckerJobRelease(pending);
+    return ret;
+}
+
+static int testParallelSpellChecker(SpellCheckerDictionaryHandle dict)
+{
+    FILE *file = fopen(TEST_FILE, "r");
+    if (!file)
+    {
+        printf("Failed opening file '%s'\n", TEST_FILE);
+        return -1;
+    }
+
+    const long fsize = getFileSize(file);
+    if (fsize <= 0)
+    {
+        printf("Failed finding test file size\n");
+        fclose(file);
+        return -1;
+    }
+
+    /* Repeat the test file to get a text that is large enough to be split */
+    char *strToTest = malloc(PARALLEL_TEST_SIZE + 1);
+    if (!strToTest)
+    {
+        printf("Failed malloc-ing memory\n");
+        fclose(file);
+        return -1;
+    }
+    size_t len = 0;
+    while (len + fsize <= PARALLEL_TEST_SIZE)
+    {
+        rewind(file);
+        if (fread(&strToTest[len], 1, fsize, file) != (size_t)fsize)
+        {
+            printf("Failed reading from file\n");
+            free(strToTest);
+            fclose(file);
+            return -1;
+        }
+        len += fsize;
+    }
+    fclose(file);
+    strToTest[len] = '\0';
+
+    numMisspellings = 0;
+    misspellingsDigest = 14695981039346656037ULL;
+    spellCheck(dict, strToTest, digestCallback);
+    waitForQueue(dict);
+    const size_t serialMisspellings = numMisspellings;
+    const uint64_t serialDigest = misspellingsDigest;
+
+    numMisspellings = 0;
+    misspellingsDigest = 14695981039346656037ULL;
+    numCompletions = 0;
+    spellCheckerSetParallelism(dict, PARALLEL_TEST_THREADS);
+    SpellCheckerJobHandle job = spellCheckAsync(dict, strToTest, len,
+                                                digestJobCallback,
+                                                onJobComplete, NULL);
+    spellCheckerSetParallelism(dict, 1);
+    if (!job || (0 != spellCheckerJobWait(job, -1)) ||
+        (SPELL_CHECKER_JOB_DONE != spellCheckerJobGetStatus(job)) ||
+        (1 != numCompletions) || (SPELL_CHECKER_JOB_DONE != completionStatus))
+    {
+        printf("Spell-check job did not complete\n");
+        spellCheckerJobRelease(job);
+        free(strToTest);
+        return -1;
+    }
+    spellCheckerJobRelease(job);
+    const size_t parallelMisspellings = numMisspellings;
+    const uint64_t parallelDigest = misspellingsDigest;
+
+    numMisspellings = 0;
+    misspellingsDigest = 14695981039346656037ULL;
+    spellCheckSpan(dict, strToTest, len, digestSpanCallback, strToTest);
+    const size_t spanMisspellings = numMisspellings;
+    const uint64_t spanDigest = misspellingsDigest;
+
+    numMisspellings = 0;
+    misspellingsDigest = 14695981039346656037ULL;
+    const int streamRet = streamText(dict, strToTest, len);
+    const size_t streamMisspellings = numMisspellings;
+    const uint64_t streamDigest = misspellingsDigest;
+
+    /* The same text, mapped from a file, and checked in parallel */
+    numMisspellings = 0;
+    misspellingsDigest = 14695981039346656037ULL;
+    int fileRet = -1;
+    file = fopen(PARALLEL_TEST_FILE, "w");
+    if (file)
+    {
+        const size_t written = fwrite(strToTest, 1, len, file);
+        if ((0 == fclose(file)) && (written == len))
+        {
+            spellCheckerSetParallelism(dict, PARALLEL_TEST_THREADS);
+            fileRet = spellCheckFile(dict, PARALLEL_TEST_FILE,
+                                     digestStreamCallback, strToTest);
+            spellCheckerSetParallelism(dict, 1);
+        }
+        remove(PARALLEL_TEST_FILE);
+    }
+
+    const int cancelRet = testCancelJob(dict, strToTest, len);
+    free(strToTest);
+    if ((-1 == cancelRet) || (-1 == streamRet) || (-1 == fileRet))
+        return -1;
+
+    printf("%zu misspellings in %zu bytes (serial), %zu (parallel), "
+           "%zu (span), %zu (stream), %zu (file)\n", serialMisspellings, len,
+           parallelMisspellings, spanMisspellings, streamMisspellings,
+           numMisspellings);
+    if ((parallelMisspellings != serialMisspellings) ||
+        (parallelDigest != serialDigest))
+    {
+        printf("Parallel spell-check differs from serial spell-check\n");
+        return -1;
+    }
+    if ((spanMisspellings != serialMisspellings) ||
+        (spanDigest != serialDigest))
+    {
+        printf("Span spell-check differs from serial spell-check\n");
+        return -1;
+    }
+    if ((streamMisspellings != serialMisspellings) ||
+        (streamDigest != serialDigest))
+    {
+        printf("Streamed spell-check differs from serial spell-check\n");
+        return -1;
+    }
+    if ((numMisspellings != serialMisspellings) ||
+        (misspellingsDigest != serialDigest))
+    {
+        printf("File spell-check differs from serial spell-check\n");
+        return -1;
+    }
     return 0;
 }
 
-int main(void)
+typedef struct LookupTest
+{
+    SpellCheckerDictionaryHandle dict;
+    char **words;
+    size_t numWords;
+    int stop;
+    size_t lookups;
+    size_t failures;
+} LookupTest;
+
+/*
+ * Look up the dictionary words over and over, until told to stop. They must
+ * all be found, whatever the writer is doing.
+ */
+static void *lookupWords(void *arg)
+{
+    LookupTest *test = arg;
+    size_t lookups = 0;
+    size_t failures = 0;
+    while (!__atomic_load_n(&test->stop, __ATOMIC_ACQUIRE))
+    {
+        for (size_t i = 0; i < test->numWords; ++i, ++lookups)
+        {
+            if (1 != spellCheckerHasWord(test->dict, test->words[i]))
+                ++failures;
+        }
+    }
+    __atomic_add_fetch(&test->lookups, lookups, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&test->failures, failures, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/*
+ * Look the words up in one batch, each followed by a misspelled variant of
+ * it, and compare with looking them up one by one.
+ */
+static int testHasWords(SpellCheckerDictionaryHandle dict, char **words,
+                        size_t numWords)
 {
-    /* TODO: load words to same dictionary from multiple thread to test and
-       validate multi-threaded code. */
-    SpellCheckerDictionaryHandle dict = loadDictionary(DICTIONARY_FILE);
+    const size_t num = 2 * numWords;
+    const char **batch = malloc(num * sizeof(char*));
+    size_t *lens = malloc(num * sizeof(size_t));
+    uint8_t *results = malloc(num);
+    if (!batch || !lens || !results)
+    {
+        printf("Failed malloc-ing memory\n");
+        free(batch);
+        free(lens);
+        free(results);
+        return -1;
+    }
+
+    for (size_t i = 0; i < numWords; ++i)
+    {
+        batch[2 * i] = words[i];
+        lens[2 * i] = strlen(words[i]);
+        /* The word with its last letter dropped */
+        batch[2 * i + 1] = words[i];
+        lens[2 * i + 1] = (lens[2 * i] > 1) ? lens[2 * i] - 1 : 1;
+    }
+
+    size_t failures = 0;
+    if (-1 == spellCheckerHasWords(dict, batch, lens, num, results))
+        failures = num;
+    for (size_t i = 0; !failures && (i < num); ++i)
+    {
+        char word[64];
+        snprintf(word, sizeof(word), "%.*s", (int)lens[i], batch[i]);
+        if ((lens[i] < sizeof(word)) &&
+            (results[i] != spellCheckerHasWord(dict, word)))
+            ++failures;
+    }
+
+    printf("%zu batch lookups, %zu failed\n", num, failures);
+    free(batch);
+    free(lens);
+    free(results);
+    return failures ? -1 : 0;
+}
+
+static int testConcurrentLookups(SpellCheckerDictionaryHandle dict)
+{
+    FILE *dictFile = fopen(DICTIONARY_FILE, "r");
+    if (!dictFile)
+    {
+        printf("Failed opening dictionary file (%s)\n", DICTIONARY_FILE);
+        return -1;
+    }
+
+    LookupTest test = { dict, NULL, 0, 0, 0, 0 };
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t lineLen;
+    size_t capacity = 0;
+    while (-1 != (lineLen = getline(&line, &lineCapacity, dictFile)))
+    {
+        while (lineLen && (('\n' == line[lineLen - 1]) ||
+                           ('\r' == line[lineLen - 1])))
+            line[--lineLen] = '\0';
+        if (!lineLen)
+            continue;
+        if (test.numWords == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            char **words = realloc(test.words, capacity * sizeof(char*));
+            if (!words)
+                break;
+            test.words = words;
+        }
+        test.words[test.numWords] = strdup(line);
+        if (!test.words[test.numWords])
+            break;
+        ++test.numWords;
+    }
+    free(line);
+    fclose(dictFile);
+
+    pthread_t threads[LOOKUP_TEST_THREADS];
+    for (int i = 0; i < LOOKUP_TEST_THREADS; ++i)
+        pthread_create(&threads[i], NULL, lookupWords, &test);
+
+    /* Meanwhile, grow the dictionary */
+    char batch[LOOKUP_TEST_BATCH_SIZE * 32];
+    char lastWord[32];
+    for (int b = 0; b < LOOKUP_TEST_BATCHES; ++b)
+    {
+        size_t len = 0;
+        for (int i = 0; i < LOOKUP_TEST_BATCH_SIZE; ++i)
+        {
+            len += snprintf(&batch[len], sizeof(batch) - len,
+                            "concurrent%dx%d\n", b, i);
+            snprintf(lastWord, sizeof(lastWord), "concurrent%dx%d", b, i);
+        }
+        spellCheckerAddWords(dict, batch, len);
+    }
+
+    int ret = waitForWord(dict, lastWord);
+
+    __atomic_store_n(&test.stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < LOOKUP_TEST_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+
+    printf("%zu concurrent lookups, %zu failed\n", test.lookups,
+           test.failures);
+    if (test.failures || !test.numWords)
+        ret = -1;
+
+    if ((0 == ret) && (0 != testHasWords(dict, test.words, test.numWords)))
+        ret = -1;
+
+    for (size_t i = 0; i < test.numWords; ++i)
+        free(test.words[i]);
+    free(test.words);
+    return ret;
+}
+
+static int testSuggest(SpellCheckerDictionaryHandle dict)
+{
+    static const struct
+    {
+        const char *word;
+        const char *suggestion;
+    } tests[] = {
+        { "thare", "there" },   /* replaced */
+        { "sepll", "spell" },   /* swapped */
+        { "Speell", "spell" },  /* inserted, upper-case */
+        { "spell", "spell" }    /* valid */
+    };
+    char *out[3];
+    int ret = 0;
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i)
+    {
+        const int num = spellCheckerSuggest(dict, tests[i].word, 2, 3, out);
+        if ((num < 1) || (0 != strcmp(out[0], tests[i].suggestion)))
+        {
+            printf("Unexpected suggestion for '%s'\n", tests[i].word);
+            ret = -1;
+        }
+        for (int j = 0; j < num; ++j)
+            free(out[j]);
+    }
+
+    if (0 != spellCheckerSuggest(dict, "zzzzzzzz", 1, 3, out))
+    {
+        printf("Unexpected suggestion for a word far from all others\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*
+ * Prefixes of words are not words, but are found by the prefix queries.
+ */
+static int testPrefixes(SpellCheckerBackend backend)
+{
+    static const char words[] = "international\nin\nInternal\nintern\napple\n";
+    static const char *completions[] = {
+        "in", "intern", "internal", "international"
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithBackend(backend);
     if (!dict)
     {
-        printf("Failed loading dictionary into spell-checker!\n");
+        printf("Failed creating dictionary for prefixes\n");
         return -1;
     }
 
-    if (0 == testSpellChecker(dict))
+    int ret = 0;
+    if ((-1 == spellCheckerAddWords(dict, words, sizeof(words) - 1)) ||
+        (0 != waitForWord(dict, "apple")))
+        ret = -1;
+
+    if ((0 != ret) ||
+        (0 != spellCheckerHasWord(dict, "inter")) ||
+        (0 != spellCheckerHasWord(dict, "i")) ||
+        (1 != spellCheckerHasWord(dict, "intern")) ||
+        (1 != spellCheckerHasPrefix(dict, "INTER")) ||
+        (1 != spellCheckerHasPrefix(dict, "international")) ||
+        (0 != spellCheckerHasPrefix(dict, "internationals")) ||
+        (0 != spellCheckerHasPrefix(dict, "ix")))
     {
-        printf("+++ All tests passed! +++\n");
+        printf("Unexpected prefix lookups\n");
+        ret = -1;
+    }
+
+    char *out[4];
+    int num = spellCheckerComplete(dict, "in", 4, out);
+    for (int i = 0; i < num; ++i)
+    {
+        if (0 != strcmp(out[i], completions[i]))
+            ret = -1;
+        free(out[i]);
+    }
+    if (4 != num)
+        ret = -1;
+
+    /* Limited to the first ones */
+    num = spellCheckerComplete(dict, "Inter", 2, out);
+    if ((2 != num) || strcmp(out[0], "intern") || strcmp(out[1], "internal"))
+        ret = -1;
+    for (int i = 0; i < num; ++i)
+        free(out[i]);
+
+    if (0 != spellCheckerComplete(dict, "b", 4, out))
+        ret = -1;
+
+    if (0 != ret)
+        printf("Unexpected completions\n");
+
+    closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * A removed word is no longer found, unlike the words it is a prefix of, and a
+ * swap replaces all the words at once.
+ */
+static int testRemoveAndSwap(SpellCheckerBackend backend)
+{
+    static const char words[] = "intern\ninternal\nin\nspell\n";
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithBackend(backend);
+    SpellCheckerDictionaryHandle replacement =
+        createSpellCheckerDictionaryWithBackend(backend);
+    if (!dict || !replacement)
+    {
+        printf("Failed creating dictionaries for removals\n");
+        closeSpellCheckerDictionary(dict);
+        closeSpellCheckerDictionary(replacement);
+        return -1;
+    }
+
+    /* Operations are run in order, the removals are done once "sentinel" is
+       visible */
+    int ret = 0;
+    if ((-1 == spellCheckerAddWords(dict, words, sizeof(words) - 1)) ||
+        (0 != waitForWord(dict, "spell")) ||
+        (-1 == spellCheckerRemoveWord(dict, "Intern")) ||
+        (-1 == spellCheckerRemoveWord(dict, "spell")) ||
+        (-1 == spellCheckerRemoveWord(dict, "missing")) ||
+        (-1 == spellCheckerAddWord(dict, "sentinel")) ||
+        (0 != waitForWord(dict, "sentinel")))
+        ret = -1;
+
+    SpellCheckerStats stats;
+    const struct timespec pollInterval = { 0, 10 * 1000 * 1000 };
+    for (int i = 0; (0 == ret) && (i < 1000); ++i)
+    {
+        if (-1 == spellCheckerGetStats(dict, &stats))
+            ret = -1;
+        else if (3 == stats.numWords)
+            break;
+        nanosleep(&pollInterval, NULL);
+    }
+
+    if ((0 != ret) || (3 != stats.numWords) ||
+        (0 != spellCheckerHasWord(dict, "intern")) ||
+        (0 != spellCheckerHasWord(dict, "spell")) ||
+        (1 != spellCheckerHasWord(dict, "internal")) ||
+        (1 != spellCheckerHasWord(dict, "in")) ||
+        (1 != spellCheckerHasPrefix(dict, "intern")) ||
+        (0 != spellCheckerHasPrefix(dict, "sp")))
+    {
+        printf("Unexpected lookups after removals\n");
+        ret = -1;
+    }
+
+    if ((0 == ret) &&
+        ((-1 == spellCheckerAddWord(replacement, "spell")) ||
+         (-1 == spellCheckerAddWord(replacement, "check")) ||
+         (-1 != spellCheckerSwapDictionary(dict, dict))))
+        ret = -1;
+
+    /* The replacement's words are all visible once the swap returns */
+    if ((0 != ret) || (0 != spellCheckerSwapDictionary(dict, replacement)))
+    {
+        closeSpellCheckerDictionary(replacement);
+        ret = -1;
+    }
+    else if ((1 != spellCheckerHasWord(dict, "spell")) ||
+             (1 != spellCheckerHasWord(dict, "check")) ||
+             (0 != spellCheckerHasWord(dict, "internal")) ||
+             (-1 == spellCheckerAddWord(dict, "swapped")) ||
+             (0 != waitForWord(dict, "swapped")))
+    {
+        printf("Unexpected lookups after a swap\n");
+        ret = -1;
+    }
+
+    closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * A word removed right before compiling is neither found nor suggested by the
+ * image, even though the suggestion index saw it.
+ */
+static int testCompileRemovals(SpellCheckerBackend backend)
+{
+    static const char words[] = "help\nhello\n";
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 2, 0, 0, NULL,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(&options);
+    if (!dict)
+    {
+        printf("Failed creating dictionary for compiled removals\n");
+        return -1;
+    }
+
+    /* The removal is still pending when the compilation starts */
+    int ret = 0;
+    if ((-1 == spellCheckerAddWords(dict, words, sizeof(words) - 1)) ||
+        (0 != waitForWord(dict, "hello")) ||
+        (-1 == spellCheckerRemoveWord(dict, "help")) ||
+        (-1 == spellCheckerCompileDictionary(dict, IMAGE_FILE)))
+    {
+        printf("Failed compiling a dictionary after removals\n");
+        ret = -1;
+    }
+    closeSpellCheckerDictionary(dict);
+
+    SpellCheckerDictionaryHandle mapped = NULL;
+    if ((0 == ret) && !(mapped = openSpellCheckerDictionaryMapped(IMAGE_FILE)))
+        ret = -1;
+
+    char *out[2];
+    const int num =
+        mapped ? spellCheckerSuggest(mapped, "helpp", 2, 2, out) : 0;
+    if (mapped &&
+        ((0 != spellCheckerHasWord(mapped, "help")) ||
+         (1 != spellCheckerHasWord(mapped, "hello")) ||
+         (1 != num) || (0 != strcmp(out[0], "hello"))))
+    {
+        printf("Removed word found in a compiled dictionary\n");
+        ret = -1;
+    }
+    for (int i = 0; i < num; ++i)
+        free(out[i]);
+
+    closeSpellCheckerDictionary(mapped);
+    remove(IMAGE_FILE);
+    return ret;
+}
+
+/*
+ * Overlays of the same base see its words, and their own words only.
+ */
+static int testOverlays(SpellCheckerDictionaryHandle base)
+{
+    static const char text[] = "spell qwertyuiop asdfghjkl";
+    SpellCheckerDictionaryHandle overlay = createSpellCheckerOverlay(base, NULL);
+    SpellCheckerDictionaryHandle other = createSpellCheckerOverlay(base, NULL);
+    if (!overlay || !other)
+    {
+        printf("Failed creating overlays\n");
+        closeSpellCheckerDictionary(overlay);
+        closeSpellCheckerDictionary(other);
+        return -1;
+    }
+
+    int ret = 0;
+    int numMisspelled = 0;
+    char *out[1];
+    if ((NULL != createSpellCheckerOverlay(overlay, NULL)) ||
+        (-1 == spellCheckerAddWord(overlay, "Qwertyuiop")) ||
+        (0 != waitForWord(overlay, "qwertyuiop")) ||
+        (0 != spellCheckerHasWord(other, "qwertyuiop")) ||
+        (1 != spellCheckerHasWord(other, "spell")) ||
+        (-1 == spellCheckSpan(overlay, text, sizeof(text) - 1,
+                              countSpanCallback, &numMisspelled)) ||
+        (1 != numMisspelled) ||
+        (1 != spellCheckerSuggest(overlay, "qwertyiop", 1, 1, out)))
+    {
+        printf("Unexpected lookups in overlays\n");
+        ret = -1;
     }
     else
     {
-        printf("--- Test(s) failed! ---\n");
+        if (0 != strcmp(out[0], "qwertyuiop"))
+            ret = -1;
+        free(out[0]);
+    }
+
+    if (0 != testSuggest(other))
+        ret = -1;
+
+    closeSpellCheckerDictionary(other);
+    closeSpellCheckerDictionary(overlay);
+    return ret;
+}
+
+static int testMappedDictionary(SpellCheckerDictionaryHandle dict)
+{
+    if (-1 == spellCheckerCompileDictionary(dict, IMAGE_FILE))
+    {
+        printf("Failed compiling dictionary\n");
+        return -1;
+    }
+
+    SpellCheckerDictionaryHandle mapped =
+        openSpellCheckerDictionaryMapped(IMAGE_FILE);
+    if (!mapped)
+    {
+        printf("Failed opening compiled dictionary\n");
+        remove(IMAGE_FILE);
+        return -1;
+    }
+
+    int ret = 0;
+    if (-1 != spellCheckerAddWord(mapped, "word"))
+    {
+        printf("Added a word to a read-only dictionary\n");
+        ret = -1;
+    }
+
+    printf("--- Mapped dictionary ---\n");
+    if ((0 != testSpellChecker(mapped)) || (0 != testSuggest(mapped)) ||
+        (0 != testOverlays(mapped)))
+        ret = -1;
+
+    closeSpellCheckerDictionary(mapped);
+    remove(IMAGE_FILE);
+    return ret;
+}
+
+static int testFrequency(SpellCheckerBackend backend)
+{
+    static const struct
+    {
+        const char *word;
+        unsigned int frequency;
+    } words[] = {
+        { "cat", 1 }, { "cut", 100 }, { "cot", 10 }
+    };
+    static const char *expected[] = { "cut", "cot", "cat" };
+
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithBackend(backend);
+    if (!dict)
+    {
+        printf("Failed creating dictionary\n");
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+    {
+        if (-1 == spellCheckerAddWordWithFrequency(dict, words[i].word,
+                                                   words[i].frequency))
+            ret = -1;
+    }
+    if ((-1 == spellCheckerAddWord(dict, "other")) ||
+        (0 != waitForWord(dict, "other")))
+        ret = -1;
+
+    /* Same distance, ranked by frequency rather than alphabetically */
+    char *out[3];
+    const int num = spellCheckerSuggest(dict, "cxt", 1, 3, out);
+    for (int i = 0; i < num; ++i)
+    {
+        if ((3 != num) || (0 != strcmp(out[i], expected[i])))
+            ret = -1;
+        free(out[i]);
+    }
+    if (3 != num)
+        ret = -1;
+
+    if ((1 != spellCheckerHasWord(dict, "CUT")) ||
+        (1 != spellCheckerHasWord(dict, "other")) ||
+        (0 != spellCheckerHasWord(dict, "cxt")))
+        ret = -1;
+
+    if (-1 == ret)
+        printf("Unexpected results with word frequencies\n");
+
+    closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * A cached misspelling is forgotten once the word is added.
+ */
+static int testLookupCache(SpellCheckerBackend backend)
+{
+    static const char text[] = "alpha beta alpha beta";
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, LOOKUP_CACHE_SIZE, NULL,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(&options);
+    if (!dict)
+    {
+        printf("Failed creating dictionary with lookup caches\n");
+        return -1;
+    }
+
+    int ret = 0;
+    int before = 0;
+    int after = 0;
+    SpellCheckerCacheStats stats;
+    if ((-1 == spellCheckerAddWord(dict, "alpha")) ||
+        (0 != waitForWord(dict, "alpha")) ||
+        (-1 == spellCheckSpan(dict, text, sizeof(text) - 1,
+                              countSpanCallback, &before)) ||
+        (-1 == spellCheckerGetCacheStats(dict, &stats)) ||
+        (stats.hits < 2) ||
+        (-1 == spellCheckerAddWord(dict, "beta")) ||
+        (0 != waitForWord(dict, "beta")) ||
+        (-1 == spellCheckSpan(dict, text, sizeof(text) - 1,
+                              countSpanCallback, &after)) ||
+        (2 != before) || (0 != after))
+    {
+        printf("Unexpected results with lookup caches\n");
+        ret = -1;
+    }
+
+    closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * The counters follow the words added and checked.
+ */
+static int testStats(SpellCheckerBackend backend)
+{
+    static const char text[] = "alpha beta gamma delta";
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithBackend(backend);
+    if (!dict)
+    {
+        printf("Failed creating dictionary for stats\n");
+        return -1;
+    }
+
+    int ret = 0;
+    int numMisspelled = 0;
+    SpellCheckerStats stats;
+    if ((-1 == spellCheckerAddWord(dict, "alpha")) ||
+        (-1 == spellCheckerAddWord(dict, "beta")) ||
+        (0 != waitForWord(dict, "beta")) ||
+        (-1 == spellCheckSpan(dict, text, sizeof(text) - 1,
+                              countSpanCallback, &numMisspelled)))
+        ret = -1;
+
+    /* The size of the dictionary is updated right after the words show up */
+    const struct timespec pollInterval = { 0, 10 * 1000 * 1000 };
+    for (int i = 0; (0 == ret) && (i < 1000); ++i)
+    {
+        if (-1 == spellCheckerGetStats(dict, &stats))
+            ret = -1;
+        else if (2 == stats.numWords)
+            break;
+        nanosleep(&pollInterval, NULL);
+    }
+
+    if ((0 != ret) || (2 != stats.numWords) || (0 == stats.bytes) ||
+        (stats.numMessages < 2) || (0 == stats.maxQueueDepth) ||
+        (4 != stats.numTokens) || (2 != stats.numMisspellings) ||
+        (2 != numMisspelled))
+    {
+        printf("Unexpected dictionary stats\n");
+        ret = -1;
+    }
+
+    closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * Same suggestions, answered by a suggestion index, before and after being
+ * compiled into an image.
+ */
+static int testSuggestIndex(SpellCheckerBackend backend)
+{
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 2, 0, 0, NULL,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dict =
+        loadDictionary(DICTIONARY_FILE, &options);
+    if (!dict)
+        return -1;
+
+    int ret = testSuggest(dict);
+    if (-1 == spellCheckerCompileDictionary(dict, IMAGE_FILE))
+    {
+        printf("Failed compiling indexed dictionary\n");
+        ret = -1;
+    }
+    closeSpellCheckerDictionary(dict);
+
+    SpellCheckerDictionaryHandle mapped =
+        openSpellCheckerDictionaryMapped(IMAGE_FILE);
+    if (!mapped)
+    {
+        printf("Failed opening compiled indexed dictionary\n");
+        ret = -1;
+    }
+    else
+    {
+        if (0 != testSuggest(mapped))
+            ret = -1;
+        closeSpellCheckerDictionary(mapped);
+    }
+
+    remove(IMAGE_FILE);
+    return ret;
+}
+
+/*
+ * Holds the runner in a callback until released, so its queue fills up.
+ */
+typedef struct QueueTest
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int isHeld;
+    int isReleased;
+} QueueTest;
+
+static void holdCallback(const char *word, size_t length, size_t offset,
+                         void *userdata)
+{
+    QueueTest *test = userdata;
+    (void)word;
+    (void)length;
+    (void)offset;
+
+    pthread_mutex_lock(&test->mutex);
+    test->isHeld = 1;
+    pthread_cond_broadcast(&test->cond);
+    while (!test->isReleased)
+        pthread_cond_wait(&test->cond, &test->mutex);
+    pthread_mutex_unlock(&test->mutex);
+}
+
+static int testQueuePolicy(SpellCheckerBackend backend,
+                           SpellCheckerQueuePolicy policy)
+{
+    static const char *words[] = { "first", "second", "third" };
+    SpellCheckerOptions options = {
+        backend, 2, policy, 0, 0, 0, NULL, SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(&options);
+    if (!dict)
+    {
+        printf("Failed creating dictionary with a bounded queue\n");
+        return -1;
+    }
+
+    QueueTest test = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                       0, 0 };
+    SpellCheckerJobHandle held =
+        spellCheckAsync(dict, "x", 1, holdCallback, NULL, &test);
+    if (!held)
+    {
+        printf("Failed starting spell-check job\n");
+        closeSpellCheckerDictionary(dict);
+        return -1;
+    }
+    pthread_mutex_lock(&test.mutex);
+    while (!test.isHeld)
+        pthread_cond_wait(&test.cond, &test.mutex);
+    pthread_mutex_unlock(&test.mutex);
+
+    /* The queue holds two messages, the third one does not fit */
+    int ret = 0;
+    const int expected = (SPELL_CHECKER_QUEUE_FAIL == policy) ? -1 : 0;
+    if ((0 != spellCheckerAddWord(dict, words[0])) ||
+        (0 != spellCheckerAddWord(dict, words[1])) ||
+        (expected != spellCheckerAddWord(dict, words[2])))
+    {
+        printf("Unexpected result adding words to a full queue\n");
+        ret = -1;
+    }
+
+    numCompletions = 0;
+    SpellCheckerJobHandle dropped =
+        spellCheckAsync(dict, "x", 1, ignoreCallback, onJobComplete, NULL);
+    if ((SPELL_CHECKER_QUEUE_FAIL == policy) ? (NULL != dropped) :
+        (!dropped ||
+         (SPELL_CHECKER_JOB_CANCELLED != spellCheckerJobGetStatus(dropped)) ||
+         (1 != numCompletions)))
+    {
+        printf("Unexpected result posting a job to a full queue\n");
+        ret = -1;
+    }
+    spellCheckerJobRelease(dropped);
+
+    pthread_mutex_lock(&test.mutex);
+    test.isReleased = 1;
+    pthread_cond_broadcast(&test.cond);
+    pthread_mutex_unlock(&test.mutex);
+    spellCheckerJobWait(held, -1);
+    spellCheckerJobRelease(held);
+
+    if ((0 != waitForWord(dict, words[1])) ||
+        (0 != spellCheckerHasWord(dict, words[2])))
+    {
+        printf("Unexpected words in the dictionary\n");
+        ret = -1;
+    }
+
+    closeSpellCheckerDictionary(dict);
+    pthread_cond_destroy(&test.cond);
+    pthread_mutex_destroy(&test.mutex);
+    return ret;
+}
+
+/*
+ * UTF-8 dictionaries split text on Unicode delimiters (here an em dash and a
+ * no-break space), and fold the case of non-ASCII letters.
+ */
+static int testUtf8(SpellCheckerBackend backend)
+{
+    /* "éclair", "naïve", "straße" */
+    static const char words[] =
+        "\xC3\xA9" "clair\nna\xC3\xAF" "ve\nstra\xC3\x9F" "e\n";
+    /* "Eclairs—NAÏVE Straße strasse ÉCLAIR": "Eclairs" and "strasse" */
+    static const char text[] =
+        "Eclairs\xE2\x80\x94" "NA\xC3\x8F" "VE\xC2\xA0Stra\xC3\x9F" "e strasse "
+        "\xC3\x89" "CLAIR";
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, NULL,
+        SPELL_CHECKER_ENCODING_UTF8
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithOptions(&options);
+    if (!dict)
+    {
+        printf("Failed creating UTF-8 dictionary\n");
+        return -1;
+    }
+
+    int ret = 0;
+    char *completions[2] = { NULL, NULL };
+    numMisspellings = 0;
+    if ((-1 == spellCheckerAddWords(dict, words, sizeof(words) - 1)) ||
+        (-1 == spellCheckerAddWord(dict, "em\xE2\x80\x94" "dash")) ||
+        (-1 == spellCheckerAddWord(dict, "sentinel")) ||
+        (0 != waitForWord(dict, "sentinel")) ||
+        (1 != spellCheckerHasWord(dict, "\xC3\x89" "CLAIR")) ||
+        (0 != spellCheckerHasWord(dict, "em\xE2\x80\x94" "dash")) ||
+        (1 != spellCheckerComplete(dict, "NA\xC3\x8F", 2, completions)) ||
+        (0 != strcmp(completions[0], "na\xC3\xAF" "ve")))
+    {
+        printf("Unexpected lookups in a UTF-8 dictionary\n");
+        ret = -1;
+    }
+    free(completions[0]);
+
+    spellCheck(dict, text, digestCallback);
+    if ((0 != waitForQueue(dict)) || (2 != numMisspellings))
+    {
+        printf("Unexpected misspellings in UTF-8 text: %zu\n",
+               numMisspellings);
+        ret = -1;
+    }
+
+    /*
+     * Streamed in chunks that cut the words, and the sequences of "ï" and of
+     * the no-break spaces between them: "naive" only is misspelled
+     */
+    enum { NUM_STREAMED = 1600 };
+    static const char streamed[] = "na\xC3\xAF" "ve\xC2\xA0";
+    static const size_t chunkSizes[] = { 5001, 4095 };
+    char *streamedText = malloc(NUM_STREAMED * (sizeof(streamed) - 1));
+    for (size_t i = 0; streamedText && (i < NUM_STREAMED); ++i)
+        memcpy(&streamedText[i * (sizeof(streamed) - 1)],
+               (NUM_STREAMED / 2 == i) ? "naive\xC2\xA0 " : streamed,
+               sizeof(streamed) - 1);
+    for (size_t i = 0; (0 == ret) && (i < 2); ++i)
+    {
+        const size_t len = NUM_STREAMED * (sizeof(streamed) - 1);
+        int numStreamed = 0;
+        SpellCheckerStreamHandle stream = streamedText ?
+            spellCheckBegin(dict, countSpanCallback, &numStreamed) : NULL;
+        for (size_t pos = 0; stream && (pos < len); pos += chunkSizes[i])
+        {
+            const size_t chunkSize =
+                (len - pos < chunkSizes[i]) ? len - pos : chunkSizes[i];
+            if (-1 == spellCheckFeed(stream, &streamedText[pos], chunkSize))
+                ret = -1;
+        }
+        if (!stream || (-1 == spellCheckEnd(stream)) || (1 != numStreamed))
+        {
+            printf("Unexpected misspellings in streamed UTF-8 text: %d\n",
+                   numStreamed);
+            ret = -1;
+        }
+    }
+    free(streamedText);
+
+    /* Images keep the encoding */
+    SpellCheckerDictionaryHandle mapped = NULL;
+    if ((0 == ret) &&
+        ((-1 == spellCheckerCompileDictionary(dict, IMAGE_FILE)) ||
+         !(mapped = openSpellCheckerDictionaryMapped(IMAGE_FILE)) ||
+         (1 != spellCheckerHasWord(mapped, "NA\xC3\x8F" "VE"))))
+    {
+        printf("Unexpected lookups in a UTF-8 image\n");
+        ret = -1;
     }
 
+    closeSpellCheckerDictionary(mapped);
+    remove(IMAGE_FILE);
     closeSpellCheckerDictionary(dict);
+    return ret;
+}
+
+/*
+ * Dictionaries sharing an executor still run their operations in order: a
+ * check posted after words are added sees them.
+ */
+static int testExecutor(SpellCheckerBackend backend)
+{
+    enum { NUM_DICTS = 8 };
+    static const char words[] = "shared\nworker\npool\n";
+    static const char text[] = "shared worker pool thread";
+    SpellCheckerExecutorHandle executor = createSpellCheckerExecutor(2);
+    if (!executor)
+    {
+        printf("Failed creating executor\n");
+        return -1;
+    }
+
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, executor,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dicts[NUM_DICTS] = { NULL };
+    SpellCheckerJobHandle jobs[NUM_DICTS] = { NULL };
+    int numMisspelled[NUM_DICTS] = { 0 };
+    int ret = 0;
+    for (int i = 0; i < NUM_DICTS; ++i)
+    {
+        dicts[i] = createSpellCheckerDictionaryWithOptions(&options);
+        if (!dicts[i] ||
+            (-1 == spellCheckerAddWords(dicts[i], words, sizeof(words) - 1)) ||
+            (-1 == spellCheckerAddWord(dicts[i], (i % 2) ? "thread" : "other")))
+        {
+            printf("Failed adding words to a dictionary on an executor\n");
+            ret = -1;
+            break;
+        }
+        jobs[i] = spellCheckAsync(dicts[i], text, sizeof(text) - 1,
+                                  countSpanCallback, NULL, &numMisspelled[i]);
+    }
+
+    /* The dictionaries outlive the executor's handle */
+    closeSpellCheckerExecutor(executor);
+
+    for (int i = 0; i < NUM_DICTS; ++i)
+    {
+        if (jobs[i] && (0 != spellCheckerJobWait(jobs[i], -1)))
+            ret = -1;
+        else if ((0 == ret) && (numMisspelled[i] != !(i % 2)))
+        {
+            printf("Unexpected misspellings on an executor: %d\n",
+                   numMisspelled[i]);
+            ret = -1;
+        }
+        spellCheckerJobRelease(jobs[i]);
+        closeSpellCheckerDictionary(dicts[i]);
+    }
+
+    return ret;
+}
+
+/*
+ * More dictionaries than a process has thread-specific keys (1024 on Linux)
+ * can run on an executor, and be checked from any thread.
+ */
+static int testManyDictionaries(SpellCheckerBackend backend)
+{
+    enum { NUM_DICTS = 1100 };
+    static const char text[] = "tenant other";
+    SpellCheckerExecutorHandle executor = createSpellCheckerExecutor(2);
+    SpellCheckerDictionaryHandle *dicts =
+        calloc(NUM_DICTS, sizeof(SpellCheckerDictionaryHandle));
+    SpellCheckerJobHandle *jobs =
+        calloc(NUM_DICTS, sizeof(SpellCheckerJobHandle));
+    int *numMisspelled = calloc(NUM_DICTS, sizeof(int));
+    int ret = 0;
+    if (!executor || !dicts || !jobs || !numMisspelled)
+    {
+        printf("Failed allocating many dictionaries\n");
+        ret = -1;
+    }
+
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, executor,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    for (int i = 0; (0 == ret) && (i < NUM_DICTS); ++i)
+    {
+        dicts[i] = createSpellCheckerDictionaryWithOptions(&options);
+        if (!dicts[i] || (-1 == spellCheckerAddWord(dicts[i], "tenant")))
+        {
+            printf("Failed creating dictionary %d on an executor\n", i);
+            ret = -1;
+        }
+    }
+
+    /* Checked on the executor's workers, then from this thread */
+    for (int i = 0; (0 == ret) && (i < NUM_DICTS); ++i)
+    {
+        jobs[i] = spellCheckAsync(dicts[i], text, sizeof(text) - 1,
+                                  countSpanCallback, NULL, &numMisspelled[i]);
+        if (!jobs[i])
+            ret = -1;
+    }
+    for (int i = 0; (0 == ret) && (i < NUM_DICTS); ++i)
+    {
+        if ((0 != spellCheckerJobWait(jobs[i], -1)) ||
+            (0 != spellCheckSpan(dicts[i], text, sizeof(text) - 1,
+                                 countSpanCallback, &numMisspelled[i])) ||
+            (2 != numMisspelled[i]))
+        {
+            printf("Unexpected misspellings in dictionary %d: %d\n", i,
+                   numMisspelled[i]);
+            ret = -1;
+        }
+    }
+
+    for (int i = 0; dicts && jobs && (i < NUM_DICTS); ++i)
+    {
+        if (jobs[i])
+        {
+            spellCheckerJobWait(jobs[i], -1);
+            spellCheckerJobRelease(jobs[i]);
+        }
+        closeSpellCheckerDictionary(dicts[i]);
+    }
+    closeSpellCheckerExecutor(executor);
+    free(numMisspelled);
+    free(jobs);
+    free(dicts);
+    return ret;
+}
+
+/*
+ * The number of threads of the process, or -1 if unknown.
+ */
+static int countThreads(void)
+{
+    FILE *file = fopen("/proc/self/status", "r");
+    if (!file)
+        return -1;
+
+    char line[256];
+    int numThreads = -1;
+    while ((-1 == numThreads) && fgets(line, sizeof(line), file))
+    {
+        if (1 != sscanf(line, "Threads: %d", &numThreads))
+            numThreads = -1;
+    }
+    fclose(file);
+    return numThreads;
+}
+
+/*
+ * A dictionary running on an executor can be swapped in: the executor's
+ * threads are gone once it and the dictionary are closed.
+ */
+static int testSwapFromExecutor(SpellCheckerBackend backend)
+{
+    const int numThreads = countThreads();
+    SpellCheckerExecutorHandle executor = createSpellCheckerExecutor(3);
+    if (!executor)
+    {
+        printf("Failed creating executor\n");
+        return -1;
+    }
+
+    const SpellCheckerOptions options = {
+        backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0, 0, executor,
+        SPELL_CHECKER_ENCODING_BYTES
+    };
+    SpellCheckerDictionaryHandle dict =
+        createSpellCheckerDictionaryWithBackend(backend);
+    SpellCheckerDictionaryHandle replacement =
+        createSpellCheckerDictionaryWithOptions(&options);
+    closeSpellCheckerExecutor(executor);
+
+    int ret = 0;
+    if (!dict || !replacement ||
+        (-1 == spellCheckerAddWord(replacement, "pooled")) ||
+        (0 != spellCheckerSwapDictionary(dict, replacement)))
+    {
+        printf("Failed swapping in a dictionary on an executor\n");
+        closeSpellCheckerDictionary(replacement);
+        ret = -1;
+    }
+    else if (1 != spellCheckerHasWord(dict, "pooled"))
+    {
+        printf("Unexpected lookups after a swap from an executor\n");
+        ret = -1;
+    }
+    closeSpellCheckerDictionary(dict);
+
+    if ((0 == ret) && (-1 != numThreads) && (numThreads != countThreads()))
+    {
+        printf("Executor threads left after a swap: %d, expected %d\n",
+               countThreads(), numThreads);
+        ret = -1;
+    }
+    return ret;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        SpellCheckerBackend backend;
+        const char *name;
+    } backends[] = {
+        { SPELL_CHECKER_BACKEND_TRIE, "trie" },
+        { SPELL_CHECKER_BACKEND_HASH, "hash" },
+        { SPELL_CHECKER_BACKEND_DAWG, "dawg" }
+    };
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i)
+    {
+        printf("=== Testing %s backend ===\n", backends[i].name);
+
+        /* TODO: load words to same dictionary from multiple thread to test
+           and validate multi-threaded code. */
+        /* With lookup caches, so all the checks below go through them */
+        const SpellCheckerOptions options = {
+            backends[i].backend, 0, SPELL_CHECKER_QUEUE_BLOCK, 0, 0,
+            LOOKUP_CACHE_SIZE, NULL, SPELL_CHECKER_ENCODING_BYTES
+        };
+        SpellCheckerDictionaryHandle dict =
+            loadDictionary(DICTIONARY_FILE, &options);
+        if (!dict)
+        {
+            printf("Failed loading dictionary into spell-checker!\n");
+            return -1;
+        }
+
+        if (0 != testSpellChecker(dict))
+            failed = 1;
+
+        if (0 != testParallelSpellChecker(dict))
+            failed = 1;
+
+        if (0 != testConcurrentLookups(dict))
+            failed = 1;
+
+        if (0 != testSuggest(dict))
+            failed = 1;
+
+        if (0 != testMappedDictionary(dict))
+            failed = 1;
+
+        if (0 != testSuggestIndex(backends[i].backend))
+            failed = 1;
+
+        if (0 != testPrefixes(backends[i].backend))
+            failed = 1;
+
+        if (0 != testRemoveAndSwap(backends[i].backend))
+            failed = 1;
+
+        if (0 != testCompileRemovals(backends[i].backend))
+            failed = 1;
+
+        if (0 != testFrequency(backends[i].backend))
+            failed = 1;
+
+        if (0 != testLookupCache(backends[i].backend))
+            failed = 1;
+
+        if (0 != testStats(backends[i].backend))
+            failed = 1;
+
+        if (0 != testExecutor(backends[i].backend))
+            failed = 1;
+
+        if (0 != testSwapFromExecutor(backends[i].backend))
+            failed = 1;
+
+        if (0 != testManyDictionaries(backends[i].backend))
+            failed = 1;
+
+        if (0 != testUtf8(backends[i].backend))
+            failed = 1;
+
+        if ((0 != testQueuePolicy(backends[i].backend,
+                                  SPELL_CHECKER_QUEUE_FAIL)) ||
+            (0 != testQueuePolicy(backends[i].backend,
+                                  SPELL_CHECKER_QUEUE_DROP)))
+            failed = 1;
+
+        closeSpellCheckerDictionary(dict);
+    }
+
+    if (!failed)
+    {
+        printf("+++ All tests passed! +++\n");
+    }
+    else
+    {
+        printf("--- Test(s) failed! ---\n");
+    }
 
     return 0;
 }
@@ -0,0 +1,133 @@
+#include "spell-checker_tokenizer.h"
+#include "spell-checker_unicode.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define SCT_DIGITS 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+#define SCT_LETTERS 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, \
+                    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+#define SCT_EXTENDED_16 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+#define SCT_EXTENDED SCT_EXTENDED_16, SCT_EXTENDED_16, SCT_EXTENDED_16, \
+                     SCT_EXTENDED_16, SCT_EXTENDED_16, SCT_EXTENDED_16, \
+                     SCT_EXTENDED_16, SCT_EXTENDED_16
+
+const unsigned char sctWordChars[256] = {
+    [0x30] = SCT_DIGITS,     /* 0-9 */
+    [0x41] = SCT_LETTERS,    /* A-Z */
+    [0x61] = SCT_LETTERS,    /* a-z */
+    [0x80] = SCT_EXTENDED    /* 0x80-0xFF */
+};
+
+#ifdef __SSE2__
+/*
+ * Classify 16 characters at once.
+ * @return a mask with bit i set if p[i] is a word character.
+ *
+ * SSE2 only has signed byte comparisons, under which the extended characters
+ * (0x80-0xFF) are the negative ones. Setting bit 5 maps A-Z to a-z, and keeps
+ * the other ASCII characters out of a-z (and the extended ones negative).
+ */
+static inline unsigned int sctWordMask16(const char *p)
+{
+    const __m128i chars = _mm_loadu_si128((const __m128i*)p);
+    const __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    const __m128i digits =
+        _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                      _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    const __m128i letters =
+        _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                      _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    const __m128i extended = _mm_cmplt_epi8(chars, _mm_setzero_si128());
+    return (unsigned int)_mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(digits, letters), extended));
+}
+#endif
+
+/*
+ * Find the first word character (if isWord is 1) or delimiter (if isWord is
+ * 0) at or after position i, 16 characters at a time where SSE2 is available.
+ * @return its position, or len if there is none.
+ */
+static inline size_t sctFind(const char *text, size_t len, size_t i,
+                             int isWord)
+{
+#ifdef __SSE2__
+    const unsigned int flip = isWord ? 0 : 0xFFFF;
+    for (; i + 16 <= len; i += 16)
+    {
+        const unsigned int mask = sctWordMask16(&text[i]) ^ flip;
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    while ((i < len) && (sctIsWordChar(text[i]) != isWord))
+        ++i;
+    return i;
+}
+
+size_t sctNextWord(const char *text, size_t len, size_t *pos, size_t *start)
+{
+    *start = sctFind(text, len, *pos, 1);
+    *pos = sctFind(text, len, *start, 0);
+    return *pos - *start;
+}
+
+/*
+ * Same as sctFind(), but also stops at the first non-ASCII character: the
+ * ASCII characters are classified the same in UTF-8 mode, a block of them
+ * costs a single comparison more.
+ */
+static inline size_t sctFindAscii(const char *text, size_t len, size_t i,
+                                  int isWord)
+{
+#ifdef __SSE2__
+    const unsigned int flip = isWord ? 0 : 0xFFFF;
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i chars = _mm_loadu_si128((const __m128i*)&text[i]);
+        const unsigned int mask = (sctWordMask16(&text[i]) ^ flip) |
+            (unsigned int)_mm_movemask_epi8(chars);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    while ((i < len) && !(text[i] & 0x80) &&
+           (sctIsWordChar(text[i]) != isWord))
+        ++i;
+    return i;
+}
+
+/*
+ * Same as sctFind(), for UTF-8 text: runs of ASCII characters are scanned as
+ * in byte mode, the other characters are decoded one at a time.
+ */
+static inline size_t sctFindUtf8(const char *text, size_t len, size_t i,
+                                 int isWord)
+{
+    while (i < len)
+    {
+        if (!(text[i] & 0x80))
+        {
+            i = sctFindAscii(text, len, i, isWord);
+            if ((i == len) || !(text[i] & 0x80))
+                return i;
+        }
+
+        uint32_t cp;
+        const size_t n = scuDecode(&text[i], len - i, &cp);
+        if (!scuIsWordChar(cp) == !isWord)
+            return i;
+        i += n;
+    }
+    return len;
+}
+
+size_t sctNextWordUtf8(const char *text, size_t len, size_t *pos,
+                       size_t *start)
+{
+    *start = sctFindUtf8(text, len, *pos, 1);
+    *pos = sctFindUtf8(text, len, *start, 0);
+    return *pos - *start;
+}
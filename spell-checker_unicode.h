@@ -0,0 +1,90 @@
+#ifndef __SPELL_CHECKER_UNICODE_H
+#define __SPELL_CHECKER_UNICODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The characters of UTF-8 dictionaries (see spell-checker.h): words are made
+ * of letters, combining marks and decimal digits (the general categories L*,
+ * M* and Nd, which include [0-9a-zA-Z]), anything else is a delimiter. Words
+ * are compared under Unicode simple case folding (the C and S mappings of
+ * CaseFolding.txt), which maps each character to a single one, e.g. "Éclair"
+ * to "éclair", but "ß" stays as is.
+ *
+ * A byte that does not start a valid UTF-8 sequence (e.g. in Latin-1 text) is
+ * taken as a character of its own: a word character, never folded, as in byte
+ * mode.
+ *
+ * The tables in spell-checker_unicode.c are generated from the Unicode 14.0
+ * character database.
+ */
+
+/* Returned by scuDecode() for a byte that does not start a valid sequence */
+#define SCU_INVALID 0xFFFFFFFFu
+
+/*
+ * The size a word can grow to when folded: a few 2-byte characters fold into
+ * 3-byte ones (e.g. U+023A into U+2C65), the others keep their size or shrink.
+ */
+#define SCU_MAX_FOLDED_LEN(len) ((len) + (len) / 2)
+
+/**
+ * Decode the character text starts with.
+ * @param text the text, at least one byte long.
+ * @param len the length of text.
+ * @param cp set to the code point, or SCU_INVALID if the first byte does not
+ * start a valid (shortest form, not a surrogate) sequence.
+ * @return the length of the character: 1 for SCU_INVALID.
+ */
+size_t scuDecode(const char *text, size_t len, uint32_t *cp);
+
+/**
+ * @return non-zero if the code point (or SCU_INVALID) is a word character, 0
+ * if it is a delimiter.
+ */
+int scuIsWordChar(uint32_t cp);
+
+/**
+ * @return the simple case folding of the code point, cp itself if it has
+ * none. ASCII letters are left as is, the backends fold them.
+ */
+uint32_t scuFold(uint32_t cp);
+
+/**
+ * @return non-zero if all the bytes of text are ASCII ones, in which case
+ * folding leaves it as is. Checks 8 bytes at a time, most words are a block
+ * or two.
+ */
+static inline int scuIsAscii(const char *text, size_t len)
+{
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t block;
+        memcpy(&block, &text[i], sizeof(block));
+        bits |= block;
+    }
+    for (; i < len; ++i)
+        bits |= (unsigned char)text[i];
+    return !(bits & 0x8080808080808080ULL);
+}
+
+/**
+ * @return non-zero if word is made of word characters only.
+ */
+int scuIsWord(const char *word, size_t len);
+
+/**
+ * Fold the case of a word.
+ * @param word the word, not necessarily null-terminated.
+ * @param len the length of word.
+ * @param out filled with the folded word, not null-terminated. Must have room
+ * for SCU_MAX_FOLDED_LEN(len) bytes.
+ * @return the length of the folded word.
+ */
+size_t scuFoldWord(const char *word, size_t len, char *out);
+
+#endif